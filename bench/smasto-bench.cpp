@@ -0,0 +1,486 @@
+/**
+ * @file   smasto-bench.cpp
+ *
+ * Benchmark the SMaSTo tools on generated matrices.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glob.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+/** A benchmark: a pipeline command line, with placeholders replaced
+    by properties of the input matrix. */
+struct Benchmark
+{
+  const char* name;
+  const char* command;
+  /// whether the command reads the generated matrix from its input stream
+  bool reads_input;
+};
+
+/// Every tool, run on its core path; placeholders are `@INPUT@` (a
+/// file holding the generated matrix), `@ROWS@`, `@COLS@`,
+/// `@HALFROWS@`, `@HALFCOLS@` and `@DENSITY@`.
+static const Benchmark benchmarks[] = {
+  { "adjoin",       "adjoin @INPUT@ @INPUT@",                           false },
+  { "blockechelon", "blockechelon",                                     true },
+  { "canon",        "canon -c",                                         true },
+  { "convert",      "convert -t mm",                                    true },
+  { "fill",         "fill",                                             true },
+  { "info",         "info",                                             true },
+  { "kron",         "kron -g 2x2 @INPUT@ 0 0 @INPUT@",                  false },
+  { "norm",         "norm",                                             true },
+  { "permute",      "permute --sorted",                                 true },
+  { "randminor",    "randminor -s 1 -R @HALFROWS@ -C @HALFCOLS@",       true },
+  { "random",       "random -s 1 @DENSITY@ @ROWS@ @COLS@",              false },
+  { "rank",         "random -s 1 -I 100 @DENSITY@ @ROWS@ @COLS@ | rank", false },
+  { "reordcols",    "reordcols",                                        true },
+  { "reordrows",    "reordrows",                                        true },
+  { "rescale",      "rescale -m 2",                                     true },
+  { "shrink",       "shrink",                                           true },
+  { "slice",        "slice -r 1:@HALFROWS@",                            true },
+  { "split",        "split -P @INPUT@",                                 true },
+  { "to-png",       "to-svg -f png -w 1024",                            true },
+  { "to-svg",       "to-svg",                                           true },
+  { "transpose",    "transpose",                                        true },
+  { "verify",       "verify",                                           true },
+  { "wellknown",    "wellknown -b 2 banded @ROWS@ @COLS@",              false },
+  { "pipeline",     "shrink | transpose | rescale -m 2 | transpose",    true },
+};
+
+
+/** Timings and sizes measured for one benchmark. */
+struct Result
+{
+  std::string name;
+  std::string command;
+  int status;
+  std::vector<double> seconds;
+  double median;
+  long nonzeros;
+  std::size_t bytes;
+  long peak_rss_kb;
+  double baseline;
+};
+
+
+/// Replace all occurrences of `from` in `text` with `to`.
+static void
+replace_all(std::string& text, const std::string& from, const std::string& to)
+{
+  for (std::size_t pos = text.find(from); pos != std::string::npos;
+       pos = text.find(from, pos + to.size()))
+    text.replace(pos, from.size(), to);
+};
+
+
+/// Return `value` formatted as a string.
+template< typename T >
+static std::string
+to_string(const T& value)
+{
+  std::ostringstream out;
+  out << value;
+  return out.str();
+};
+
+
+/// Return the number of entries in an SMS matrix held in `text`.
+static long
+count_entries(const std::string& text)
+{
+  // one line for the header, and one for the end marker
+  return std::max(0L, static_cast<long>(std::count(text.begin(), text.end(), '\n')) - 2);
+};
+
+
+/// Reset the peak RSS counter of this process, if the OS allows it.
+static void
+reset_peak_rss()
+{
+  // Linux 4.0+: writing "5" to `clear_refs` resets `VmHWM`
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs.good())
+    clear_refs << "5" << std::endl;
+};
+
+
+/// Return the peak RSS of this process (since the last reset, if
+/// supported) in kilobytes.
+static long
+peak_rss_kb()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (0 == line.compare(0, 6, "VmHWM:")) {
+      long kb = 0;
+      std::istringstream(line.substr(6)) >> kb;
+      return kb;
+    };
+  // `ru_maxrss` is the all-time peak
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+};
+
+
+class BenchProgram : public FilterProgram
+{
+public:
+  BenchProgram()
+    : baseline_file_(), generator_(), rows_(10000), density_(0.0005),
+      repeat_(5), max_seconds_(10.0), tolerance_(10.0), names_()
+  {
+    this->add_option('b', "baseline", required_argument,
+                     "Compare results to those in JSON file ARG, and flag regressions.");
+    this->add_option('d', "density", required_argument,
+                     "Density of the default random input matrix (default: 0.0005).");
+    this->add_option('g', "generator", required_argument,
+                     "Generate the input matrix with the tool command line ARG,"
+                     " e.g., 'wellknown laplace3d 50 50 50'.");
+    this->add_option('n', "rows", required_argument,
+                     "Order of the default random input matrix (default: 10000).");
+    this->add_option('m', "max-seconds", required_argument,
+                     "Stop repeating a benchmark once it has run for ARG seconds in total (default: 10).");
+    this->add_option('r', "repeat", required_argument,
+                     "Run each benchmark ARG times, and report the median (default: 5).");
+    this->add_option('t', "tolerance", required_argument,
+                     "Flag a regression if a median time exceeds the baseline by more"
+                     " than ARG percent (default: 10).");
+    this->description =
+      "Run the SMaSTo tools in-process on a generated matrix and report\n"
+      "their performance as JSON on OUTPUT (option `-o`; default: the\n"
+      "standard output).  Positional arguments select benchmarks by name;\n"
+      "by default, all are run.\n"
+      "\n"
+      "The input matrix is generated once and kept in memory; by default,\n"
+      "it is a square random matrix (options `--rows` and `--density`),\n"
+      "but option `--generator` can select any generating command, e.g.,\n"
+      "`wellknown rmat -n 1000000 65536 65536`.  Each benchmark parses the\n"
+      "input, runs the tool, and formats its output to memory, `--repeat`\n"
+      "times (or less, for benchmarks taking longer than `--max-seconds`\n"
+      "in total).  For each benchmark, the median wall-clock time, the number\n"
+      "of nonzero entries and of bytes (input plus output) processed per\n"
+      "second, and the peak resident set size are reported.\n"
+      "\n"
+      "With option `--baseline`, each median time is compared to the one\n"
+      "in a JSON file produced by an earlier run; slowdowns beyond the\n"
+      "`--tolerance` are reported as regressions, and the exit code is 1.\n"
+      "The exit code is 1 as well if some tool is not run by any benchmark.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('b' == opt)
+      baseline_file_ = argument;
+    else if ('d' == opt)
+      std::istringstream(argument) >> density_;
+    else if ('g' == opt)
+      generator_ = argument;
+    else if ('m' == opt)
+      std::istringstream(argument) >> max_seconds_;
+    else if ('n' == opt)
+      std::istringstream(argument) >> rows_;
+    else if ('r' == opt) {
+      std::istringstream(argument) >> repeat_;
+      if (repeat_ < 1)
+        throw std::runtime_error("Argument to option '--repeat' must be a positive integer.");
+    }
+    else if ('t' == opt)
+      std::istringstream(argument) >> tolerance_;
+  };
+
+  void parse_args(int argc, char** argv)
+  {
+    names_.assign(argv + 1, argv + argc);
+    for (std::vector<std::string>::const_iterator n = names_.begin(); n != names_.end(); ++n) {
+      bool found = false;
+      for (std::size_t k = 0; k < sizeof(benchmarks) / sizeof(benchmarks[0]); ++k)
+        if (*n == benchmarks[k].name)
+          found = true;
+      if (not found) {
+        std::ostringstream msg;
+        msg << "Unknown benchmark '" << *n << "'.";
+        throw std::runtime_error(msg.str());
+      };
+    };
+  };
+
+  int run()
+  {
+    // generate the input matrix
+    std::string generator = generator_;
+    if (generator.empty())
+      generator = "random -s 1 " + to_string(density_) + " " + to_string(rows_)
+        + " " + to_string(rows_);
+    std::ostringstream generated;
+    if (0 != run_pipeline(split_pipeline(generator), NULL, &generated))
+      throw std::runtime_error("Cannot generate the input matrix with '" + generator + "'.");
+    const std::string input = generated.str();
+    long nrows = 0, ncols = 0;
+    std::istringstream(input) >> nrows >> ncols;
+    const long nonzeros = count_entries(input);
+    std::cerr << "Input: " << nrows << "x" << ncols << " matrix with "
+              << nonzeros << " nonzeros (" << input.size() << " bytes)" << std::endl;
+
+    // some tools only read files
+    char input_file[] = "/tmp/smasto-bench-XXXXXX";
+    const int fd = mkstemp(input_file);
+    if (fd < 0)
+      throw std::runtime_error("Cannot create temporary file for the input matrix.");
+    close(fd);
+    {
+      std::ofstream out(input_file);
+      out << input;
+    };
+
+    std::map<std::string, double> baseline;
+    if (not baseline_file_.empty())
+      read_baseline(baseline_file_, baseline);
+
+    // every registered tool should be run by some benchmark
+    std::set<std::string> benchmarked;
+    for (std::size_t k = 0; k < sizeof(benchmarks) / sizeof(benchmarks[0]); ++k) {
+      const std::vector<std::string> words = split_pipeline(benchmarks[k].command);
+      for (std::size_t w = 0; w < words.size(); ++w)
+        if (0 == w or "|" == words[w-1])
+          benchmarked.insert(words[w]);
+    };
+    int unbenchmarked = 0;
+    const std::map<std::string, program_factory>& registry = program_registry();
+    for (std::map<std::string, program_factory>::const_iterator p = registry.begin();
+         p != registry.end(); ++p)
+      if (benchmarked.find(p->first) == benchmarked.end()) {
+        std::cerr << "WARNING: No benchmark runs tool '" << p->first << "'." << std::endl;
+        ++unbenchmarked;
+      };
+
+    std::vector<Result> results;
+    for (std::size_t k = 0; k < sizeof(benchmarks) / sizeof(benchmarks[0]); ++k) {
+      const Benchmark& bench = benchmarks[k];
+      if (not names_.empty()
+          and std::find(names_.begin(), names_.end(), bench.name) == names_.end())
+        continue;
+
+      std::string command(bench.command);
+      replace_all(command, "@INPUT@", input_file);
+      replace_all(command, "@ROWS@", to_string(nrows));
+      replace_all(command, "@COLS@", to_string(ncols));
+      replace_all(command, "@HALFROWS@", to_string(std::max(1L, nrows/2)));
+      replace_all(command, "@HALFCOLS@", to_string(std::max(1L, ncols/2)));
+      replace_all(command, "@DENSITY@",
+                  to_string(static_cast<double>(nonzeros) / nrows / ncols));
+      const std::vector<std::string> words = split_pipeline(command);
+
+      Result result;
+      result.name = bench.name;
+      result.command = command;
+      result.status = 0;
+      result.nonzeros = nonzeros;
+      result.bytes = 0;
+      result.baseline = -1;
+      reset_peak_rss();
+      double total = 0;
+      for (int r = 0; r < repeat_ and 0 == result.status and total < max_seconds_; ++r) {
+        std::istringstream in(bench.reads_input? input : std::string());
+        std::ostringstream out;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        result.status = run_pipeline(words, (bench.reads_input? &in : NULL), &out);
+        const std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        result.seconds.push_back(std::chrono::duration<double>(stop - start).count());
+        total += result.seconds.back();
+        if (0 == r) {
+          const std::string output = out.str();
+          result.bytes = (bench.reads_input? input.size() : 0) + output.size();
+          // generators are measured by what they produce; pipelines
+          // ending in a non-matrix output (e.g., `rank`) by the input size
+          if (not bench.reads_input and count_entries(output) > 0)
+            result.nonzeros = count_entries(output);
+        };
+      };
+      result.peak_rss_kb = peak_rss_kb();
+      std::vector<double> sorted(result.seconds);
+      std::sort(sorted.begin(), sorted.end());
+      result.median = sorted[sorted.size() / 2];
+      if (baseline.find(result.name) != baseline.end())
+        result.baseline = baseline[result.name];
+      report(std::cerr, result);
+      results.push_back(result);
+    };
+    unlink(input_file);
+    // `split` writes its components next to the input file
+    glob_t components;
+    if (0 == glob((std::string(input_file) + "-*.sms").c_str(), 0, NULL, &components)) {
+      for (std::size_t k = 0; k < components.gl_pathc; ++k)
+        unlink(components.gl_pathv[k]);
+      globfree(&components);
+    };
+
+    write_json(*FilterProgram::output_, generator, nrows, ncols, nonzeros, input.size(), results);
+
+    // exit code reflects failures, regressions, and tools left out
+    int exitcode = (unbenchmarked > 0? 1 : 0);
+    for (std::vector<Result>::const_iterator r = results.begin(); r != results.end(); ++r)
+      if (0 != r->status or is_regression(*r))
+        exitcode = 1;
+    return exitcode;
+  };
+
+
+private:
+  std::string baseline_file_;
+  std::string generator_;
+  long rows_;
+  double density_;
+  int repeat_;
+  double max_seconds_;
+  double tolerance_;
+  std::vector<std::string> names_;
+
+  bool is_regression(const Result& result) const
+  {
+    return (result.baseline > 0
+            and result.median > result.baseline * (1.0 + tolerance_/100.0));
+  };
+
+  /// Print a one-line summary of `result` to `out`.
+  void report(std::ostream& out, const Result& result) const
+  {
+    out << std::setw(14) << std::left << result.name;
+    if (0 != result.status) {
+      out << "FAILED (exit code " << result.status << ")" << std::endl;
+      return;
+    };
+    out << std::fixed << std::setprecision(4) << result.median << " s  "
+        << std::scientific << std::setprecision(3)
+        << (result.nonzeros / result.median) << " nz/s  "
+        << std::fixed << std::setprecision(1)
+        << (result.bytes / result.median / 1e6) << " MB/s  "
+        << result.peak_rss_kb << " kB";
+    if (result.baseline > 0) {
+      out << "  " << std::showpos << std::setprecision(1)
+          << (100.0 * (result.median / result.baseline - 1.0)) << "%"
+          << std::noshowpos;
+      if (is_regression(result))
+        out << "  REGRESSION";
+    };
+    out << std::defaultfloat << std::setprecision(6) << std::endl;
+  };
+
+  /// Read the median times from a JSON file written by `write_json`.
+  void read_baseline(const std::string& filename, std::map<std::string, double>& baseline)
+  {
+    errno = 0;
+    std::ifstream in(filename.c_str());
+    if (not in.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open baseline file '" << filename << "': " << strerror(errno) << ".";
+      throw std::runtime_error(msg.str());
+    };
+    // results are written one per line, see `write_json`
+    static const std::string name_key("\"name\": \"");
+    static const std::string median_key("\"median_seconds\": ");
+    std::string line;
+    while (std::getline(in, line)) {
+      const std::size_t n = line.find(name_key);
+      const std::size_t m = line.find(median_key);
+      if (std::string::npos == n or std::string::npos == m)
+        continue;
+      const std::size_t start = n + name_key.size();
+      const std::string name = line.substr(start, line.find('"', start) - start);
+      double median = -1;
+      std::istringstream(line.substr(m + median_key.size())) >> median;
+      baseline[name] = median;
+    };
+  };
+
+  /// Return `text` quoted as a JSON string.
+  static std::string quote(const std::string& text)
+  {
+    std::string result("\"");
+    for (std::string::const_iterator c = text.begin(); c != text.end(); ++c) {
+      if ('"' == *c or '\\' == *c)
+        result += '\\';
+      result += *c;
+    };
+    result += '"';
+    return result;
+  };
+
+  void write_json(std::ostream& out, const std::string& generator,
+                  const long nrows, const long ncols, const long nonzeros,
+                  const std::size_t bytes, const std::vector<Result>& results)
+  {
+    out << std::setprecision(6)
+        << "{\n"
+        << "  \"version\": " << quote(PACKAGE_VERSION) << ",\n"
+        << "  \"input\": {\"generator\": " << quote(generator)
+        << ", \"rows\": " << nrows << ", \"columns\": " << ncols
+        << ", \"nonzeros\": " << nonzeros << ", \"bytes\": " << bytes << "},\n"
+        << "  \"repeat\": " << repeat_ << ",\n"
+        << "  \"results\": [\n";
+    for (std::vector<Result>::const_iterator r = results.begin(); r != results.end(); ++r) {
+      out << "    {\"name\": " << quote(r->name)
+          << ", \"command\": " << quote(r->command)
+          << ", \"status\": " << r->status;
+      if (0 == r->status) {
+        out << ", \"median_seconds\": " << r->median
+            << ", \"nonzeros_per_second\": " << (r->nonzeros / r->median)
+            << ", \"megabytes_per_second\": " << (r->bytes / r->median / 1e6)
+            << ", \"peak_rss_kb\": " << r->peak_rss_kb
+            << ", \"seconds\": [";
+        for (std::size_t k = 0; k < r->seconds.size(); ++k)
+          out << (k > 0? ", " : "") << r->seconds[k];
+        out << "]";
+        if (r->baseline > 0)
+          out << ", \"baseline_median_seconds\": " << r->baseline
+              << ", \"regression\": " << (is_regression(*r)? "true" : "false");
+      };
+      out << "}" << (r+1 != results.end()? "," : "") << "\n";
+    };
+    out << "  ]\n"
+        << "}" << std::endl;
+  };
+};
+
+
+SMASTO_MAIN("bench", BenchProgram)
@@ -0,0 +1,1048 @@
+/**
+ * @file   common.cpp
+ *
+ * Non-template parts of the SMaSTo library: in-process pipeline
+ * queues and the command-line driver of the tools.
+ *
+ * @author  riccardo.murri@gmail.com, agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2010-2013 riccardo.murri@gmail.com.  All rights reserved.
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * See http://www.gnu.org/licenses/gpl.html for licence details.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <cctype>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+// ---- is_zero ----
+
+template<>
+bool is_zero< typename std::string >(const std::string& value)
+{
+  static const std::string exponent_sep("eEfFgG");
+
+  // shortcuts
+  if ("0" == value or "0.0" == value)
+    return true;
+  // else, examine string to see if it matches any sensible
+  // representation of "0"
+  std::string::const_iterator c = value.begin();
+  // skip leading whitespace
+  while (std::isspace(*c)) ++c;
+  // ignore optional sign
+  if ('-' == *c or '+' == *c) ++c;
+  // any number of zeroes is OK
+  while ('0' == *c) ++c;
+  if (value.end() == c)
+    return true;
+  // if string continues, zeroes must be followed by a decimal dot '.'
+  // or a rational slash '/' or the exponent of a scientific notation number
+  if ('/' == *c)
+    // rational number: it is zero because the denominator is zero
+    return true;
+  else if (exponent_sep.find(*c) != std::string::npos)
+    // sci notation: zero because the mantissa is zero
+    return true;
+  else if ('.' == *c) {
+    // more zeroes to follow
+    while ('0' == *c) ++c;
+    return (value.end() == c
+            or '/' == *c
+            or exponent_sep.find(*c) != std::string::npos);
+  }
+  else
+    return false;
+};
+
+
+// ---- modular arithmetic ----
+
+PrimeField::PrimeField(const unsigned long long p)
+  : p_(p), mu_(0), lazy_(1)
+{
+  if (p < 2 or p > std::numeric_limits<uint32_t>::max()) {
+    std::ostringstream msg;
+    msg << "Modulus must be at least 2 and less than 2^32, but it is " << p << ".";
+    throw std::runtime_error(msg.str());
+  };
+  // p < 2^32, so trial division up to 2^16 is enough
+  for (unsigned long long d = 2; d * d <= p; ++d)
+    if (0 == p % d) {
+      std::ostringstream msg;
+      msg << "Modulus " << p << " is not a prime number.";
+      throw std::runtime_error(msg.str());
+    };
+  // floor((2^64-1) / p) differs from 2^64/p by less than 1, so, for
+  // products x < 2^64, the Barrett quotient is off by at most 1
+  mu_ = ~static_cast<uint64_t>(0) / p_;
+  const uint64_t square = static_cast<uint64_t>(p_ - 1) * (p_ - 1);
+  lazy_ = std::min<uint64_t>((~static_cast<uint64_t>(0) - (p_ - 1)) / square, 1 << 20);
+};
+
+
+uint32_t
+PrimeField::inverse(const uint32_t a) const
+{
+  // extended Euclid's algorithm: `s * a` is `r` modulo p
+  long long r0 = p_, r1 = a;
+  long long s0 = 0, s1 = 1;
+  while (0 != r1) {
+    const long long q = r0 / r1;
+    long long t = r0 - q * r1;
+    r0 = r1;
+    r1 = t;
+    t = s0 - q * s1;
+    s0 = s1;
+    s1 = t;
+  };
+  if (1 != r0) {
+    std::ostringstream msg;
+    msg << "Cannot divide by " << a << " modulo " << p_ << ".";
+    throw std::runtime_error(msg.str());
+  };
+  return reduce(s0);
+};
+
+
+/// field for `ModularValue` arithmetic in each thread
+static thread_local const PrimeField* current_field = NULL;
+
+const PrimeField*
+PrimeField::current()
+{
+  return current_field;
+};
+
+void
+PrimeField::set_current(const PrimeField* field)
+{
+  current_field = field;
+};
+
+
+ModularValue::ModularValue(const long double x)
+{
+  if (not (std::fabs(x) < 9.2e18L) or x != std::floor(x)) {
+    std::ostringstream msg;
+    msg << "Value " << x << " is not an integer, so it cannot be reduced modulo p.";
+    throw std::runtime_error(msg.str());
+  };
+  value = PrimeField::current()->reduce(static_cast<long long>(x));
+};
+
+
+// ---- value types ----
+
+value_type
+parse_value_type(const std::string& name)
+{
+  if ("auto" == name)
+    return AUTO_VALUE_TYPE;
+  else if ("int64" == name)
+    return INT64_VALUE_TYPE;
+  else if ("float" == name)
+    return FLOAT_VALUE_TYPE;
+  else if ("double" == name)
+    return DOUBLE_VALUE_TYPE;
+  else if ("long-double" == name or "long double" == name)
+    return LONG_DOUBLE_VALUE_TYPE;
+  std::ostringstream msg;
+  msg << "Unknown value type '" << name << "':"
+      << " must be one of int64, float, double, long-double, or auto.";
+  throw std::runtime_error(msg.str());
+};
+
+
+value_type
+detect_value_type(std::istream& input, long double* largest)
+{
+  const std::streampos start = input.tellg();
+  if (std::streampos(-1) == start) {
+    input.clear();
+    return LONG_DOUBLE_VALUE_TYPE;
+  };
+
+  // scan whitespace-separated words: three in the header (plus an
+  // optional order marker), then three per entry, the last one being
+  // the value
+  bool integer = true;
+  long long word = 0;
+  int digits = 0;
+  // absolute value of the current word, and the largest entry value
+  uint64_t magnitude = 0;
+  uint64_t max_magnitude = 0;
+  bool in_word = false;
+  bool bad_word = false;
+  bool alpha_word = false;
+  char buf[65536];
+  while (integer) {
+    input.read(buf, sizeof(buf));
+    const std::streamsize n = input.gcount();
+    // at the end of the stream, a final blank ends the last word
+    const bool last = not input;
+    for (std::streamsize k = 0; k < n + (last? 1 : 0); ++k) {
+      const char c = (k < n? buf[k] : ' ');
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        if (in_word) {
+          in_word = false;
+          if (3 == word and alpha_word)
+            continue;
+          if (word >= 3 and 2 == word % 3 and (bad_word or 0 == digits or digits > 18)) {
+            integer = false;
+            break;
+          };
+          if (word >= 3 and 2 == word % 3 and magnitude > max_magnitude)
+            max_magnitude = magnitude;
+          ++word;
+        };
+        continue;
+      };
+      if (not in_word) {
+        in_word = true;
+        bad_word = false;
+        alpha_word = std::isalpha(static_cast<unsigned char>(c));
+        digits = 0;
+        magnitude = 0;
+        if ('-' == c or '+' == c)
+          continue;
+      };
+      if (std::isdigit(static_cast<unsigned char>(c))) {
+        ++digits;
+        // at most 18 digits are accepted, so this cannot overflow
+        if (digits <= 18)
+          magnitude = 10 * magnitude + (c - '0');
+      }
+      else
+        bad_word = true;
+    };
+    if (last)
+      break;
+  };
+
+  input.clear();
+  input.seekg(start);
+  if (input.fail())
+    throw std::runtime_error("Cannot rewind INPUT stream after checking its value type.");
+  if (NULL != largest)
+    *largest = static_cast<long double>(max_magnitude);
+  return (integer? INT64_VALUE_TYPE : LONG_DOUBLE_VALUE_TYPE);
+};
+
+
+// ---- Tracer ----
+
+std::atomic<bool> Tracer::enabled_(false);
+
+/** One recorded trace event. */
+struct TraceEvent
+{
+  /// event type: 'X' (complete span) or 'C' (counter)
+  char phase;
+  const char* name;
+  int64_t begin;
+  /// duration of a span, or value of a counter
+  int64_t value;
+  /// counter instance number
+  long id;
+};
+
+/** Events recorded by one thread; only the owning thread appends. */
+struct TraceBuffer
+{
+  long tid;
+  std::string name;
+  std::vector<TraceEvent> events;
+};
+
+/// global tracer state; guarded by `trace_lock`, except for the
+/// per-thread buffers, which their threads fill in without locking
+static std::mutex trace_lock;
+static std::vector<TraceBuffer*> trace_buffers;
+static std::vector<std::string> trace_files;
+static int trace_depth = 0;
+static unsigned trace_generation = 0;
+static std::chrono::steady_clock::time_point trace_origin;
+
+/// buffer of the calling thread, valid if `generation` is current
+static thread_local TraceBuffer* thread_buffer = NULL;
+static thread_local unsigned thread_generation = 0;
+
+
+/// Return the calling thread's buffer, registering a new one if needed.
+static TraceBuffer*
+trace_buffer()
+{
+  if (NULL == thread_buffer or thread_generation != trace_generation) {
+    std::lock_guard<std::mutex> guard(trace_lock);
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->tid = trace_buffers.size() + 1;
+    buffer->events.reserve(1024);
+    trace_buffers.push_back(buffer);
+    thread_buffer = buffer;
+    thread_generation = trace_generation;
+  };
+  return thread_buffer;
+};
+
+
+/// Return `text` quoted as a JSON string.
+static std::string
+json_string(const std::string& text)
+{
+  std::string result("\"");
+  for (std::string::const_iterator c = text.begin(); c != text.end(); ++c) {
+    if ('"' == *c or '\\' == *c)
+      result += '\\';
+    result += *c;
+  };
+  result += '"';
+  return result;
+};
+
+
+void
+Tracer::start(const std::string& filename)
+{
+  std::lock_guard<std::mutex> guard(trace_lock);
+  if (0 == trace_depth++) {
+    ++trace_generation;
+    trace_origin = std::chrono::steady_clock::now();
+    enabled_.store(true);
+  };
+  trace_files.push_back(filename);
+};
+
+
+void
+Tracer::stop()
+{
+  std::vector<TraceBuffer*> buffers;
+  std::vector<std::string> files;
+  {
+    std::lock_guard<std::mutex> guard(trace_lock);
+    if (trace_depth <= 0 or 0 != --trace_depth)
+      return;
+    enabled_.store(false);
+    buffers.swap(trace_buffers);
+    files.swap(trace_files);
+  };
+
+  // all traced programs are done, so no thread is appending events
+  const long pid = getpid();
+  for (std::vector<std::string>::const_iterator f = files.begin(); f != files.end(); ++f) {
+    errno = 0;
+    std::ofstream out(f->c_str());
+    out << "{\"traceEvents\": [\n";
+    bool first = true;
+    for (std::vector<TraceBuffer*>::const_iterator b = buffers.begin(); b != buffers.end(); ++b) {
+      const TraceBuffer& buffer = **b;
+      out << (first? "" : ",\n")
+          << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+          << ", \"tid\": " << buffer.tid << ", \"args\": {\"name\": "
+          << json_string(buffer.name.empty()? "worker" : buffer.name) << "}}";
+      first = false;
+      for (std::vector<TraceEvent>::const_iterator e = buffer.events.begin();
+           e != buffer.events.end(); ++e) {
+        // timestamps are in microseconds
+        out << ",\n{\"name\": " << json_string(e->name)
+            << ", \"ph\": \"" << e->phase << "\", \"pid\": " << pid
+            << ", \"tid\": " << buffer.tid
+            << ", \"ts\": " << (e->begin / 1000) << '.' << std::setw(3) << std::setfill('0')
+            << (e->begin % 1000) << std::setfill(' ');
+        if ('X' == e->phase)
+          out << ", \"dur\": " << (e->value / 1000) << '.' << std::setw(3) << std::setfill('0')
+              << (e->value % 1000) << std::setfill(' ');
+        else
+          out << ", \"id\": " << e->id << ", \"args\": {\"depth\": " << e->value << "}";
+        out << "}";
+      };
+    };
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+    if (not out.good())
+      std::cerr << "ERROR: Cannot write trace to file '" << *f << "': "
+                << strerror(errno) << "." << std::endl;
+  };
+  for (std::vector<TraceBuffer*>::iterator b = buffers.begin(); b != buffers.end(); ++b)
+    delete *b;
+};
+
+
+int64_t
+Tracer::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now() - trace_origin).count();
+};
+
+
+void
+Tracer::span(const char* name, const int64_t begin, const int64_t end)
+{
+  if (not enabled())
+    return;
+  TraceEvent event = { 'X', name, begin, end - begin, 0 };
+  trace_buffer()->events.push_back(event);
+};
+
+
+void
+Tracer::counter(const char* name, const long id, const long value)
+{
+  if (not enabled())
+    return;
+  TraceEvent event = { 'C', name, now(), value, id };
+  trace_buffer()->events.push_back(event);
+};
+
+
+void
+Tracer::thread_name(const std::string& name)
+{
+  if (not enabled())
+    return;
+  trace_buffer()->name = name;
+};
+
+
+// ---- EntryQueue ----
+
+/// source of queue instance numbers, for tracing
+static std::atomic<long> queue_count(0);
+
+
+EntryQueue::EntryQueue(const std::size_t capacity)
+  : capacity_(capacity), id_(++queue_count), batches_(),
+    ended_(false), cancelled_(false)
+{
+  // nothing to do
+};
+
+
+void
+EntryQueue::push(EntryBatch& batch)
+{
+  std::unique_lock<std::mutex> guard(lock_);
+  if (batches_.size() >= capacity_ and not cancelled_) {
+    TraceSpan span("wait (queue full)");
+    while (batches_.size() >= capacity_ and not cancelled_)
+      not_full_.wait(guard);
+  };
+  if (cancelled_)
+    throw std::runtime_error("Output stream closed by the next pipeline stage.");
+  if (EntryBatch::END == batch.kind or EntryBatch::ABORT == batch.kind)
+    ended_ = true;
+  batches_.push_back(EntryBatch());
+  batches_.back().swap(batch);
+  batch.clear();
+  Tracer::counter("queue", id_, batches_.size());
+  not_empty_.notify_one();
+};
+
+
+void
+EntryQueue::pop(EntryBatch& batch)
+{
+  std::unique_lock<std::mutex> guard(lock_);
+  if (batches_.empty()) {
+    TraceSpan span("wait (queue empty)");
+    while (batches_.empty())
+      not_empty_.wait(guard);
+  };
+  batch.swap(batches_.front());
+  // keep the end marker, so that later reads see it too
+  if (EntryBatch::END == batch.kind or EntryBatch::ABORT == batch.kind)
+    batches_.front().kind = batch.kind;
+  else
+    batches_.pop_front();
+  Tracer::counter("queue", id_, batches_.size());
+  not_full_.notify_one();
+};
+
+
+EntryBatch::kind_t
+EntryQueue::peek()
+{
+  std::unique_lock<std::mutex> guard(lock_);
+  while (batches_.empty())
+    not_empty_.wait(guard);
+  return batches_.front().kind;
+};
+
+
+void
+EntryQueue::finish(const bool ok)
+{
+  std::unique_lock<std::mutex> guard(lock_);
+  if (ended_)
+    return;
+  ended_ = true;
+  // the end marker does not count against the capacity, so that a
+  // failing producer never blocks here
+  batches_.push_back(EntryBatch());
+  batches_.back().kind = (ok? EntryBatch::END : EntryBatch::ABORT);
+  not_empty_.notify_one();
+};
+
+
+void
+EntryQueue::cancel()
+{
+  std::unique_lock<std::mutex> guard(lock_);
+  cancelled_ = true;
+  not_full_.notify_all();
+};
+
+
+QueueInputBuffer::int_type
+QueueInputBuffer::underflow()
+{
+  while (gptr() == egptr()) {
+    if (at_end_)
+      return traits_type::eof();
+    EntryBatch batch;
+    queue_.pop(batch);
+    text_.clear();
+    switch (batch.kind) {
+    case EntryBatch::HEADER:
+      {
+        std::ostringstream header;
+        header << batch.nrows << " " << batch.ncols << " M";
+        if (ROW_MAJOR_ORDER == batch.order)
+          header << " canonical=row";
+        else if (COLUMN_MAJOR_ORDER == batch.order)
+          header << " canonical=column";
+        header << '\n';
+        text_ = header.str();
+        format_ = batch.format;
+        matrix_ = true;
+        break;
+      };
+    case EntryBatch::ENTRIES:
+      for (std::size_t k = 0; k < batch.size(); ++k) {
+        append_integer(text_, batch.rows[k]);
+        text_ += ' ';
+        append_integer(text_, batch.columns[k]);
+        text_ += ' ';
+        if (batch.texts.empty())
+          append_value(text_, batch.numbers[k], format_);
+        else
+          text_ += batch.texts[k];
+        text_ += '\n';
+      };
+      break;
+    case EntryBatch::TEXT:
+      text_.swap(batch.text);
+      break;
+    case EntryBatch::END:
+    case EntryBatch::ABORT:
+      if (matrix_)
+        text_ = "0 0 0\n";
+      at_end_ = true;
+      break;
+    };
+    if (not text_.empty())
+      setg(&text_[0], &text_[0], &text_[0] + text_.size());
+  };
+  return traits_type::to_int_type(*gptr());
+};
+
+
+// ---- RunStats ----
+
+/// statistics collector of the program running in each thread
+static thread_local RunStats* current_stats = NULL;
+
+
+RunStats*
+RunStats::current()
+{
+  return current_stats;
+};
+
+
+void
+RunStats::set_current(RunStats* stats)
+{
+  current_stats = stats;
+};
+
+
+RunStats::RunStats()
+  : entries_in(0), entries_out(0), bytes_in(0), bytes_out(0),
+    phase_(COMPUTE), last_()
+{
+  for (int p = 0; p < NPHASES; ++p)
+    seconds[p] = 0;
+};
+
+
+void
+RunStats::start()
+{
+  last_ = std::chrono::steady_clock::now();
+  phase_ = COMPUTE;
+};
+
+
+void
+RunStats::stop()
+{
+  enter(COMPUTE);
+};
+
+
+/// Return the peak resident set size of this process, in kilobytes.
+static long
+peak_rss_kb()
+{
+  struct rusage usage;
+  if (0 != getrusage(RUSAGE_SELF, &usage))
+    return -1;
+#ifdef __APPLE__
+  // macOS reports bytes
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+};
+
+
+static const char* const phase_names[] = { "open", "read", "compute", "write", "close" };
+
+
+void
+RunStats::report(std::ostream& out, const std::string& name) const
+{
+  double total = 0;
+  for (int p = 0; p < NPHASES; ++p)
+    total += seconds[p];
+  const long long entries = std::max(entries_in, entries_out);
+  const long long bytes = std::max(0LL, bytes_in) + bytes_out;
+
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(3);
+  line << name << ": stats: total " << total << " s";
+  for (int p = 0; p < NPHASES; ++p)
+    line << ", " << phase_names[p] << " " << seconds[p] << " s";
+  line << "\n" << name << ": stats: "
+       << entries_in << " entries in, " << entries_out << " entries out";
+  if (total > 0)
+    line << " (" << std::setprecision(0) << (entries / total) << " entries/s)";
+  line << "; ";
+  if (bytes_in >= 0)
+    line << bytes_in;
+  else
+    line << "unknown";
+  line << " bytes in, " << bytes_out << " bytes out";
+  if (total > 0)
+    line << " (" << std::setprecision(1) << (bytes / total / 1e6) << " MB/s)";
+  line << "; peak RSS " << peak_rss_kb() << " kB";
+  out << line.str() << std::endl;
+};
+
+
+void
+RunStats::write_json(std::ostream& out, const std::string& name) const
+{
+  double total = 0;
+  for (int p = 0; p < NPHASES; ++p)
+    total += seconds[p];
+  const long long entries = std::max(entries_in, entries_out);
+  const long long bytes = std::max(0LL, bytes_in) + bytes_out;
+
+  out << std::setprecision(6)
+      << "{\"program\": \"" << name << "\", \"seconds\": {\"total\": " << total;
+  for (int p = 0; p < NPHASES; ++p)
+    out << ", \"" << phase_names[p] << "\": " << seconds[p];
+  out << "}, \"entries_in\": " << entries_in
+      << ", \"entries_out\": " << entries_out
+      << ", \"bytes_in\": " << bytes_in
+      << ", \"bytes_out\": " << bytes_out
+      << ", \"entries_per_second\": " << (total > 0? entries / total : 0)
+      << ", \"megabytes_per_second\": " << (total > 0? bytes / total / 1e6 : 0)
+      << ", \"peak_rss_kb\": " << peak_rss_kb()
+      << "}" << std::endl;
+};
+
+
+// ---- FilterProgram ----
+
+FilterProgram::FilterProgram()
+  : description(),
+    input_(std::cin), output_(std::cout),
+    options_(), optstring_(),
+    notation_(DEFAULT_NOTATION), precision_(-1),
+    argc_(0), argv_(NULL), name_(), error_(), trace_(false),
+    stats_(false), stats_file_()
+{
+  assert(options_.empty());
+
+  // end marker for getopt_long
+  struct option opt0;
+  opt0.name = NULL;
+  opt0.has_arg = 0;
+  opt0.flag = NULL;
+  opt0.val = 0;
+  options_.push_back(opt0);
+
+  // common options
+  add_option('h', "help",    no_argument, "Print help text.");
+  add_option('V', "version", no_argument, "Print version string.");
+  add_option('i', "input",   required_argument, "Read input matrix from file ARG.");
+  add_option('o', "output",  required_argument, "Write output matrix to file ARG.");
+  add_option('p', "precision", required_argument, "Set number of significant digits for printing matrix entry values.");
+  add_option('E', "scientific", no_argument, "Output matrix entry values using scientifc notation.");
+  add_option('F', "fixed",   no_argument, "Output matrix entry values using fixed notation.");
+  add_option('G', "default", no_argument, "Choose fixed or scientific notation based on how large a value is.");
+  add_option('T', "trace",   required_argument, "Record a timeline of the work done by each thread, and write it to file ARG in Chrome trace-event format.");
+  add_option('S', "stats",   optional_argument, "Print time spent in each phase, throughput and peak memory usage to standard error; or, with ARG, write them as JSON to file ARG.");
+};
+
+
+FilterProgram::~FilterProgram()
+{
+  // write the trace when the last traced program is done
+  if (trace_)
+    Tracer::stop();
+
+  // free up memory used by the long options
+        for (std::vector<struct option>::iterator it = options_.begin();
+             it != options_.end();
+             ++it)
+          {
+            free(const_cast<char*>(it->name));
+          };
+};
+
+
+void
+FilterProgram::add_option(const char short_name,
+                          const std::string& long_name,
+                          int has_arg,
+                          const std::string& description)
+{
+  struct option lopt;
+  lopt.name = strdup(long_name.c_str());
+  lopt.has_arg = has_arg;
+  lopt.flag = NULL;
+  lopt.val = short_name;
+  options_.insert(options_.begin(), lopt);
+
+  std::ostringstream sopt;
+  sopt << short_name;
+  if (required_argument == has_arg)
+    sopt << ":";
+  else if (optional_argument == has_arg)
+    sopt << "::";
+  optstring_ += sopt.str();
+
+  option_help_[short_name] = description;
+};
+
+
+void
+FilterProgram::copy_options(const FilterProgram& other)
+{
+  description = other.description;
+  // `add_option` inserts at the front, so go backwards to keep the order
+  for (std::vector<struct option>::const_reverse_iterator it = other.options_.rbegin() + 1;
+       it != other.options_.rend();
+       ++it)
+    {
+      if (option_help_.find(it->val) != option_help_.end())
+        continue;
+      std::map<char, std::string>::const_iterator help = other.option_help_.find(it->val);
+      add_option(it->val, it->name, it->has_arg,
+                 (help != other.option_help_.end()? help->second : ""));
+    };
+};
+
+
+void
+FilterProgram::set_input(const std::string& filename)
+{
+  if (filename == "-") {
+    input_ = std::cin;
+    return;
+  };
+  errno = 0;
+  std::ifstream* input = new std::ifstream(filename.c_str());
+  if (not input->good()) {
+    std::ostringstream msg;
+    msg << "Cannot open input file '" << filename << "': "
+        << strerror(errno) << ".";
+    throw std::runtime_error(msg.str());
+  };
+  input_ = input;
+};
+
+
+void
+FilterProgram::set_output(const std::string& filename)
+{
+  if (filename == "-") {
+    output_ = std::cout;
+    return;
+  };
+  errno = 0;
+  std::ofstream* output = new std::ofstream(filename.c_str());
+  if (not output->good()) {
+    std::ostringstream msg;
+    msg << "Cannot open output file '" << filename << "': "
+        << strerror(errno) << ".";
+    throw std::runtime_error(msg.str());
+  };
+  output_ = output;
+};
+
+
+void
+FilterProgram::set_output_format(entry_format notation, const int precision)
+{
+  // set output format
+  switch(notation) {
+  case DEFAULT_NOTATION:    output_->unsetf(std::ios_base::floatfield); break;
+  case FIXED_NOTATION:      output_->setf(std::ios_base::fixed); break;
+  case SCIENTIFIC_NOTATION: output_->setf(std::ios_base::scientific); break;
+  };
+  if (precision >= 0)
+    output_->precision(precision);
+};
+
+
+int
+FilterProgram::main(int argc, char** argv)
+{
+  const int exitcode = setup(argc, argv);
+  if (exitcode >= 0)
+    return exitcode;
+  return execute();
+};
+
+
+int
+FilterProgram::setup(int argc, char** argv)
+{
+  if (argc < 1) {
+    std::cerr << "Type '" <<argv[0]<< " --help' to get usage help." << std::endl;
+    return 1;
+  };
+
+  // program name is basename of argv[0]
+  std::string invocation(argv[0]);
+  std::size_t pos = invocation.rfind('/');
+  if (0 == pos)
+    name_ = invocation;
+  else
+    name_ = invocation.substr(pos+1);
+
+  try {
+    // parse command-line arguments
+    int c;
+    try {
+      while (true) {
+        c = getopt_long(argc, argv, optstring_.c_str(),
+                        &(options_[0]), NULL);
+        if (-1 == c)
+          break;
+        else if ('h' == c) {
+          std::cout << "Usage: " << name_ << " [options] [INPUT [OUTPUT]]" << std::endl;
+          std::cout << std::endl;
+          std::cout << description << std::endl;
+          std::cout << "Options:" << std::endl;
+          for (std::vector<struct option>::const_iterator it = options_.begin();
+               it != options_.end() - 1;
+               ++it)
+            {
+              std::ostringstream optname;
+              optname << "-" << static_cast<char>(it->val)
+                      << ", --" << it->name;
+              if (required_argument == it->has_arg)
+                optname <<" ARG";
+              else if (optional_argument == it->has_arg)
+                optname << " [ARG]";
+
+              std::cout <<" "<< std::setw(23)
+                        << std::setiosflags(std::ios::left)
+                        << optname.str() << " ";
+              if (option_help_.find(it->val) != option_help_.end())
+                std::cout << option_help_[it->val];
+              std::cout << std::endl;
+            };
+          std::cout << std::endl;
+          return 0;
+        }
+        else if ('V' == c) {
+          // output conforms to GNU Coding Standards, but is kind of
+          // overkill for such a small utility package...
+          std::cout << name_ <<"(" PACKAGE_NAME ")" << PACKAGE_VERSION << std::endl;
+          std::cout <<
+            "\n"
+            "Copyright (C) 2010-2012 Riccardo Murri <riccardo.murri@gmail.com>.\n"
+            "\n"
+            "License GPLv3+: GNU GPL version 3 or later; see http://gnu.org/licenses/gpl.html\n"
+            "This is free software: you are free to change and redistribute it.\n"
+            "There is NO WARRANTY, to the extent permitted by law.\n"
+            "\n"
+            "See " PACKAGE_URL " for more information.\n"
+                    << std::endl;
+          return 0;
+        }
+        else if ('i' == c) {
+          set_input(optarg);
+        }
+        else if ('o' == c) {
+          set_output(optarg);
+        }
+        else if ('p' == c) {
+          std::istringstream(optarg) >> precision_;
+        }
+        else if ('E' == c) {
+          notation_ = DEFAULT_NOTATION;
+        }
+        else if ('F' == c) {
+          notation_ = FIXED_NOTATION;
+        }
+        else if ('G' == c) {
+          notation_ = DEFAULT_NOTATION;
+        }
+        else if ('T' == c) {
+          if (not trace_)
+            Tracer::start(optarg);
+          trace_ = true;
+        }
+        else if ('S' == c) {
+          stats_ = true;
+          stats_file_ = (NULL != optarg? optarg : "");
+        }
+        else if ('?' == c) {
+          error_ = "Unknown option.";
+          std::cerr << "Unknown option; type '" << argv[0] << " --help' to get usage help."
+                    << std::endl;
+          return 1;
+        }
+        else {
+          process_option(c, optarg);
+        };
+      }; // while(true)
+    }
+    catch(std::exception& ex) {
+      std::ostringstream msg;
+      msg << "Error in option '-" << static_cast<char>(c) << "': " << ex.what()
+          << " Type '" << argv[0] << " --help' to get usage help."
+          << std::endl;
+      throw std::runtime_error(msg.str());
+    };
+
+    // all option processing done, now parse positional arguments
+    if (optind > 0)
+      argv[optind-1] = argv[0];
+    parse_args(argc - (optind-1), &(argv[optind-1]));
+
+    // save for possible re-use in run()
+    argc_ = argc;
+    argv_ = argv;
+
+    // go on with `execute()`
+    return -1;
+  }
+  catch (std::runtime_error& ex) {
+    error_ = ex.what();
+    std::cerr << name_ << ": ERROR: " << ex.what() << std::endl;
+    return 1;
+  };
+};
+
+
+int
+FilterProgram::execute()
+{
+  if (not stats_)
+    return execute_run();
+
+  RunStats stats;
+  RunStats::set_current(&stats);
+  stats.start();
+  const int exitcode = execute_run();
+  stats.stop();
+  RunStats::set_current(NULL);
+
+  if (stats_file_.empty())
+    stats.report(std::cerr, name_);
+  else {
+    errno = 0;
+    std::ofstream out(stats_file_.c_str());
+    if (out.good())
+      stats.write_json(out, name_);
+    if (not out.good()) {
+      std::cerr << name_ << ": ERROR: Cannot write statistics to file '"
+                << stats_file_ << "': " << strerror(errno) << "." << std::endl;
+      return (0 == exitcode? 1 : exitcode);
+    };
+  };
+  return exitcode;
+};
+
+
+int
+FilterProgram::execute_run()
+{
+  Tracer::thread_name(name_);
+  TraceSpan span("run");
+  try {
+    // now do stuff
+    return run();
+  }
+  catch (std::runtime_error& ex) {
+    error_ = ex.what();
+    std::cerr << name_ << ": ERROR: " << ex.what() << std::endl;
+    return 1;
+  };
+};
+
+
+void
+FilterProgram::parse_args(int argc, char** argv)
+{
+  // set INPUT, if any
+  if (argc > 1) {
+    set_input(argv[1]);
+  };
+
+  // set OUTPUT, if any
+  if (argc > 2) {
+    set_output(argv[2]);
+  };
+  set_output_format(notation_, precision_);
+
+  // too many arguments
+  if (argc > 3) {
+    std::ostringstream msg;
+    msg << "At most two positional arguments allowed."
+        << " Type '" << argv[0] << " --help' to get usage help."
+        << std::endl;
+    throw std::runtime_error(msg.str());
+  };
+};
@@ -30,22 +30,42 @@
 #define COMMON_HPP
 
 
-#include "config.h"
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include <errno.h>
+#include <stdint.h>
 #include <getopt.h>
 
+#include <boost/config.hpp>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 
 /** Helper class to keep a pointer to std::cout or a std::ifstream
     instance, and still do the right thing when the object goes out of
@@ -60,8 +80,8 @@ public:
   pointer() { ptr_ = NULL; owned_ = false; };
   ~pointer() { release(); };
 
-  pointer<T>& operator=(T& tref) { ptr_ = &tref; owned_ = false; return *this; }
-  pointer<T>& operator=(T* tptr) { ptr_ = tptr;  owned_ = true;  return *this; }
+  pointer<T>& operator=(T& tref) { release(); ptr_ = &tref; owned_ = false; return *this; }
+  pointer<T>& operator=(T* tptr) { release(); ptr_ = tptr;  owned_ = true;  return *this; }
 
   T& operator*()  { return *ptr_; };
   T* operator->() { return ptr_; };
@@ -76,6 +96,780 @@ private:
 };
 
 
+/** How to print matrix entry values: a @c printf conversion
+    character (one of @c g, @c f, @c e, @c a) and a precision.  The
+    default-constructed object gives the same output as the std C++
+    stream defaults. */
+struct value_format
+{
+  char conversion;
+  int precision;
+
+  value_format() : conversion('g'), precision(6) { };
+
+  /** Use the same format as stream @c s would use for floating-point values. */
+  explicit value_format(const std::ios_base& s)
+    : conversion('g'), precision(s.precision())
+  {
+    const std::ios_base::fmtflags f = s.flags() & std::ios_base::floatfield;
+    if (std::ios_base::fixed == f)
+      conversion = 'f';
+    else if (std::ios_base::scientific == f)
+      conversion = 'e';
+    else if ((std::ios_base::fixed | std::ios_base::scientific) == f)
+      conversion = 'a';
+  };
+};
+
+/** Append the decimal representation of @c x to string @c buf. */
+inline void append_integer(std::string& buf, long long x)
+{
+  char digits[24];
+  char* p = digits + sizeof(digits);
+  unsigned long long u = (x < 0? -static_cast<unsigned long long>(x) : x);
+  do {
+    *--p = '0' + (u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (x < 0)
+    *--p = '-';
+  buf.append(p, digits + sizeof(digits));
+};
+
+/** Append the textual representation of @c value to string @c buf.
+    Overloaded for all value types used in matrix entries. */
+inline void append_value(std::string& buf, const std::string& value, const value_format&)
+{
+  buf += value;
+};
+
+inline void append_value(std::string& buf, const long double value, const value_format& fmt)
+{
+  // integer values are common (e.g., in pattern or stencil matrices),
+  // and `%g` prints them exactly as integers when they have at most
+  // `precision` digits: skip the slow `snprintf` in this case
+  if ('g' == fmt.conversion and std::fabs(value) < 1e18L
+      and value == static_cast<long long>(value)
+      and (value != 0 or not std::signbit(value))) {
+    const long long n = static_cast<long long>(value);
+    long long limit = 1;
+    for (int d = std::max(fmt.precision, 1); d > 0 and limit < 1000000000000000000LL; --d)
+      limit *= 10;
+    if (n < limit and n > -limit) {
+      append_integer(buf, n);
+      return;
+    };
+  };
+  char spec[8] = { '%', '.', '*', 'L', fmt.conversion, '\0' };
+  char text[64];
+  const int len = snprintf(text, sizeof(text), spec, fmt.precision, value);
+  if (len < static_cast<int>(sizeof(text)))
+    buf.append(text, len);
+  else {
+    // very large values in fixed notation
+    std::vector<char> longtext(len + 1);
+    snprintf(&longtext[0], longtext.size(), spec, fmt.precision, value);
+    buf.append(&longtext[0], len);
+  };
+};
+
+inline void append_value(std::string& buf, const double value, const value_format& fmt)
+{
+  append_value(buf, static_cast<long double>(value), fmt);
+};
+
+inline void append_value(std::string& buf, const float value, const value_format& fmt)
+{
+  append_value(buf, static_cast<long double>(value), fmt);
+};
+
+inline void append_value(std::string& buf, const long value, const value_format&)
+{
+  append_integer(buf, value);
+};
+
+inline void append_value(std::string& buf, const long long value, const value_format&)
+{
+  append_integer(buf, value);
+};
+
+inline void append_value(std::string& buf, const int value, const value_format&)
+{
+  append_integer(buf, value);
+};
+
+
+/** Element of the prime field GF(p), for some p < 2^32, held as its
+    representative in the range 0 to p-1.  Arithmetic operators work
+    in the field set with @ref PrimeField::set_current, which must be
+    the same for all values involved. */
+struct ModularValue
+{
+  uint32_t value;
+
+  ModularValue() : value(0) { };
+  /** Reduce integer @c x modulo p; throw an exception if @c x is
+      not an integer. */
+  explicit ModularValue(const long double x);
+
+  explicit operator long double() const { return value; };
+
+  bool operator==(const ModularValue& other) const { return value == other.value; };
+  bool operator!=(const ModularValue& other) const { return value != other.value; };
+  /// order of the representatives in [0, p); only used to break ties
+  bool operator<(const ModularValue& other) const { return value < other.value; };
+};
+
+
+/** Arithmetic modulo a prime p < 2^32.  Products are reduced with
+    Barrett's method, and products by a constant with Shoup's, which
+    only needs 64-bit integer multiplications and therefore works in
+    SIMD lanes: the batch operations are written so that the compiler
+    can vectorize them. */
+class PrimeField
+{
+public:
+  /** Constructor: arithmetic modulo @c p; throw an exception if @c p
+      is not a prime less than 2^32. */
+  explicit PrimeField(const unsigned long long p = 2);
+
+  /** Return the modulus p. */
+  uint32_t modulus() const { return p_; };
+
+  /** Return @c x modulo p, in the range 0 to p-1. */
+  uint32_t reduce(const long long x) const
+  {
+    const long long r = x % static_cast<long long>(p_);
+    return (r < 0? r + p_ : r);
+  };
+
+  uint32_t add(const uint32_t a, const uint32_t b) const
+  {
+    const uint64_t s = static_cast<uint64_t>(a) + b;
+    return (s >= p_? s - p_ : s);
+  };
+
+  uint32_t negate(const uint32_t a) const { return (0 == a? 0 : p_ - a); };
+
+  uint32_t multiply(const uint32_t a, const uint32_t b) const
+  {
+    return reduce_wide(static_cast<uint64_t>(a) * b);
+  };
+
+  /** Return @c x modulo p, for any 64-bit @c x. */
+  uint32_t reduce_wide(const uint64_t x) const
+  {
+#ifdef __SIZEOF_INT128__
+    // Barrett: `q` is floor(x/p) or one less
+    const uint64_t q = (static_cast<unsigned __int128>(x) * mu_) >> 64;
+    const uint64_t r = x - q * p_;
+    return (r >= p_? r - p_ : r);
+#else
+    return x % p_;
+#endif
+  };
+
+  /** Return the inverse of @c a; throw an exception if there is none. */
+  uint32_t inverse(const uint32_t a) const;
+
+  /** Return the precomputed quotient floor(c * 2^32 / p) of constant
+      @c c, for use in @ref multiply_by. */
+  uint32_t shoup(const uint32_t c) const
+  {
+    return (static_cast<uint64_t>(c) << 32) / p_;
+  };
+
+  /** Return @c a times constant @c c, where @c cq = shoup(c). */
+  uint32_t multiply_by(const uint32_t a, const uint32_t c, const uint32_t cq) const
+  {
+    const uint64_t q = (static_cast<uint64_t>(a) * cq) >> 32;
+    const uint64_t r = static_cast<uint64_t>(a) * c - q * p_;
+    return (r >= p_? r - p_ : r);
+  };
+
+  /** Multiply the @c n values in @c x by @c c. */
+  void scale(ModularValue* x, const std::size_t n, const ModularValue c) const
+  {
+    const uint32_t cq = shoup(c.value);
+#pragma omp simd
+    for (std::size_t k = 0; k < n; ++k)
+      x[k].value = multiply_by(x[k].value, c.value, cq);
+  };
+
+  /** Add @c a times @c x[k] to @c y[k], for @c k from 0 to @c n-1. */
+  void axpy(ModularValue* y, const ModularValue a, const ModularValue* x, const std::size_t n) const
+  {
+    const uint32_t aq = shoup(a.value);
+#pragma omp simd
+    for (std::size_t k = 0; k < n; ++k)
+      y[k].value = add(y[k].value, multiply_by(x[k].value, a.value, aq));
+  };
+
+  /** Add to @c y[k] the sum of @c a[l] times @c x[l][k], for @c l
+      from 0 to @c m-1 and @c k from 0 to @c n-1.  Products are summed
+      in 64-bit integers, which are reduced modulo p only when one
+      more product could overflow them; for word-size p, this takes
+      one multiplication per product instead of the two of @ref axpy. */
+  void axpy_many(ModularValue* y, const ModularValue* a, const ModularValue* const* x,
+                 const std::size_t m, const std::size_t n) const
+  {
+    uint64_t sum[256];
+    for (std::size_t k0 = 0; k0 < n; k0 += 256) {
+      const std::size_t len = std::min<std::size_t>(256, n - k0);
+      for (std::size_t k = 0; k < len; ++k)
+        sum[k] = y[k0 + k].value;
+      std::size_t terms = 0;
+      for (std::size_t l = 0; l < m; ++l) {
+        if (0 == a[l].value)
+          continue;
+        if (terms == lazy_) {
+          for (std::size_t k = 0; k < len; ++k)
+            sum[k] = reduce_wide(sum[k]);
+          terms = 0;
+        };
+        const uint64_t f = a[l].value;
+        const ModularValue* const xl = x[l] + k0;
+#pragma omp simd
+        for (std::size_t k = 0; k < len; ++k)
+          sum[k] += f * xl[k].value;
+        ++terms;
+      };
+      for (std::size_t k = 0; k < len; ++k)
+        y[k0 + k].value = reduce_wide(sum[k]);
+    };
+  };
+
+  /** Return the field used by @ref ModularValue arithmetic in the
+      calling thread, or @c NULL if none. */
+  static const PrimeField* current();
+  /** Set the field for @ref ModularValue arithmetic in the calling thread. */
+  static void set_current(const PrimeField* field);
+
+private:
+  uint32_t p_;
+  /// floor(2^64 / p), for Barrett reduction
+  uint64_t mu_;
+  /// number of products (p-1)^2 that can be added to a number less
+  /// than p without overflowing 64 bits
+  std::size_t lazy_;
+};
+
+
+inline ModularValue operator+(const ModularValue& a, const ModularValue& b)
+{
+  ModularValue result;
+  result.value = PrimeField::current()->add(a.value, b.value);
+  return result;
+};
+
+inline ModularValue operator-(const ModularValue& a, const ModularValue& b)
+{
+  const PrimeField& field = *PrimeField::current();
+  ModularValue result;
+  result.value = field.add(a.value, field.negate(b.value));
+  return result;
+};
+
+inline ModularValue operator*(const ModularValue& a, const ModularValue& b)
+{
+  ModularValue result;
+  result.value = PrimeField::current()->multiply(a.value, b.value);
+  return result;
+};
+
+inline ModularValue operator/(const ModularValue& a, const ModularValue& b)
+{
+  const PrimeField& field = *PrimeField::current();
+  ModularValue result;
+  result.value = field.multiply(a.value, field.inverse(b.value));
+  return result;
+};
+
+/** Read an integer and reduce it modulo p. */
+inline std::istream& operator>>(std::istream& input, ModularValue& x)
+{
+  long long n;
+  if (input >> n)
+    x.value = PrimeField::current()->reduce(n);
+  return input;
+};
+
+inline std::ostream& operator<<(std::ostream& output, const ModularValue& x)
+{
+  return output << x.value;
+};
+
+inline void append_value(std::string& buf, const ModularValue& value, const value_format&)
+{
+  append_integer(buf, value.value);
+};
+
+
+/** Timeline of the work done by each thread, written as Chrome
+    trace-event JSON (viewable with Perfetto or `chrome://tracing`);
+    see option `--trace`.  Each thread records events into its own
+    buffer, without locking; buffers are collected and written out
+    when the last program that requested tracing is done.  When
+    tracing is off, recording an event costs a single test. */
+class Tracer
+{
+public:
+  /** Return true if events are being recorded. */
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); };
+
+  /** Start recording events, if not already done, and write them to
+      file @c filename when the matching @ref stop is called.  Calls
+      can be nested; the file is written by the outermost @ref stop. */
+  static void start(const std::string& filename);
+  /** Stop recording events and write them out, if this matches the
+      outermost @ref start. */
+  static void stop();
+
+  /** Return nanoseconds elapsed since tracing started. */
+  static int64_t now();
+
+  /** Record a span of work named @c name, from @c begin to @c end
+      (as returned by @ref now) in the calling thread.  The name must
+      be a string constant. */
+  static void span(const char* name, const int64_t begin, const int64_t end);
+  /** Record value @c value of the counter named @c name, with
+      instance number @c id. */
+  static void counter(const char* name, const long id, const long value);
+  /** Set the name under which the calling thread is displayed. */
+  static void thread_name(const std::string& name);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+
+/** Record the time spent in the enclosing scope as a span in the
+    trace.  The name must be a string constant. */
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char* name)
+    : name_(name), begin_(Tracer::enabled()? Tracer::now() : -1) { };
+
+  ~TraceSpan()
+  {
+    if (begin_ >= 0)
+      Tracer::span(name_, begin_, Tracer::now());
+  };
+
+private:
+  const char* name_;
+  const int64_t begin_;
+};
+
+
+/** Order of the entries in a matrix stream.  A stream is in row-major
+    (resp. column-major) order if its entries are sorted by row and
+    then column (resp. by column and then row), with no duplicate
+    coordinates and no explicit zeroes; tools can then take faster
+    paths, e.g., stop reading after the last row they need.  The order
+    is declared by a word after the `M` on the SMS header line:
+    `canonical=row` or `canonical=column`. */
+typedef enum { UNSORTED_ORDER, ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER } entry_order;
+
+
+/** A batch of matrix entries (or other data) passed between the
+    stages of an in-process pipeline, see @ref EntryQueue.  Entry
+    values are carried as numbers or as text, depending on the value
+    type used by the stage that produced them. */
+struct EntryBatch
+{
+  typedef enum {
+    /// matrix dimensions and value format; starts a matrix stream
+    HEADER,
+    /// matrix entries in `rows`, `columns` and `numbers` or `texts`
+    ENTRIES,
+    /// raw output text; after a HEADER, lines of matrix entries
+    TEXT,
+    /// end of data
+    END,
+    /// end of data, because the producing stage failed
+    ABORT
+  } kind_t;
+
+  kind_t kind;
+
+  long nrows;
+  long ncols;
+  value_format format;
+  entry_order order;
+
+  std::vector<long> rows;
+  std::vector<long> columns;
+  std::vector<long double> numbers;
+  std::vector<std::string> texts;
+
+  std::string text;
+
+  EntryBatch() : kind(ENTRIES), nrows(0), ncols(0), format(), order(UNSORTED_ORDER),
+                 rows(), columns(), numbers(), texts(), text() { };
+
+  std::size_t size() const { return rows.size(); };
+
+  void clear()
+  {
+    kind = ENTRIES;
+    rows.clear();
+    columns.clear();
+    numbers.clear();
+    texts.clear();
+    text.clear();
+  };
+
+  void swap(EntryBatch& other)
+  {
+    std::swap(kind, other.kind);
+    std::swap(nrows, other.nrows);
+    std::swap(ncols, other.ncols);
+    std::swap(format, other.format);
+    std::swap(order, other.order);
+    rows.swap(other.rows);
+    columns.swap(other.columns);
+    numbers.swap(other.numbers);
+    texts.swap(other.texts);
+    text.swap(other.text);
+  };
+};
+
+/** Throw an exception about an entry value that cannot be read as a
+    @c val_t, hinting at option `--value-type` for integer types. */
+template< typename val_t >
+void throw_bad_value()
+{
+  if (std::numeric_limits<val_t>::is_integer)
+    throw std::runtime_error("Malformed SMS stream: cannot read entry,"
+                             " or its value is not an integer;"
+                             " use '--value-type=double' for non-integer values.");
+  throw std::runtime_error("Malformed SMS stream: cannot read entry.");
+};
+
+template<>
+inline void throw_bad_value<ModularValue>()
+{
+  throw std::runtime_error("Malformed SMS stream: cannot read entry,"
+                           " or its value is not an integer;"
+                           " only integers can be reduced modulo p.");
+};
+
+/** Throw an exception about an integer entry value that overflows
+    64 bits, hinting at option `--value-type`. */
+inline void throw_integer_overflow()
+{
+  throw std::runtime_error("Integer overflow in entry value;"
+                           " use '--value-type=long-double' for values this large.");
+};
+
+/** Return @c a*b; with 64-bit integer values, throw an exception if
+    the product overflows instead of wrapping around. */
+template< typename val_t >
+inline val_t checked_multiply(const val_t& a, const val_t& b)
+{
+  return a * b;
+};
+
+template<>
+inline int64_t checked_multiply<int64_t>(const int64_t& a, const int64_t& b)
+{
+  int64_t result;
+  if (__builtin_mul_overflow(a, b, &result))
+    throw_integer_overflow();
+  return result;
+};
+
+/** Return @c a+b; with 64-bit integer values, throw an exception if
+    the sum overflows instead of wrapping around. */
+template< typename val_t >
+inline val_t checked_add(const val_t& a, const val_t& b)
+{
+  return a + b;
+};
+
+template<>
+inline int64_t checked_add<int64_t>(const int64_t& a, const int64_t& b)
+{
+  int64_t result;
+  if (__builtin_add_overflow(a, b, &result))
+    throw_integer_overflow();
+  return result;
+};
+
+/** Append value to the batch; overloaded for textual and numeric values. */
+inline void store_value(EntryBatch& batch, const std::string& value)
+{
+  batch.texts.push_back(value);
+};
+
+template< typename val_t >
+inline void store_value(EntryBatch& batch, const val_t& value)
+{
+  batch.numbers.push_back(value);
+};
+
+inline void store_value(EntryBatch& batch, const ModularValue& value)
+{
+  batch.numbers.push_back(value.value);
+};
+
+/** Set @c value from the @c k-th entry in the batch, converting between
+    numbers and text if needed.  Numbers are converted to text with the
+    format of the stage that produced them, so that the result is the
+    same as with a text pipe. */
+inline void load_value(const EntryBatch& batch, const std::size_t k,
+                       const value_format& fmt, std::string& value)
+{
+  if (batch.texts.empty()) {
+    value.clear();
+    append_value(value, batch.numbers[k], fmt);
+  }
+  else
+    value = batch.texts[k];
+};
+
+template< typename val_t >
+inline void load_value(const EntryBatch& batch, const std::size_t k,
+                       const value_format&, val_t& value)
+{
+  if (batch.texts.empty()) {
+    value = static_cast<val_t>(batch.numbers[k]);
+    if (std::numeric_limits<val_t>::is_integer
+        and static_cast<long double>(value) != batch.numbers[k])
+      throw_bad_value<val_t>();
+  }
+  else {
+    std::istringstream text(batch.texts[k]);
+    if (not (text >> value) or not (text >> std::ws).eof())
+      throw_bad_value<val_t>();
+  };
+};
+
+
+/** Bounded queue of @ref EntryBatch objects, connecting two stages
+    of an in-process pipeline running in different threads.  The
+    producer blocks when the queue is full, and the consumer blocks
+    when it is empty. */
+class EntryQueue
+{
+public:
+  explicit EntryQueue(const std::size_t capacity = 16);
+
+  /** Append a batch to the queue; the contents of @c batch are moved
+      into the queue, and @c batch is left empty.  Throw an exception
+      if the consumer has stopped reading. */
+  void push(EntryBatch& batch);
+
+  /** Move the first batch in the queue into @c batch, waiting for one
+      to be available.  After the end of data, always return an
+      END (or ABORT) batch. */
+  void pop(EntryBatch& batch);
+
+  /** Return the kind of the first batch in the queue, waiting for one
+      to be available. */
+  EntryBatch::kind_t peek();
+
+  /** Signal the end of data, if not already done with an END batch.
+      If @c ok is false, the consumer will get an ABORT batch instead. */
+  void finish(const bool ok);
+
+  /** Signal that the consumer has stopped reading. */
+  void cancel();
+
+private:
+  const std::size_t capacity_;
+  /// instance number, for tracing
+  const long id_;
+  std::deque<EntryBatch> batches_;
+  /// true after an END or ABORT batch has been queued
+  bool ended_;
+  bool cancelled_;
+
+  std::mutex lock_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+
+/** Stream buffer collecting output text into TEXT batches. */
+class QueueOutputBuffer : public std::streambuf
+{
+public:
+  explicit QueueOutputBuffer(EntryQueue& queue) : queue_(queue), text_() { };
+
+protected:
+  int_type overflow(int_type c)
+  {
+    if (not traits_type::eq_int_type(c, traits_type::eof())) {
+      text_ += traits_type::to_char_type(c);
+      if (text_.size() >= (1 << 16))
+        sync();
+    };
+    return traits_type::not_eof(c);
+  };
+
+  std::streamsize xsputn(const char* s, std::streamsize n)
+  {
+    text_.append(s, n);
+    if (text_.size() >= (1 << 16))
+      sync();
+    return n;
+  };
+
+  int sync()
+  {
+    if (not text_.empty()) {
+      EntryBatch batch;
+      batch.kind = EntryBatch::TEXT;
+      batch.text.swap(text_);
+      queue_.push(batch);
+    };
+    return 0;
+  };
+
+private:
+  EntryQueue& queue_;
+  std::string text_;
+};
+
+
+/** Stream buffer serving the contents of an @ref EntryQueue as text,
+    in SMS format if the producer sent a matrix. */
+class QueueInputBuffer : public std::streambuf
+{
+public:
+  explicit QueueInputBuffer(EntryQueue& queue)
+    : queue_(queue), text_(), format_(), matrix_(false), at_end_(false) { };
+
+protected:
+  int_type underflow();
+
+private:
+  EntryQueue& queue_;
+  std::string text_;
+  value_format format_;
+  bool matrix_;
+  bool at_end_;
+};
+
+
+/** Output stream feeding an @ref EntryQueue.  When an @ref SMSWriter
+    is opened on such a stream, it sends matrix entries as binary
+    batches instead of formatting them as text. */
+class QueueOutputStream : public std::ostream
+{
+public:
+  explicit QueueOutputStream(EntryQueue& queue)
+    : std::ostream(0), buf_(queue), queue_(queue) { rdbuf(&buf_); };
+
+  EntryQueue& queue() { return queue_; };
+
+private:
+  QueueOutputBuffer buf_;
+  EntryQueue& queue_;
+};
+
+
+/** Input stream reading from an @ref EntryQueue.  When an @ref
+    SMSReader is opened on such a stream, and the producer sends a
+    matrix, entries are taken from the binary batches directly. */
+class QueueInputStream : public std::istream
+{
+public:
+  explicit QueueInputStream(EntryQueue& queue)
+    : std::istream(0), buf_(queue), queue_(queue) { rdbuf(&buf_); };
+
+  EntryQueue& queue() { return queue_; };
+
+private:
+  QueueInputBuffer buf_;
+  EntryQueue& queue_;
+};
+
+
+/** Time spent in each phase of a program run, and amount of data
+    processed; collected when option `--stats` is given.  Time is
+    attributed to the COMPUTE phase, unless a @ref PhaseTimer is
+    active: @ref SMSReader and @ref SMSWriter use these to account for
+    opening, reading, writing and closing matrix streams.  Entries
+    written one at a time are only buffered in the caller's phase; the
+    WRITE phase starts when a full buffer or batch is passed on, so
+    that the clock is not read for every entry. */
+class RunStats
+{
+public:
+  typedef enum { OPEN, READ, COMPUTE, WRITE, CLOSE, NPHASES } phase_t;
+
+  RunStats();
+
+  /** Start timing, in the COMPUTE phase. */
+  void start();
+  /** Stop timing. */
+  void stop();
+
+  /** Switch to phase @c phase, and return the previous one. */
+  phase_t enter(const phase_t phase)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    seconds[phase_] += std::chrono::duration<double>(now - last_).count();
+    last_ = now;
+    const phase_t previous = phase_;
+    phase_ = phase;
+    return previous;
+  };
+
+  /** Print a human-readable summary to stream @c out. */
+  void report(std::ostream& out, const std::string& name) const;
+  /** Write a JSON object to stream @c out. */
+  void write_json(std::ostream& out, const std::string& name) const;
+
+  /** Return the statistics collector of the program running in the
+      calling thread, or @c NULL if statistics are not enabled. */
+  static RunStats* current();
+  /** Set the statistics collector for the calling thread. */
+  static void set_current(RunStats* stats);
+
+  /// seconds spent in each phase
+  double seconds[NPHASES];
+  /// number of matrix entries read and written
+  long long entries_in;
+  long long entries_out;
+  /// number of bytes read and written, or -1 if unknown
+  long long bytes_in;
+  long long bytes_out;
+
+private:
+  phase_t phase_;
+  std::chrono::steady_clock::time_point last_;
+};
+
+
+/** Attribute the time spent in the enclosing scope to the given
+    phase.  Does nothing if @c stats is @c NULL. */
+class PhaseTimer
+{
+public:
+  PhaseTimer(RunStats* stats, const RunStats::phase_t phase)
+    : stats_(stats), previous_(RunStats::COMPUTE)
+  {
+    if (NULL != stats_)
+      previous_ = stats_->enter(phase);
+  };
+
+  ~PhaseTimer()
+  {
+    if (NULL != stats_)
+      stats_->enter(previous_);
+  };
+
+private:
+  RunStats* stats_;
+  RunStats::phase_t previous_;
+};
+
+
 /** Abstract base class for implementing an SMS-format file processor.
     Derived classes need implement the @c process_entry method, which
     is invoked once for each value read from the SMS stream. */
@@ -104,6 +898,9 @@ public:
   coord_t rows() const { return nrows_; };
   /** Return number of matrix columns. (As read from the most recently-opened stream.) */
   coord_t columns() const { return ncols_; };
+  /** Return the order of entries declared in the header of the most
+      recently-opened stream; @c UNSORTED_ORDER if none was. */
+  entry_order order() const { return order_; };
 
   /** Finish reading matrix entries from the given stream. */
   void close();
@@ -115,13 +912,54 @@ protected:
   /** Called by @ref read() when it hits the end-of-stream marker. */
   virtual void done() { };
 
+  /** Make @ref read() return after the current entry has been
+      processed, without reading the rest of the stream.  Has no
+      effect when reading from an in-process pipeline, where the
+      remaining entries must be consumed anyway. */
+  void stop() { stopped_ = true; };
+
   pointer<std::istream> input_;
   coord_t nrows_;
   coord_t ncols_;
+  entry_order order_;
+
+  /// when reading from an in-process pipeline: the queue to take
+  /// entries from, and the format for converting numbers to text
+  EntryQueue* queue_;
+  value_format queue_format_;
+
+  /// where to account for time and data, if `--stats` is enabled
+  RunStats* stats_;
+  /// stream position after the header, if known
+  std::streamoff start_;
+  /// set by `stop()`
+  bool stopped_;
+
+  /// Read the optional order marker at the end of the header line.
+  void read_order();
+  /// Throw an exception if entry `(i,j)` is outside the matrix.  Only
+  /// this cheap check is done on every entry; see `sms-verify` for a
+  /// thorough one.
+  void check_bounds(const coord_t i, const coord_t j) const
+  {
+    if (i < 1 or i > nrows_ or j < 1 or j > ncols_) {
+      std::ostringstream msg;
+      msg << "Entry (" << i << "," << j << ") is outside matrix bounds.";
+      throw std::runtime_error(msg.str());
+    };
+  };
+  /// Read entries from `queue_`, until the end of the matrix.
+  void read_queue();
+  /// Read entries from the input stream in batches, recording the
+  /// parsing and processing of each batch in the trace; return
+  /// number of entries read.
+  long long read_traced();
 };
 
 
-/** Helper class for writing out a stream of entries in SMS matrix format. */
+/** Helper class for writing out a stream of entries in SMS matrix
+    format.  Output is collected in an internal buffer and written to
+    the stream in large chunks. */
 template< typename val_t, typename coord_t = long >
 class SMSWriter
 {
@@ -131,23 +969,453 @@ public:
   /** Destructor: closes the passed stream. */
   ~SMSWriter();
 
-  /** Begin writing matrix stream to the given output stream. */
+  /** Begin writing matrix stream to the given output stream.  Entry
+      values are formatted according to the stream's floating-point
+      notation and precision settings, as they are at this time. */
   void open(std::ostream& out, const coord_t nrows, const coord_t ncols);
   /** Begin writing matrix stream to the given file. */
   void open(const std::string& filename, const coord_t nrows, const coord_t ncols);
 
+  /** Declare in the header of the next stream opened that entries
+      will be written in the given @c order; see @ref entry_order.
+      The caller is responsible for actually doing so. */
+  void set_order(const entry_order order) { order_ = order; };
+
   /** Output a single matrix entry to the currently-open output stream. */
   void write_entry(const coord_t row, const coord_t col, const val_t& value);
 
+  /** Append the textual representation of a matrix entry to string
+      @c buf, exactly as @ref write_entry would write it.  This can be
+      safely called from several threads at once. */
+  void format_entry(std::string& buf,
+                    const coord_t row, const coord_t col, const val_t& value) const
+  {
+    append_integer(buf, row);
+    buf += ' ';
+    append_integer(buf, col);
+    buf += ' ';
+    append_value(buf, value, format_);
+    buf += '\n';
+  };
+
+  /** Append a matrix entry to @c batch, as @ref write_entry would do
+      when writing to an in-process pipeline. */
+  void format_entry(EntryBatch& batch,
+                    const coord_t row, const coord_t col, const val_t& value) const
+  {
+    batch.rows.push_back(row);
+    batch.columns.push_back(col);
+    store_value(batch, value);
+  };
+
+  /** Write the entries of blocks 0 to @c nblocks-1, in block order.
+      For each block @c b, the entries are produced by calling @c
+      gen(b,buf), which should append them to @c buf by means of @ref
+      format_entry; @c buf is a string when writing to a stream, and
+      an @ref EntryBatch when writing to an in-process pipeline, so
+      @c gen must accept both.  If OpenMP is available, several
+      blocks are formatted in parallel, and memory usage is bounded
+      by a few blocks per thread. */
+  template< typename generator_t >
+  void write_blocks(const std::size_t nblocks, generator_t& gen);
+
   /** Finish writing matrix entries to the given stream.  Output
       end-of-data marker and close stream if necessary. */
   void close();
 
 protected:
   pointer<std::ostream> output_;
+
+  /// how to print entry values
+  value_format format_;
+  /// order of entries to declare in the header
+  entry_order order_;
+  /// formatted entries not yet written to `output_`
+  std::string buffer_;
+
+  /// when writing to an in-process pipeline: the queue to send
+  /// entries to, and the batch being filled
+  EntryQueue* queue_;
+  EntryBatch batch_;
+
+  /// where to account for time and data, if `--stats` is enabled
+  RunStats* stats_;
+
+  /// Format blocks with @c gen into @c chunks, a few at a time, and
+  /// pass them on in order with @ref put_block; see @ref write_blocks.
+  template< typename generator_t, typename buffer_t >
+  void generate_blocks(const std::size_t nblocks, generator_t& gen,
+                       std::vector<buffer_t>& chunks);
+  /// Write a block of formatted entries to the output stream.
+  void put_block(std::string& chunk);
+  /// Send a block of entries to the pipeline queue.
+  void put_block(EntryBatch& chunk);
+
+  /// Write buffered text to the output stream.
+  void flush_buffer();
+  /// Write the SMS header line to the output stream.
+  void write_header(const coord_t nrows, const coord_t ncols);
+};
+
+
+/** Sparse matrix in Compressed Sparse Row format.  Row and column
+    indices are 1-based, as in the SMS format; entries of row @c i
+    occupy positions @c row_begin(i) to @c row_end(i)-1 in the column
+    index and value arrays. */
+template< typename val_t, typename index_t = long >
+class CSRMatrix
+{
+public:
+  /** Constructor: make an empty 0x0 matrix. */
+  CSRMatrix() : nrows_(0), ncols_(0), rowptr_(1, 0), colind_(), values_() { };
+
+  /** Build matrix from a list of (row, column, value) triples, with
+      a (parallel, if OpenMP is available) scatter of the triples into
+      row order.  Entries within each row keep the relative order they
+      have in the input lists.  The input vectors are emptied. */
+  void assign(const index_t nrows, const index_t ncols,
+              std::vector<index_t>& rows,
+              std::vector<index_t>& cols,
+              std::vector<val_t>& values);
+
+  /** Sort entries within each row by increasing column index. */
+  void sort_rows();
+
+  /** Return number of matrix rows. */
+  index_t rows() const { return nrows_; };
+  /** Return number of matrix columns. */
+  index_t columns() const { return ncols_; };
+  /** Return number of stored entries. */
+  std::size_t nonzeros() const { return colind_.size(); };
+
+  /** Position of the first entry of row @c i. */
+  std::size_t row_begin(const index_t i) const { return rowptr_[i-1]; };
+  /** Position one past the last entry of row @c i. */
+  std::size_t row_end(const index_t i) const { return rowptr_[i]; };
+  /** Column index of the entry at position @c k. */
+  index_t column(const std::size_t k) const { return colind_[k]; };
+  /** Value of the entry at position @c k. */
+  const val_t& value(const std::size_t k) const { return values_[k]; };
+
+private:
+  index_t nrows_;
+  index_t ncols_;
+  std::vector<std::size_t> rowptr_;
+  std::vector<index_t> colind_;
+  std::vector<val_t> values_;
+};
+
+
+/** List of matrix entries, as (row, column, value) triples in the
+    order they were added.  Indices are stored as 32-bit integers when
+    the matrix dimensions fit, which halves the memory (and bandwidth)
+    taken by them; only larger matrices use `long` indices.  The index
+    width is chosen at run time by @ref reset, and sorting is done by
+    the @ref CSRMatrix instance for that width. */
+template< typename val_t >
+class EntryList
+{
+public:
+  /** Constructor: make an empty list. */
+  EntryList() : narrow_(true), rows32_(), cols32_(), rows_(), cols_(), values_() { };
+
+  /** Make the list empty, and choose the index width for entries of
+      a matrix with the given dimensions. */
+  void reset(const long nrows, const long ncols)
+  {
+    const long max32 = std::numeric_limits<uint32_t>::max();
+    narrow_ = (nrows <= max32 and ncols <= max32);
+    std::vector<uint32_t>().swap(rows32_);
+    std::vector<uint32_t>().swap(cols32_);
+    std::vector<long>().swap(rows_);
+    std::vector<long>().swap(cols_);
+    std::vector<val_t>().swap(values_);
+  };
+
+  /** Return @c true if indices are stored as 32-bit integers. */
+  bool narrow() const { return narrow_; };
+
+  /** Append entry (@c i, @c j, @c value) to the list. */
+  void push_back(const long i, const long j, const val_t& value)
+  {
+    if (narrow_) {
+      rows32_.push_back(i);
+      cols32_.push_back(j);
+    }
+    else {
+      rows_.push_back(i);
+      cols_.push_back(j);
+    };
+    values_.push_back(value);
+  };
+
+  /** Return number of entries in the list. */
+  std::size_t size() const { return values_.size(); };
+
+  /** Row index of the @c n-th entry. */
+  long row(const std::size_t n) const { return narrow_? rows32_[n] : rows_[n]; };
+  /** Column index of the @c n-th entry. */
+  long column(const std::size_t n) const { return narrow_? cols32_[n] : cols_[n]; };
+  /** Value of the @c n-th entry. */
+  const val_t& value(const std::size_t n) const { return values_[n]; };
+
+  /** Change the row index of every entry from @c i to @c new_row[i]. */
+  template< typename coord_t >
+  void renumber_rows(const std::vector<coord_t>& new_row)
+  {
+    if (narrow_)
+      renumber(rows32_, new_row);
+    else
+      renumber(rows_, new_row);
+  };
+
+  /** Change the column index of every entry from @c j to @c new_col[j]. */
+  template< typename coord_t >
+  void renumber_columns(const std::vector<coord_t>& new_col)
+  {
+    if (narrow_)
+      renumber(cols32_, new_col);
+    else
+      renumber(cols_, new_col);
+  };
+
+  /** Write all entries of a @c nrows by @c ncols matrix to @c writer,
+      which must be already open, sorted by row and then by column
+      index; entries with the same indices keep their relative order.
+      The list is emptied. */
+  void write_sorted(SMSWriter<val_t>& writer, const long nrows, const long ncols)
+  {
+    if (narrow_)
+      write_sorted(writer, nrows, ncols, rows32_, cols32_);
+    else
+      write_sorted(writer, nrows, ncols, rows_, cols_);
+  };
+
+private:
+  bool narrow_;
+  /// indices, if `narrow_` is set
+  std::vector<uint32_t> rows32_;
+  std::vector<uint32_t> cols32_;
+  /// indices, if `narrow_` is not set
+  std::vector<long> rows_;
+  std::vector<long> cols_;
+  std::vector<val_t> values_;
+
+  template< typename index_t, typename coord_t >
+  static void renumber(std::vector<index_t>& indices, const std::vector<coord_t>& new_index)
+  {
+    for (std::size_t n = 0; n < indices.size(); ++n)
+      indices[n] = new_index[indices[n]];
+  };
+
+  template< typename index_t >
+  void write_sorted(SMSWriter<val_t>& writer, const long nrows, const long ncols,
+                    std::vector<index_t>& rows, std::vector<index_t>& cols)
+  {
+    CSRMatrix<val_t, index_t> m;
+    m.assign(nrows, ncols, rows, cols, values_);
+    m.sort_rows();
+    for (long i = 1; i <= nrows; ++i)
+      for (std::size_t k = m.row_begin(i); k < m.row_end(i); ++k)
+        writer.write_entry(i, m.column(k), m.value(k));
+  };
+};
+
+
+/** Set of indices in the range 0 to N, stored as a bitmap.  After
+    @ref build_rank has been called, @ref rank answers in constant
+    time how many indices in the set are not larger than a given one;
+    this can be used to renumber a subset of rows or columns while
+    preserving their relative order.  Memory usage is about 2 bits
+    per index in the range. */
+class IndexBitmap
+{
+public:
+  /** Constructor: make an empty set. */
+  IndexBitmap() : words_(), rank_() { };
+
+  /** Make the set empty, and able to hold indices from 0 to @c n. */
+  void reset(const std::size_t n) { words_.assign(n/64 + 1, 0); rank_.clear(); };
+
+  /** Add index @c i to the set. */
+  void set(const std::size_t i) { words_[i >> 6] |= (1ULL << (i & 63)); };
+
+  /** Return @c true if index @c i is in the set. */
+  bool test(const std::size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; };
+
+  /** Compute the per-word prefix counts needed by @ref rank and @ref
+      count.  Must be called again after any call to @ref set. */
+  void build_rank()
+  {
+    rank_.resize(words_.size() + 1);
+    rank_[0] = 0;
+    for (std::size_t w = 0; w < words_.size(); ++w)
+      rank_[w+1] = rank_[w] + popcount(words_[w]);
+  };
+
+  /** Return the number of indices in the set that are less than or
+      equal to @c i. */
+  std::size_t rank(const std::size_t i) const
+  {
+    const unsigned long long mask = ~0ULL >> (63 - (i & 63));
+    return rank_[i >> 6] + popcount(words_[i >> 6] & mask);
+  };
+
+  /** Return the number of indices in the set. */
+  std::size_t count() const { return rank_.back(); };
+
+private:
+  std::vector<unsigned long long> words_;
+  std::vector<std::size_t> rank_;
+
+  static unsigned int popcount(unsigned long long x)
+  {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    unsigned int n = 0;
+    for (; x != 0; x &= x - 1)
+      ++n;
+    return n;
+#endif
+  };
+};
+
+
+/** Counter-based pseudo-random number generator (Philox4x32-10, by
+    Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+    SC'11).  Each generator object produces an independent stream of
+    numbers, determined only by the seed and the stream number: this
+    makes it possible to hand out different streams (e.g., one per
+    matrix row) to different threads and still get results that do
+    not depend on the number of threads or the order of execution. */
+class PhiloxRandom
+{
+public:
+  /** Constructor: start stream number @c stream for the given seed. */
+  PhiloxRandom(const unsigned long long seed, const unsigned long long stream)
+    : used_(4)
+  {
+    key_[0] = static_cast<uint32_t>(seed);
+    key_[1] = static_cast<uint32_t>(seed >> 32);
+    ctr_[0] = 0;
+    ctr_[1] = 0;
+    ctr_[2] = static_cast<uint32_t>(stream);
+    ctr_[3] = static_cast<uint32_t>(stream >> 32);
+  };
+
+  /** Return a random 32-bit integer. */
+  uint32_t next32()
+  {
+    if (4 == used_) {
+      generate();
+      used_ = 0;
+    };
+    return out_[used_++];
+  };
+
+  /** Return a random 64-bit integer. */
+  unsigned long long next64()
+  {
+    const unsigned long long hi = next32();
+    return (hi << 32) | next32();
+  };
+
+  /** Return a random integer uniformly distributed in the range 0 to @c n-1. */
+  unsigned long long below(const unsigned long long n)
+  {
+    // reject the top values that would make the distribution uneven
+    const unsigned long long limit = (0ULL - n) % n;
+    unsigned long long x;
+    do {
+      x = next64();
+    } while (x < limit);
+    return x % n;
+  };
+
+  /** Return a random number uniformly distributed in the half-open
+      interval [0,1), with 53 bits of precision. */
+  double uniform()
+  {
+    return (next64() >> 11) * (1.0 / 9007199254740992.0);
+  };
+
+  // make this usable as a Boost.Random engine, e.g., to draw from
+  // other distributions
+  typedef uint32_t result_type;
+  BOOST_STATIC_CONSTANT(bool, has_fixed_range = false);
+  static result_type min BOOST_PREVENT_MACRO_SUBSTITUTION () { return 0; };
+  static result_type max BOOST_PREVENT_MACRO_SUBSTITUTION () { return 0xFFFFFFFFu; };
+  result_type operator()() { return next32(); };
+
+private:
+  uint32_t key_[2];
+  uint32_t ctr_[4];
+  uint32_t out_[4];
+  unsigned int used_;
+
+  /// Encrypt the current counter into `out_`, then increment the counter.
+  void generate()
+  {
+    uint32_t x[4] = { ctr_[0], ctr_[1], ctr_[2], ctr_[3] };
+    uint32_t k0 = key_[0], k1 = key_[1];
+    for (int round = 0; round < 10; ++round) {
+      const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * x[0];
+      const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * x[2];
+      const uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x[1] ^ k0;
+      const uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x[3] ^ k1;
+      x[0] = y0;
+      x[1] = static_cast<uint32_t>(p1);
+      x[2] = y2;
+      x[3] = static_cast<uint32_t>(p0);
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    };
+    std::copy(x, x+4, out_);
+    // 64-bit block counter in the low words
+    if (0 == ++ctr_[0])
+      ++ctr_[1];
+  };
 };
 
 
+/** How permutation vectors are stored in a file. */
+typedef enum { TEXT_PERMUTATION, BINARY_PERMUTATION } permutation_format;
+
+/** Write permutation vector @c perm to file @c filename ("-" means
+    the standard output stream).  A permutation is stored as the list
+    of old (1-based) indices in their new order, i.e., item @c k of
+    the list is the index of the row (or column) that is moved to
+    position @c k.  The text format has one index per line; the binary
+    format is the 8-byte magic string "SMSPERM1", followed by the
+    vector length and the indices, all as native 64-bit integers. */
+template< typename coord_t >
+void write_permutation(const std::string& filename,
+                       const std::vector<coord_t>& perm,
+                       const permutation_format format);
+
+/** Read permutation vector from file @c filename ("-" means the
+    standard input stream); the file format (text or binary) is
+    detected automatically.  Throw an exception if the file contents
+    are not a permutation of the integers 1 to N. */
+template< typename coord_t >
+void read_permutation(const std::string& filename, std::vector<coord_t>& perm);
+
+/** Store in @c result the permutation obtained by applying @c first
+    and then @c second, i.e., @c result[k] = @c first[second[k]]. */
+template< typename coord_t >
+void compose_permutations(const std::vector<coord_t>& first,
+                          const std::vector<coord_t>& second,
+                          std::vector<coord_t>& result);
+
+/** Store in @c inverse the mapping from old to new index, i.e.,
+    @c inverse[perm[k]] = @c k+1.  Note that @c inverse is indexed
+    1-based: @c inverse[0] is unused. */
+template< typename coord_t >
+void invert_permutation(const std::vector<coord_t>& perm,
+                        std::vector<coord_t>& inverse);
+
+
 /** Common code for implementing a UNIX filter program.  Parses a
     command line invocation of the form "prog [options] [INPUT
     [OUTPUT]]" and then calls the @ref process method with open
@@ -198,6 +1466,27 @@ public:
   /** Run filter program with command-line arguments. Return UNIX exit code. */
   int main(int argc, char** argv);
 
+  /** Parse command-line arguments, as the first part of @ref main.
+      Return -1 if the program should go on and call @ref execute;
+      otherwise, return the UNIX exit code (e.g., after printing the
+      help text, or an error message). */
+  int setup(int argc, char** argv);
+
+  /** Call @ref run, reporting errors; return UNIX exit code.  This is
+      the second part of @ref main.  With option `--stats`, time and
+      data processed are accounted in a @ref RunStats object, and
+      reported when @ref run returns. */
+  int execute();
+
+  /** Return the message of the error that made @ref setup or @ref
+      execute fail, or the empty string. */
+  const std::string& error_message() const { return error_; };
+
+  /** Read input from stream @c input, overriding the command line. */
+  void set_input(std::istream& input) { input_ = input; };
+  /** Write output to stream @c output, overriding the command line. */
+  void set_output(std::ostream& output) { output_ = output; set_output_format(notation_, precision_); };
+
   // XXX: this should be migrated to SMSWriter!
   /** How to write matrix entries to the output stream. */
   typedef enum { DEFAULT_NOTATION, FIXED_NOTATION, SCIENTIFIC_NOTATION } entry_format;
@@ -223,8 +1512,223 @@ protected:
 
   int argc_;
   char **argv_;
+
+  /// Call `run()`, catching and reporting errors.
+  int execute_run();
+
+  /// Add the description and options of program `other`, except
+  /// those that this program already has.
+  void copy_options(const FilterProgram& other);
+
+  /// program name, for use in error messages
+  std::string name_;
+  /// last error message, see `error_message()`
+  std::string error_;
+
+  /// whether this program started tracing, see `Tracer`
+  bool trace_;
+
+  /// whether to collect run statistics, and where to write them as
+  /// JSON (if empty, a summary goes to `std::cerr`)
+  bool stats_;
+  std::string stats_file_;
+};
+
+
+/** Types that matrix entry values can be held in; see @ref TypedProgram. */
+typedef enum {
+  AUTO_VALUE_TYPE,
+  INT64_VALUE_TYPE,
+  FLOAT_VALUE_TYPE,
+  DOUBLE_VALUE_TYPE,
+  LONG_DOUBLE_VALUE_TYPE
+} value_type;
+
+/** Return the value type named @c name: one of `auto`, `int64`,
+    `float`, `double`, or `long-double`.  Throw an exception if the
+    name is not valid. */
+value_type parse_value_type(const std::string& name);
+
+/** Return @c INT64_VALUE_TYPE if all entry values of the SMS matrix in
+    stream @c input are integers with at most 18 digits, or @c
+    LONG_DOUBLE_VALUE_TYPE otherwise.  The stream is read to the end
+    (or until a non-integer value is found) and then rewound; if it
+    cannot be rewound, e.g., because it is a pipe, nothing is read and
+    @c LONG_DOUBLE_VALUE_TYPE is returned.  If @c largest is not
+    NULL, the largest absolute value of the integer entries is stored
+    there. */
+value_type detect_value_type(std::istream& input, long double* largest = NULL);
+
+
+/** Front-end for a tool written as a class template over the entry
+    value type.  It takes the options of `Program<double>`, adds option
+    `--value-type`, and runs an instance of `Program<val_t>` for the
+    value type chosen on the command line.  With `--value-type=auto`
+    (the default), values are held as 64-bit integers if all values
+    in INPUT are integers and `Program::integer_values_ok(largest)`
+    returns @c true for the given options and the largest absolute
+    value in INPUT, i.e., if the results are the same as with
+    floating-point values; otherwise, as `long double`, if
+    available.  With option `--modulus`, values are held as @ref
+    ModularValue elements of GF(p) instead. */
+template< template<typename> class Program >
+class TypedProgram : public FilterProgram
+{
+public:
+  TypedProgram()
+    : prototype_(), value_type_(AUTO_VALUE_TYPE), modular_(false), field_(),
+      program_options_()
+  {
+    copy_options(prototype_);
+    add_option('D', "value-type", required_argument,
+               "Hold matrix entry values as ARG: one of int64, float, double, long-double,"
+               " or auto (default; int64 if INPUT has only integer values, else long-double).");
+    add_option('M', "modulus", required_argument,
+               "Reduce integer entry values modulo prime ARG (less than 2^32), and do all arithmetic modulo ARG.");
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('D' == opt)
+      value_type_ = parse_value_type(argument);
+    else if ('M' == opt) {
+      unsigned long long p = 0;
+      std::istringstream(argument) >> p;
+      field_ = PrimeField(p);
+      modular_ = true;
+    }
+    else {
+      // check option now, so that errors are reported as usual
+      prototype_.process_option(opt, argument);
+      program_options_.push_back(std::make_pair(opt, argument));
+    };
+  };
+
+  int run()
+  {
+    if (modular_) {
+      if (AUTO_VALUE_TYPE != value_type_)
+        throw std::runtime_error("Options '--modulus' and '--value-type' cannot be used together.");
+      PrimeField::set_current(&field_);
+      try {
+        const int exitcode = run_as<ModularValue>();
+        PrimeField::set_current(NULL);
+        return exitcode;
+      }
+      catch (...) {
+        PrimeField::set_current(NULL);
+        throw;
+      };
+    };
+
+    value_type type = value_type_;
+    if (AUTO_VALUE_TYPE == type) {
+      long double largest = 0;
+      type = detect_value_type(*input_, &largest);
+      if (INT64_VALUE_TYPE == type and not prototype_.integer_values_ok(largest))
+        type = LONG_DOUBLE_VALUE_TYPE;
+    };
+    switch (type) {
+    case INT64_VALUE_TYPE:  return run_as<int64_t>();
+    case FLOAT_VALUE_TYPE:  return run_as<float>();
+    case DOUBLE_VALUE_TYPE: return run_as<double>();
+    default:
+#ifdef HAVE_LONG_DOUBLE
+      return run_as<long double>();
+#else
+      return run_as<double>();
+#endif
+    };
+  };
+
+private:
+  /// used for help text and checking options
+  Program<double> prototype_;
+  value_type value_type_;
+  /// whether to use `ModularValue` arithmetic in `field_`
+  bool modular_;
+  PrimeField field_;
+  /// options to pass on to the program instance that does the work
+  std::vector< std::pair<int, const char*> > program_options_;
+
+  template< typename val_t >
+  int run_as()
+  {
+    Program<val_t> program;
+    for (std::size_t k = 0; k < program_options_.size(); ++k)
+      program.process_option(program_options_[k].first, program_options_[k].second);
+    program.set_input(*input_);
+    program.set_output(*output_);
+    // `set_output` resets the stream format to the program's defaults
+    set_output_format(notation_, precision_);
+    return program.run();
+  };
+};
+
+
+/** Function creating a new instance of some @ref FilterProgram subclass. */
+typedef FilterProgram* (*program_factory)();
+
+/** Name and factory function of a tool available in `libsmasto`. */
+struct program_info
+{
+  const char* name;
+  program_factory factory;
 };
 
+/** Return the table of tools available in `libsmasto` (and the
+    `smasto` multicall binary), indexed by subcommand name. */
+const std::map<std::string, program_factory>& program_registry();
+
+/** Return the factory for the tool named @c name (with or without
+    the `sms-` prefix), or @c NULL if there is no such tool. */
+program_factory find_program(const std::string& name);
+
+/** Split a pipeline specification into words, honoring single and
+    double quotes; a `|` character is always a word by itself. */
+std::vector<std::string> split_pipeline(const std::string& spec);
+
+/** Run a pipeline of tools in-process, and return its exit code.
+    The @c words are the command lines of the stages, separated by
+    `|` words (as returned by @ref split_pipeline).  Stages run
+    concurrently in separate threads, passing matrix entries to each
+    other through @ref EntryQueue instances.  If @c input is not @c
+    NULL, the first stage reads from it instead of its INPUT; if @c
+    output is not @c NULL, the last stage writes to it instead of its
+    OUTPUT.  If @c error is not @c NULL and some stage fails, it is
+    set to the first error message. */
+int run_pipeline(const std::vector<std::string>& words,
+                 std::istream* input = NULL, std::ostream* output = NULL,
+                 std::string* error = NULL);
+
+/** Define the entry point of a tool: `main` in a stand-alone binary,
+    or an entry in the @ref program_registry when building `libsmasto`. */
+#ifdef SMASTO_LIBRARY
+# define SMASTO_MAIN(name, program_class)                               \
+  static FilterProgram* new_##program_class() { return new program_class(); } \
+  extern const program_info program_info_##program_class = { name, &new_##program_class };
+#else
+# define SMASTO_MAIN(name, program_class)               \
+  int main(int argc, char** argv)                       \
+  {                                                     \
+    return program_class().main(argc, argv);            \
+  }
+#endif
+
+/** Same as @ref SMASTO_MAIN, for a tool written as a class template
+    over the entry value type; see @ref TypedProgram. */
+#ifdef SMASTO_LIBRARY
+# define SMASTO_TYPED_MAIN(name, program_template)                      \
+  static FilterProgram* new_##program_template() { return new TypedProgram<program_template>(); } \
+  extern const program_info program_info_##program_template = { name, &new_##program_template };
+#else
+# define SMASTO_TYPED_MAIN(name, program_template)              \
+  int main(int argc, char** argv)                               \
+  {                                                             \
+    return TypedProgram<program_template>().main(argc, argv);   \
+  }
+#endif
+
 
 
 //
@@ -238,41 +1742,12 @@ bool is_zero(const val_t& value)
 };
 
 template<>
-bool is_zero< typename std::string >(const std::string& value)
-{
-  static const std::string exponent_sep("eEfFgG");
-
-  // shortcuts
-  if ("0" == value or "0.0" == value)
-    return true;
-  // else, examine string to see if it matches any sensible
-  // representation of "0"
-  std::string::const_iterator c = value.begin();
-  // skip leading whitespace
-  while (std::isspace(*c)) ++c;
-  // ignore optional sign
-  if ('-' == *c or '+' == *c) ++c;
-  // any number of zeroes is OK
-  while ('0' == *c) ++c;
-  if (value.end() == c)
-    return true;
-  // if string continues, zeroes must be followed by a decimal dot '.'
-  // or a rational slash '/' or the exponent of a scientific notation number
-  if ('/' == *c)
-    // rational number: it is zero because the denominator is zero
-    return true;
-  else if (exponent_sep.find(*c) != std::string::npos)
-    // sci notation: zero because the mantissa is zero
-    return true;
-  else if ('.' == *c) {
-    // more zeroes to follow
-    while ('0' == *c) ++c;
-    return (value.end() == c
-            or '/' == *c
-            or exponent_sep.find(*c) != std::string::npos);
-  }
-  else
-    return false;
+bool is_zero< typename std::string >(const std::string& value);
+
+template<>
+inline bool is_zero< ModularValue >(const ModularValue& value)
+{
+  return (0 == value.value);
 };
 
 
@@ -280,7 +1755,8 @@ bool is_zero< typename std::string >(const std::string& value)
 
 template< typename val_t, typename coord_t >
 SMSReader<val_t,coord_t>::SMSReader()
-  : input_() , nrows_(0), ncols_(0)
+  : input_() , nrows_(0), ncols_(0), order_(UNSORTED_ORDER), queue_(NULL), queue_format_(),
+    stats_(NULL), start_(-1), stopped_(false)
 {
   // nothing to do
 };
@@ -296,21 +1772,51 @@ SMSReader<val_t,coord_t>::~SMSReader()
 template< typename val_t, typename coord_t >
 void SMSReader<val_t,coord_t>::open(std::istream& input)
 {
+  stats_ = RunStats::current();
+  PhaseTimer timer(stats_, RunStats::OPEN);
   input_ = input;
+  queue_ = NULL;
+  start_ = -1;
+  stopped_ = false;
+
+  // take entries directly from a pipeline queue, if possible
+  QueueInputStream* pipe = dynamic_cast<QueueInputStream*>(&input);
+  if (NULL != pipe and EntryBatch::ABORT == pipe->queue().peek())
+    throw std::runtime_error("No input matrix, because the previous pipeline stage failed.");
+  if (NULL != pipe and EntryBatch::HEADER == pipe->queue().peek()) {
+    EntryBatch header;
+    pipe->queue().pop(header);
+    queue_ = &(pipe->queue());
+    nrows_ = header.nrows;
+    ncols_ = header.ncols;
+    order_ = header.order;
+    queue_format_ = header.format;
+    return;
+  };
+
+  if (NULL != stats_)
+    start_ = input_->tellg();
   char M;
   (*input_) >> std::skipws >> nrows_ >> ncols_ >> M;
   if ('M' != M)
     throw std::runtime_error("Malformed SMS header");
+  read_order();
 };
 
 template< typename val_t, typename coord_t >
 void SMSReader<val_t,coord_t>::open(const std::string& filename)
 {
+  stats_ = RunStats::current();
+  PhaseTimer timer(stats_, RunStats::OPEN);
   errno = 0;
-  std::ifstream input(filename.c_str());
-  if (input.good())
+  queue_ = NULL;
+  start_ = 0;
+  stopped_ = false;
+  std::ifstream* input = new std::ifstream(filename.c_str());
+  if (input->good())
     input_ = input;
   else {
+    delete input;
     std::ostringstream msg;
     msg << "Cannot open file '" << filename << "': " << strerror(errno);
     throw std::runtime_error(msg.str());
@@ -323,28 +1829,178 @@ void SMSReader<val_t,coord_t>::open(const std::string& filename)
     msg << "Malformed SMS header in file '" << filename << "'";
     throw std::runtime_error(msg.str());
   };
+  read_order();
+};
+
+
+template< typename val_t, typename coord_t >
+void SMSReader<val_t,coord_t>::read_order()
+{
+  order_ = UNSORTED_ORDER;
+  std::istream& input = *input_;
+  while (' ' == input.peek() or '\t' == input.peek())
+    input.get();
+  // entries start with a digit; other words are ignored
+  if (not std::isalpha(input.peek()))
+    return;
+  std::string word;
+  input >> word;
+  if ("canonical=row" == word)
+    order_ = ROW_MAJOR_ORDER;
+  else if ("canonical=column" == word)
+    order_ = COLUMN_MAJOR_ORDER;
 };
 
 
 template< typename val_t, typename coord_t >
 void SMSReader<val_t,coord_t>::read()
 {
+  PhaseTimer timer(stats_, RunStats::READ);
+  if (NULL != queue_) {
+    read_queue();
+    return;
+  };
+
   // eof() only works if a read has been attempted
   (*input_).peek();
 
-  while (not (*input_).eof()) {
+  long long count = 0;
+  if (Tracer::enabled())
+    count = read_traced();
+  else while (not stopped_ and not (*input_).eof()) {
     coord_t i, j;
     val_t value;
-    (*input_) >> i >> j >> value;
-    assert(0 <= i and i <= nrows_);
-    assert(0 <= j and j <= ncols_);
+    if (not ((*input_) >> i)) {
+      // only whitespace after the last entry
+      if ((*input_).eof())
+        break;
+      throw_bad_value<val_t>();
+    };
+    if (not ((*input_) >> j >> value))
+      throw_bad_value<val_t>();
     // '0 0 0' is the end-of-stream marker
     if (0 == i and 0 == j and is_zero(value)) {
       this->done();
       break;
     };
+    check_bounds(i, j);
     // process entry
     this->process_entry(i, j, value);
+    ++count;
+  };
+  if (NULL != stats_) {
+    stats_->entries_in += count;
+    // the byte count is only known on seekable streams
+    input_->clear();
+    const std::streamoff end = input_->tellg();
+    if (start_ >= 0 and end >= start_ and stats_->bytes_in >= 0)
+      stats_->bytes_in += end - start_;
+    else
+      stats_->bytes_in = -1;
+  };
+};
+
+
+template< typename val_t, typename coord_t >
+long long SMSReader<val_t,coord_t>::read_traced()
+{
+  std::vector<coord_t> rows, columns;
+  std::vector<val_t> values;
+  long long count = 0;
+  bool at_end = false;
+  bool marker = false;
+  while (not at_end and not stopped_) {
+    {
+      TraceSpan span("parse entries");
+      while (rows.size() < 4096) {
+        if ((*input_).eof()) {
+          at_end = true;
+          break;
+        };
+        coord_t i, j;
+        val_t value;
+        if (not ((*input_) >> i)) {
+          if (not (*input_).eof())
+            throw_bad_value<val_t>();
+          at_end = true;
+          break;
+        };
+        if (not ((*input_) >> j >> value))
+          throw_bad_value<val_t>();
+        // '0 0 0' is the end-of-stream marker
+        if (0 == i and 0 == j and is_zero(value)) {
+          at_end = marker = true;
+          break;
+        };
+        check_bounds(i, j);
+        rows.push_back(i);
+        columns.push_back(j);
+        values.push_back(value);
+      };
+    };
+    {
+      TraceSpan span("process entries");
+      std::size_t k = 0;
+      while (k < rows.size() and not stopped_) {
+        this->process_entry(rows[k], columns[k], values[k]);
+        ++k;
+      };
+      count += k;
+    };
+    rows.clear();
+    columns.clear();
+    values.clear();
+  };
+  if (marker and not stopped_)
+    this->done();
+  return count;
+};
+
+
+template< typename val_t, typename coord_t >
+void SMSReader<val_t,coord_t>::read_queue()
+{
+  EntryBatch batch;
+  val_t value;
+  while (true) {
+    queue_->pop(batch);
+    switch (batch.kind) {
+    case EntryBatch::ENTRIES:
+      {
+        TraceSpan span("process entries");
+        for (std::size_t k = 0; k < batch.size(); ++k) {
+          load_value(batch, k, queue_format_, value);
+          this->process_entry(batch.rows[k], batch.columns[k], value);
+        };
+      };
+      if (NULL != stats_)
+        stats_->entries_in += batch.size();
+      break;
+    case EntryBatch::TEXT:
+      {
+        // entries formatted by a producer that writes text to its
+        // output stream rather than through `SMSWriter`
+        TraceSpan span("parse and process entries");
+        std::istringstream chunk(batch.text);
+        coord_t i, j;
+        while (chunk >> i >> j >> value) {
+          this->process_entry(i, j, value);
+          if (NULL != stats_)
+            ++stats_->entries_in;
+        };
+        if (not (chunk >> std::ws).eof())
+          throw_bad_value<val_t>();
+        break;
+      };
+    case EntryBatch::END:
+      this->done();
+      return;
+    case EntryBatch::ABORT:
+      throw std::runtime_error("Input matrix stream ended prematurely,"
+                               " because the previous pipeline stage failed.");
+    case EntryBatch::HEADER:
+      throw std::runtime_error("Malformed SMS stream: duplicate header.");
+    };
   };
 };
 
@@ -352,7 +2008,9 @@ void SMSReader<val_t,coord_t>::read()
 template< typename val_t, typename coord_t >
 void SMSReader<val_t,coord_t>::close()
 {
+  PhaseTimer timer(stats_, RunStats::CLOSE);
   input_.release();
+  queue_ = NULL;
 };
 
 
@@ -361,7 +2019,7 @@ void SMSReader<val_t,coord_t>::close()
 
 template< typename val_t, typename coord_t >
 SMSWriter<val_t,coord_t>::SMSWriter()
-  : output_()
+  : output_(), format_(), order_(UNSORTED_ORDER), buffer_(), queue_(NULL), batch_(), stats_(NULL)
 {
   // nothing to do
 };
@@ -378,8 +2036,32 @@ template< typename val_t, typename coord_t >
 void SMSWriter<val_t,coord_t>::open(std::ostream& output,
                                     const coord_t nrows, const coord_t ncols)
 {
+  stats_ = RunStats::current();
+  PhaseTimer timer(stats_, RunStats::OPEN);
   output_ = output;
-  (*output_) << nrows <<" "<< ncols <<" M"<< std::endl;
+  format_ = value_format(output);
+  queue_ = NULL;
+
+  // send entries in binary form to a pipeline queue, if possible
+  QueueOutputStream* pipe = dynamic_cast<QueueOutputStream*>(&output);
+  if (NULL != pipe) {
+    // send any text written so far first
+    output.flush();
+    queue_ = &(pipe->queue());
+    batch_.clear();
+    batch_.kind = EntryBatch::HEADER;
+    batch_.nrows = nrows;
+    batch_.ncols = ncols;
+    batch_.format = format_;
+    batch_.order = order_;
+    queue_->push(batch_);
+    batch_.clear();
+    return;
+  };
+
+  buffer_.clear();
+  buffer_.reserve(1 << 20);
+  write_header(nrows, ncols);
   if (output_->bad())
     throw std::runtime_error("Error writing to stream");
 };
@@ -389,18 +2071,25 @@ template< typename val_t, typename coord_t >
 void SMSWriter<val_t,coord_t>::open(const std::string& filename,
                                     const coord_t nrows, const coord_t ncols)
 {
+  stats_ = RunStats::current();
+  PhaseTimer timer(stats_, RunStats::OPEN);
   errno = 0;
-  std::ofstream output(filename);
-  if (output.good())
+  queue_ = NULL;
+  std::ofstream* output = new std::ofstream(filename.c_str());
+  if (output->good())
     output_ = output;
   else {
+    delete output;
     std::ostringstream msg;
     msg << "Cannot open file '" << filename << "' for writing: " << strerror(errno);
     throw std::runtime_error(msg.str());
   };
 
   errno = 0;
-  (*output_) << nrows <<" "<< ncols <<" M"<< std::endl;
+  format_ = value_format(*output_);
+  buffer_.clear();
+  buffer_.reserve(1 << 20);
+  write_header(nrows, ncols);
   if (output_->bad()) {
     std::ostringstream msg;
     msg << "Error writing to file '" << filename << "': " << strerror(errno);
@@ -413,284 +2102,402 @@ template< typename val_t, typename coord_t >
 void SMSWriter<val_t,coord_t>::write_entry(const coord_t row, const coord_t col,
                                            const val_t& value)
 {
-  (*output_) << row <<" "<< col <<" "<< value << std::endl;
+  // time is only accounted to the WRITE phase when a batch or the
+  // buffer is passed on, so that `--stats` does not read the clock
+  // for every entry
+  if (NULL != stats_)
+    ++stats_->entries_out;
+  if (NULL != queue_) {
+    batch_.rows.push_back(row);
+    batch_.columns.push_back(col);
+    store_value(batch_, value);
+    if (batch_.size() >= 4096) {
+      PhaseTimer timer(stats_, RunStats::WRITE);
+      queue_->push(batch_);
+    };
+    return;
+  };
+  format_entry(buffer_, row, col, value);
+  if (buffer_.size() >= (1 << 20))
+    flush_buffer();
 };
 
 
 template< typename val_t, typename coord_t >
-void SMSWriter<val_t,coord_t>::close()
+template< typename generator_t >
+void SMSWriter<val_t,coord_t>::write_blocks(const std::size_t nblocks, generator_t& gen)
 {
-  (*output_) << "0 0 0" << std::endl;
-  output_.release();
+  PhaseTimer timer(stats_, RunStats::WRITE);
+  if (NULL != queue_) {
+    // the pipeline consumer gets the entries in binary form
+    if (batch_.size() > 0)
+      queue_->push(batch_);
+    std::vector<EntryBatch> batches;
+    generate_blocks(nblocks, gen, batches);
+    return;
+  };
+  flush_buffer();
+  std::vector<std::string> chunks;
+  generate_blocks(nblocks, gen, chunks);
 };
 
 
-
-// ---- FilterProgram ----
-
-FilterProgram::FilterProgram()
-  : description(),
-    input_(std::cin), output_(std::cout),
-    options_(), optstring_(),
-    notation_(DEFAULT_NOTATION), precision_(-1)
+template< typename val_t, typename coord_t >
+template< typename generator_t, typename buffer_t >
+void SMSWriter<val_t,coord_t>::generate_blocks(const std::size_t nblocks, generator_t& gen,
+                                               std::vector<buffer_t>& chunks)
 {
-  assert(options_.empty());
-
-  // end marker for getopt_long
-  struct option opt0;
-  opt0.name = NULL;
-  opt0.has_arg = 0;
-  opt0.flag = NULL;
-  opt0.val = 0;
-  options_.push_back(opt0);
-
-  // common options
-  add_option('h', "help",    no_argument, "Print help text.");
-  add_option('V', "version", no_argument, "Print version string.");
-  add_option('i', "input",   required_argument, "Read input matrix from file ARG.");
-  add_option('o', "output",  required_argument, "Write output matrix to file ARG.");
-  add_option('p', "precision", required_argument, "Set number of significant digits for printing matrix entry values.");
-  add_option('E', "scientific", no_argument, "Output matrix entry values using scientifc notation.");
-  add_option('F', "fixed",   no_argument, "Output matrix entry values using fixed notation.");
-  add_option('G', "default", no_argument, "Choose fixed or scientific notation based on how large a value is.");
+#ifdef _OPENMP
+  const std::size_t batch = 4 * omp_get_max_threads();
+#else
+  const std::size_t batch = 1;
+#endif
+  chunks.resize(batch);
+  std::string error;
+  for (std::size_t first = 0; first < nblocks; first += batch) {
+    const long count = std::min(batch, nblocks - first);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long b = 0; b < count; ++b) {
+      TraceSpan span("format block");
+      chunks[b].clear();
+      // exceptions cannot leave a parallel region: keep the first
+      // error message, and throw it again afterwards
+      try {
+        gen(first + b, chunks[b]);
+      }
+      catch (std::exception& ex) {
+#pragma omp critical
+        if (error.empty())
+          error = ex.what();
+      };
+    };
+    if (not error.empty())
+      throw std::runtime_error(error);
+    TraceSpan span("write blocks");
+    for (long b = 0; b < count; ++b)
+      put_block(chunks[b]);
+    if (NULL == queue_ and output_->bad())
+      throw std::runtime_error("Error writing to stream");
+  };
 };
 
 
-FilterProgram::~FilterProgram()
+template< typename val_t, typename coord_t >
+void SMSWriter<val_t,coord_t>::put_block(std::string& chunk)
 {
-  // free up memory used by the long options
-        for (std::vector<struct option>::iterator it = options_.begin();
-             it != options_.end();
-             ++it)
-          {
-            free(const_cast<char*>(it->name));
-          };
+  output_->write(chunk.data(), chunk.size());
+  if (NULL != stats_) {
+    stats_->entries_out += std::count(chunk.begin(), chunk.end(), '\n');
+    stats_->bytes_out += chunk.size();
+  };
 };
 
 
-void
-FilterProgram::add_option(const char short_name,
-                          const std::string& long_name,
-                          int has_arg,
-                          const std::string& description)
+template< typename val_t, typename coord_t >
+void SMSWriter<val_t,coord_t>::put_block(EntryBatch& chunk)
 {
-  struct option lopt;
-  lopt.name = strdup(long_name.c_str());
-  lopt.has_arg = has_arg;
-  lopt.flag = NULL;
-  lopt.val = short_name;
-  options_.insert(options_.begin(), lopt);
+  if (0 == chunk.size())
+    return;
+  if (NULL != stats_)
+    stats_->entries_out += chunk.size();
+  queue_->push(chunk);
+};
 
-  std::ostringstream sopt;
-  sopt << short_name;
-  if (required_argument == has_arg)
-    sopt << ":";
-  else if (optional_argument == has_arg)
-    sopt << "::";
-  optstring_ += sopt.str();
 
-  option_help_[short_name] = description;
+template< typename val_t, typename coord_t >
+void SMSWriter<val_t,coord_t>::flush_buffer()
+{
+  PhaseTimer timer(stats_, RunStats::WRITE);
+  TraceSpan span("write buffer");
+  if (NULL != stats_)
+    stats_->bytes_out += buffer_.size();
+  output_->write(buffer_.data(), buffer_.size());
+  buffer_.clear();
+  if (output_->bad())
+    throw std::runtime_error("Error writing to stream");
 };
 
 
-void
-FilterProgram::set_input(const std::string& filename)
+template< typename val_t, typename coord_t >
+void SMSWriter<val_t,coord_t>::close()
 {
-  if (filename == "-") {
-    input_ = std::cin;
+  PhaseTimer timer(stats_, RunStats::CLOSE);
+  if (NULL != queue_) {
+    if (batch_.size() > 0)
+      queue_->push(batch_);
+    batch_.kind = EntryBatch::END;
+    queue_->push(batch_);
+    queue_ = NULL;
+    output_.release();
     return;
   };
-  errno = 0;
-  std::ifstream* input = new std::ifstream(filename.c_str());
-  if (not input->good()) {
-    std::ostringstream msg;
-    msg << "Cannot open input file '" << filename << "': "
-        << strerror(errno) << ".";
-    throw std::runtime_error(msg.str());
-  };
-  input_ = input;
+  buffer_ += "0 0 0\n";
+  flush_buffer();
+  output_->flush();
+  output_.release();
 };
 
 
-void
-FilterProgram::set_output(const std::string& filename)
+template< typename val_t, typename coord_t >
+void SMSWriter<val_t,coord_t>::write_header(const coord_t nrows, const coord_t ncols)
 {
-  if (filename == "-") {
-    output_ = std::cout;
-    return;
-  };
-  errno = 0;
-  std::ofstream* output = new std::ofstream(filename.c_str());
-  if (not output->good()) {
-    std::ostringstream msg;
-    msg << "Cannot open output file '" << filename << "': "
-        << strerror(errno) << ".";
-    throw std::runtime_error(msg.str());
-  };
-  output_ = output;
+  std::string header;
+  append_integer(header, nrows);
+  header += ' ';
+  append_integer(header, ncols);
+  header += " M";
+  if (ROW_MAJOR_ORDER == order_)
+    header += " canonical=row";
+  else if (COLUMN_MAJOR_ORDER == order_)
+    header += " canonical=column";
+  header += '\n';
+  output_->write(header.data(), header.size());
+  if (NULL != stats_)
+    stats_->bytes_out += header.size();
 };
 
 
-void
-FilterProgram::set_output_format(entry_format notation, const int precision)
+
+// ---- CSRMatrix ----
+
+template< typename val_t, typename index_t >
+void CSRMatrix<val_t,index_t>::assign(const index_t nrows, const index_t ncols,
+                                      std::vector<index_t>& rows,
+                                      std::vector<index_t>& cols,
+                                      std::vector<val_t>& values)
 {
-  // set output format
-  switch(notation) {
-  case DEFAULT_NOTATION:    output_->unsetf(std::ios_base::floatfield); break;
-  case FIXED_NOTATION:      output_->setf(std::ios_base::fixed); break;
-  case SCIENTIFIC_NOTATION: output_->setf(std::ios_base::scientific); break;
+  assert(rows.size() == cols.size() and rows.size() == values.size());
+  const std::size_t nnz = rows.size();
+  nrows_ = nrows;
+  ncols_ = ncols;
+
+  // each slice of the input needs its own `nrows`-long array of
+  // counters: use at most as many slices as there are entries per
+  // row, so that the counters take no more memory than the entries
+#ifdef _OPENMP
+  int nslices = (nnz > 65536? omp_get_max_threads() : 1);
+  if (nrows > 0 and static_cast<std::size_t>(nslices) > nnz / nrows)
+    nslices = std::max<std::size_t>(1, nnz / nrows);
+#else
+  const int nslices = 1;
+#endif
+
+  // count the entries per row in each slice of the input;
+  // `offset[s*nrows + i-1]` then becomes the position where slice `s`
+  // stores its first entry of row `i`.  Slices are laid out in order,
+  // so the scatter is stable.  Slices are distributed over whatever
+  // team of threads actually runs, which can be smaller than
+  // requested (e.g., with `OMP_DYNAMIC` or `OMP_THREAD_LIMIT`).
+  std::vector<std::size_t> offset(nslices * nrows, 0);
+#pragma omp parallel for schedule(static) if(nslices > 1)
+  for (int s = 0; s < nslices; ++s) {
+    std::size_t* const count = &offset[0] + s * nrows;
+    const std::size_t hi = nnz * (s+1) / nslices;
+    for (std::size_t n = nnz * s / nslices; n < hi; ++n)
+      ++count[rows[n]-1];
   };
-  if (precision >= 0)
-    output_->precision(precision);
+
+  rowptr_.assign(nrows+1, 0);
+  std::size_t pos = 0;
+  for (index_t i = 0; i < nrows; ++i) {
+    rowptr_[i] = pos;
+    for (int s = 0; s < nslices; ++s) {
+      const std::size_t count = offset[s * nrows + i];
+      offset[s * nrows + i] = pos;
+      pos += count;
+    };
+  };
+  rowptr_[nrows] = pos;
+  assert(pos == nnz);
+
+  colind_.resize(nnz);
+  values_.resize(nnz);
+#pragma omp parallel for schedule(static) if(nslices > 1)
+  for (int s = 0; s < nslices; ++s) {
+    std::size_t* const next = &offset[0] + s * nrows;
+    const std::size_t hi = nnz * (s+1) / nslices;
+    for (std::size_t n = nnz * s / nslices; n < hi; ++n) {
+      const std::size_t k = next[rows[n]-1]++;
+      colind_[k] = cols[n];
+      std::swap(values_[k], values[n]);
+    };
+  };
+
+  std::vector<index_t>().swap(rows);
+  std::vector<index_t>().swap(cols);
+  std::vector<val_t>().swap(values);
 };
 
 
-int
-FilterProgram::main(int argc, char** argv)
+template< typename val_t, typename index_t >
+void CSRMatrix<val_t,index_t>::sort_rows()
 {
-  if (argc < 1) {
-    std::cerr << "Type '" <<argv[0]<< " --help' to get usage help." << std::endl;
-    return 1;
+  typedef std::pair< index_t, std::size_t > key_t;
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (long i = 0; i < static_cast<long>(nrows_); ++i) {
+    const std::size_t first = rowptr_[i];
+    const std::size_t last = rowptr_[i+1];
+    bool sorted = true;
+    for (std::size_t k = first + 1; k < last; ++k)
+      if (colind_[k] < colind_[k-1]) {
+        sorted = false;
+        break;
+      };
+    if (sorted)
+      continue;
+    // sort (column, position) pairs, then move values accordingly
+    std::vector<key_t> keys(last - first);
+    for (std::size_t k = first; k < last; ++k)
+      keys[k - first] = key_t(colind_[k], k);
+    std::stable_sort(keys.begin(), keys.end());
+    std::vector<val_t> vals(last - first);
+    for (std::size_t k = first; k < last; ++k)
+      std::swap(vals[k - first], values_[keys[k - first].second]);
+    for (std::size_t k = first; k < last; ++k) {
+      colind_[k] = keys[k - first].first;
+      std::swap(values_[k], vals[k - first]);
+    };
   };
+};
 
-  // program name is basename of argv[0]
-  std::string invocation(argv[0]);
-  std::size_t pos = invocation.rfind('/');
-  std::string name;
-  if (0 == pos)
-    name = invocation;
-  else
-    name = invocation.substr(pos+1);
-
-  try {
-    // parse command-line arguments
-    int c;
-    try {
-      while (true) {
-        c = getopt_long(argc, argv, optstring_.c_str(),
-                        &(options_[0]), NULL);
-        if (-1 == c)
-          break;
-        else if ('h' == c) {
-          std::cout << "Usage: " << name << " [options] [INPUT [OUTPUT]]" << std::endl;
-          std::cout << std::endl;
-          std::cout << description << std::endl;
-          std::cout << "Options:" << std::endl;
-          for (std::vector<struct option>::const_iterator it = options_.begin();
-               it != options_.end() - 1;
-               ++it)
-            {
-              std::ostringstream optname;
-              optname << "-" << static_cast<char>(it->val)
-                      << ", --" << it->name;
-              if (required_argument == it->has_arg)
-                optname <<" ARG";
-              else if (optional_argument == it->has_arg)
-                optname << " [ARG]";
-
-              std::cout <<" "<< std::setw(24)
-                        << std::setiosflags(std::ios::left)
-                        << optname.str();
-              if (option_help_.find(it->val) != option_help_.end())
-                std::cout << option_help_[it->val];
-              std::cout << std::endl;
-            };
-          std::cout << std::endl;
-          return 0;
-        }
-        else if ('V' == c) {
-          // output conforms to GNU Coding Standards, but is kind of
-          // overkill for such a small utility package...
-          std::cout << name <<"(" PACKAGE_NAME ")" << PACKAGE_VERSION << std::endl;
-          std::cout <<
-            "\n"
-            "Copyright (C) 2010-2012 Riccardo Murri <riccardo.murri@gmail.com>.\n"
-            "\n"
-            "License GPLv3+: GNU GPL version 3 or later; see http://gnu.org/licenses/gpl.html\n"
-            "This is free software: you are free to change and redistribute it.\n"
-            "There is NO WARRANTY, to the extent permitted by law.\n"
-            "\n"
-            "See " PACKAGE_URL " for more information.\n"
-                    << std::endl;
-          return 0;
-        }
-        else if ('i' == c) {
-          set_input(optarg);
-        }
-        else if ('o' == c) {
-          set_output(optarg);
-        }
-        else if ('p' == c) {
-          std::istringstream(optarg) >> precision_;
-        }
-        else if ('E' == c) {
-          notation_ = DEFAULT_NOTATION;
-        }
-        else if ('F' == c) {
-          notation_ = FIXED_NOTATION;
-        }
-        else if ('G' == c) {
-          notation_ = DEFAULT_NOTATION;
-        }
-        else if ('?' == c) {
-          std::cerr << "Unknown option; type '" << argv[0] << " --help' to get usage help."
-                    << std::endl;
-          return 1;
-        }
-        else {
-          process_option(c, optarg);
-        };
-      }; // while(true)
-    }
-    catch(std::exception& ex) {
+
+
+// ---- permutations ----
+
+template< typename coord_t >
+void write_permutation(const std::string& filename,
+                       const std::vector<coord_t>& perm,
+                       const permutation_format format)
+{
+  pointer<std::ostream> out;
+  if ("-" == filename)
+    out = std::cout;
+  else {
+    errno = 0;
+    std::ofstream* file = new std::ofstream(filename.c_str(), std::ios::binary);
+    if (not file->good()) {
+      delete file;
       std::ostringstream msg;
-      msg << "Error in option '-" << static_cast<char>(c) << "': " << ex.what()
-          << " Type '" << argv[0] << " --help' to get usage help."
-          << std::endl;
+      msg << "Cannot open file '" << filename << "' for writing: " << strerror(errno);
       throw std::runtime_error(msg.str());
     };
+    out = file;
+  };
 
-    // all option processing done, now parse positional arguments
-    if (optind > 0)
-      argv[optind-1] = argv[0];
-    parse_args(argc - (optind-1), &(argv[optind-1]));
-
-    // save for possible re-use in run()
-    argc_ = argc;
-    argv_ = argv;
-
-    // now do stuff
-    return run();
+  if (BINARY_PERMUTATION == format) {
+    out->write("SMSPERM1", 8);
+    const long long n = perm.size();
+    out->write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (typename std::vector<coord_t>::const_iterator k = perm.begin(); k != perm.end(); ++k) {
+      const long long x = *k;
+      out->write(reinterpret_cast<const char*>(&x), sizeof(x));
+    };
   }
-  catch (std::runtime_error& ex) {
-    std::cerr << name << ": ERROR: " << ex.what() << std::endl;
-    return 1;
+  else {
+    for (typename std::vector<coord_t>::const_iterator k = perm.begin(); k != perm.end(); ++k)
+      (*out) << *k << '\n';
+  };
+  out->flush();
+
+  if (out->bad()) {
+    std::ostringstream msg;
+    msg << "Error writing permutation to '" << filename << "': " << strerror(errno);
+    throw std::runtime_error(msg.str());
   };
 };
 
 
-void
-FilterProgram::parse_args(int argc, char** argv)
+template< typename coord_t >
+void read_permutation(const std::string& filename, std::vector<coord_t>& perm)
 {
-  // set INPUT, if any
-  if (argc > 1) {
-    set_input(argv[1]);
+  pointer<std::istream> in;
+  if ("-" == filename)
+    in = std::cin;
+  else {
+    errno = 0;
+    std::ifstream* file = new std::ifstream(filename.c_str(), std::ios::binary);
+    if (not file->good()) {
+      delete file;
+      std::ostringstream msg;
+      msg << "Cannot open permutation file '" << filename << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    in = file;
   };
 
-  // set OUTPUT, if any
-  if (argc > 2) {
-    set_output(argv[2]);
+  perm.clear();
+  if ('S' == in->peek()) {
+    char magic[8];
+    long long n = -1;
+    in->read(magic, 8);
+    in->read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (not in->good() or 0 != std::memcmp(magic, "SMSPERM1", 8) or n < 0) {
+      std::ostringstream msg;
+      msg << "Malformed binary permutation file '" << filename << "'";
+      throw std::runtime_error(msg.str());
+    };
+    perm.resize(n);
+    for (long long k = 0; k < n; ++k) {
+      long long x;
+      in->read(reinterpret_cast<char*>(&x), sizeof(x));
+      perm[k] = x;
+    };
+    if (in->fail()) {
+      std::ostringstream msg;
+      msg << "Truncated binary permutation file '" << filename << "'";
+      throw std::runtime_error(msg.str());
+    };
+  }
+  else {
+    coord_t x;
+    while ((*in) >> x)
+      perm.push_back(x);
+    if (not in->eof()) {
+      std::ostringstream msg;
+      msg << "Malformed permutation file '" << filename << "'";
+      throw std::runtime_error(msg.str());
+    };
   };
-  set_output_format(notation_, precision_);
 
-  // too many arguments
-  if (argc > 3) {
+  // check that we actually read a permutation
+  const coord_t n = perm.size();
+  std::vector<bool> seen(n+1, false);
+  for (typename std::vector<coord_t>::const_iterator k = perm.begin(); k != perm.end(); ++k) {
+    if (*k < 1 or *k > n or seen[*k]) {
+      std::ostringstream msg;
+      msg << "File '" << filename << "' does not contain a permutation of 1.." << n;
+      throw std::runtime_error(msg.str());
+    };
+    seen[*k] = true;
+  };
+};
+
+
+template< typename coord_t >
+void compose_permutations(const std::vector<coord_t>& first,
+                          const std::vector<coord_t>& second,
+                          std::vector<coord_t>& result)
+{
+  if (first.size() != second.size()) {
     std::ostringstream msg;
-    msg << "At most two positional arguments allowed."
-        << " Type '" << argv[0] << " --help' to get usage help."
-        << std::endl;
+    msg << "Cannot compose permutations of different length "
+        << first.size() << " and " << second.size();
     throw std::runtime_error(msg.str());
   };
+  std::vector<coord_t> composed(second.size());
+  for (std::size_t k = 0; k < second.size(); ++k)
+    composed[k] = first[second[k]-1];
+  result.swap(composed);
+};
+
+
+template< typename coord_t >
+void invert_permutation(const std::vector<coord_t>& perm,
+                        std::vector<coord_t>& inverse)
+{
+  inverse.assign(perm.size()+1, 0);
+  for (std::size_t k = 0; k < perm.size(); ++k)
+    inverse[perm[k]] = k+1;
 };
 
 
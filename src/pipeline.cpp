@@ -0,0 +1,300 @@
+/**
+ * @file   pipeline.cpp
+ *
+ * Table of the tools in the SMaSTo library, and in-process pipelines.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// defined by `SMASTO_MAIN` in each tool's source file; listing them
+// here explicitly ensures they are linked in from the static library
+extern const program_info program_info_AdjoinProgram;
+extern const program_info program_info_BlockEchelonProgram;
+extern const program_info program_info_CanonProgram;
+extern const program_info program_info_ConvertProgram;
+extern const program_info program_info_FillProgram;
+extern const program_info program_info_InfoProgram;
+extern const program_info program_info_KronProgram;
+extern const program_info program_info_ComputeNormProgram;
+extern const program_info program_info_PermuteProgram;
+extern const program_info program_info_RandminorProgram;
+extern const program_info program_info_RandomSparseProgram;
+extern const program_info program_info_RankProgram;
+extern const program_info program_info_ReordColsProgram;
+extern const program_info program_info_ReordRowsProgram;
+extern const program_info program_info_RescaleProgram;
+extern const program_info program_info_ShrinkProgram;
+extern const program_info program_info_SliceProgram;
+extern const program_info program_info_SplitProgram;
+extern const program_info program_info_SvgProgram;
+extern const program_info program_info_TransposeProgram;
+extern const program_info program_info_VerifyProgram;
+extern const program_info program_info_WellKnownProgram;
+
+static const program_info* const programs[] = {
+  &program_info_AdjoinProgram,
+  &program_info_BlockEchelonProgram,
+  &program_info_CanonProgram,
+  &program_info_ConvertProgram,
+  &program_info_FillProgram,
+  &program_info_InfoProgram,
+  &program_info_KronProgram,
+  &program_info_ComputeNormProgram,
+  &program_info_PermuteProgram,
+  &program_info_RandminorProgram,
+  &program_info_RandomSparseProgram,
+  &program_info_RankProgram,
+  &program_info_ReordColsProgram,
+  &program_info_ReordRowsProgram,
+  &program_info_RescaleProgram,
+  &program_info_ShrinkProgram,
+  &program_info_SliceProgram,
+  &program_info_SplitProgram,
+  &program_info_SvgProgram,
+  &program_info_TransposeProgram,
+  &program_info_VerifyProgram,
+  &program_info_WellKnownProgram,
+};
+
+
+static std::map<std::string, program_factory>
+make_registry()
+{
+  std::map<std::string, program_factory> registry;
+  for (std::size_t k = 0; k < sizeof(programs) / sizeof(programs[0]); ++k)
+    registry[programs[k]->name] = programs[k]->factory;
+  return registry;
+};
+
+
+const std::map<std::string, program_factory>&
+program_registry()
+{
+  static const std::map<std::string, program_factory> registry = make_registry();
+  return registry;
+};
+
+
+program_factory
+find_program(const std::string& name)
+{
+  const std::map<std::string, program_factory>& registry = program_registry();
+  std::map<std::string, program_factory>::const_iterator it = registry.find(name);
+  if (it == registry.end() and 0 == name.compare(0, 4, "sms-"))
+    it = registry.find(name.substr(4));
+  if (it == registry.end())
+    return NULL;
+  return it->second;
+};
+
+
+std::vector<std::string>
+split_pipeline(const std::string& spec)
+{
+  std::vector<std::string> words;
+  std::string word;
+  bool in_word = false;
+  char quote = 0;
+  for (std::string::const_iterator c = spec.begin(); c != spec.end(); ++c) {
+    if (0 != quote) {
+      if (*c == quote)
+        quote = 0;
+      else
+        word += *c;
+    }
+    else if ('\'' == *c or '"' == *c) {
+      quote = *c;
+      in_word = true;
+    }
+    else if ('|' == *c or std::isspace(*c)) {
+      if (in_word)
+        words.push_back(word);
+      word.clear();
+      in_word = false;
+      if ('|' == *c)
+        words.push_back("|");
+    }
+    else {
+      word += *c;
+      in_word = true;
+    };
+  };
+  if (0 != quote)
+    throw std::runtime_error("Unterminated quote in pipeline specification.");
+  if (in_word)
+    words.push_back(word);
+  return words;
+};
+
+
+/** One stage of an in-process pipeline. */
+struct Stage
+{
+  std::vector<std::string> words;
+  std::vector<char*> argv;
+  FilterProgram* program;
+
+  /// connection to the previous stage, if any
+  EntryQueue* in_queue;
+  QueueInputStream* input;
+  /// connection to the next stage, if any
+  EntryQueue* out_queue;
+  QueueOutputStream* output;
+  /// caller-supplied output stream of the last stage, if any
+  std::ostream* sink;
+
+  int status;
+  std::string error;
+
+  Stage() : words(), argv(), program(NULL),
+            in_queue(NULL), input(NULL), out_queue(NULL), output(NULL),
+            sink(NULL), status(0), error() { };
+};
+
+
+/// Thread body: run one pipeline stage, then close its connections.
+static void
+run_stage(Stage* stage)
+{
+  try {
+    stage->status = stage->program->execute();
+    stage->error = stage->program->error_message();
+  }
+  catch (std::exception& ex) {
+    std::cerr << stage->words[0] << ": ERROR: " << ex.what() << std::endl;
+    stage->status = 1;
+    stage->error = ex.what();
+  };
+  if (NULL != stage->output) {
+    // send any text output still buffered
+    stage->output->flush();
+    stage->out_queue->finish(0 == stage->status);
+  };
+  if (NULL != stage->sink)
+    stage->sink->flush();
+  if (NULL != stage->in_queue)
+    // unblock the previous stage, if it is still writing
+    stage->in_queue->cancel();
+};
+
+
+int
+run_pipeline(const std::vector<std::string>& words,
+             std::istream* input, std::ostream* output, std::string* error)
+{
+  std::vector<Stage> stages(1);
+  for (std::vector<std::string>::const_iterator w = words.begin(); w != words.end(); ++w) {
+    if ("|" == *w)
+      stages.push_back(Stage());
+    else
+      stages.back().words.push_back(*w);
+  };
+  const std::size_t n = stages.size();
+  for (std::size_t k = 0; k < n; ++k)
+    if (stages[k].words.empty())
+      throw std::runtime_error("Empty stage in pipeline specification.");
+
+  // create programs and parse their command lines; `getopt` is not
+  // thread-safe, so this must be done before starting any thread,
+  // and only one pipeline at a time can be set up
+  static std::mutex getopt_lock;
+  int exitcode = -1;
+  {
+    std::lock_guard<std::mutex> guard(getopt_lock);
+    for (std::size_t k = 0; k < n and exitcode < 0; ++k) {
+      Stage& stage = stages[k];
+      program_factory factory = find_program(stage.words[0]);
+      if (NULL == factory) {
+        for (std::size_t l = 0; l < k; ++l)
+          delete stages[l].program;
+        std::ostringstream msg;
+        msg << "Unknown tool '" << stage.words[0] << "' in pipeline.";
+        throw std::runtime_error(msg.str());
+      };
+      stage.program = factory();
+      for (std::vector<std::string>::iterator w = stage.words.begin(); w != stage.words.end(); ++w)
+        stage.argv.push_back(&(*w)[0]);
+      stage.argv.push_back(NULL);
+      // reset `getopt` state (GNU extension)
+      optind = 0;
+      exitcode = stage.program->setup(stage.argv.size() - 1, &stage.argv[0]);
+      if (exitcode >= 0 and NULL != error)
+        *error = stage.program->error_message();
+    };
+  };
+
+  if (exitcode < 0) {
+    // connect stages
+    for (std::size_t k = 0; k+1 < n; ++k) {
+      EntryQueue* queue = new EntryQueue();
+      stages[k].out_queue = queue;
+      stages[k].output = new QueueOutputStream(*queue);
+      stages[k].program->set_output(*stages[k].output);
+      stages[k+1].in_queue = queue;
+      stages[k+1].input = new QueueInputStream(*queue);
+      stages[k+1].program->set_input(*stages[k+1].input);
+    };
+    if (NULL != input)
+      stages[0].program->set_input(*input);
+    if (NULL != output) {
+      stages[n-1].sink = output;
+      stages[n-1].program->set_output(*output);
+    };
+
+    // run each stage in its own thread
+    std::vector<std::thread> threads;
+    for (std::size_t k = 0; k < n; ++k)
+      threads.push_back(std::thread(run_stage, &stages[k]));
+    exitcode = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      threads[k].join();
+      if (0 == exitcode) {
+        exitcode = stages[k].status;
+        if (0 != exitcode and NULL != error)
+          *error = stages[k].error;
+      };
+    };
+  };
+
+  // programs must go before the streams they refer to
+  for (std::size_t k = 0; k < n; ++k) {
+    delete stages[k].program;
+    delete stages[k].input;
+    delete stages[k].output;
+    delete stages[k].out_queue;
+  };
+  return exitcode;
+};
@@ -0,0 +1,396 @@
+/**
+ * @file   smasto-capi.cpp
+ *
+ * Implementation of the C interface to the SMaSTo library.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+#include "smasto.h"
+
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct smasto_matrix
+{
+  long nrows;
+  long ncols;
+  std::vector<long> rows;
+  std::vector<long> columns;
+  std::vector<double> values;
+};
+
+
+/// message of the last error in the current thread
+static thread_local std::string last_error;
+
+
+/** Collect the entries of an SMS stream into a @c smasto_matrix. */
+class MatrixCollector : public SMSReader<double>
+{
+public:
+  explicit MatrixCollector(smasto_matrix& m) : m_(m) { };
+
+  /// Read the whole matrix from the given stream.
+  void collect(std::istream& input)
+  {
+    open(input);
+    m_.nrows = rows();
+    m_.ncols = columns();
+    read();
+    close();
+  };
+
+protected:
+  void process_entry(const long i, const long j, const double& value)
+  {
+    m_.rows.push_back(i);
+    m_.columns.push_back(j);
+    m_.values.push_back(value);
+  };
+
+private:
+  smasto_matrix& m_;
+};
+
+
+/// Write all entries of `m` to `output` in SMS format, or as binary
+/// batches if `output` is a `QueueOutputStream`.
+static void
+write_matrix(const smasto_matrix& m, std::ostream& output)
+{
+  // enough digits to read values back exactly
+  const std::streamsize saved = output.precision(std::numeric_limits<double>::max_digits10);
+  SMSWriter<double> writer;
+  writer.open(output, m.nrows, m.ncols);
+  output.precision(saved);
+  for (std::size_t k = 0; k < m.rows.size(); ++k)
+    writer.write_entry(m.rows[k], m.columns[k], m.values[k]);
+  writer.close();
+};
+
+
+/// Thread body: send the entries of `m` down a pipeline queue.
+static void
+feed_matrix(const smasto_matrix* m, QueueOutputStream* output)
+{
+  try {
+    write_matrix(*m, *output);
+  }
+  catch (std::runtime_error&) {
+    // the first stage stopped reading: nothing to do
+  };
+};
+
+
+/// Thread body: collect a matrix from a pipeline queue into `m`.
+static void
+collect_matrix(QueueInputStream* input, smasto_matrix* m, std::string* error)
+{
+  try {
+    MatrixCollector(*m).collect(*input);
+  }
+  catch (std::runtime_error& ex) {
+    // if the last stage failed, its own error message is more useful
+    if (EntryBatch::ABORT != input->queue().peek())
+      *error = ex.what();
+    input->queue().cancel();
+  };
+};
+
+
+extern "C" {
+
+
+const char*
+smasto_version(void)
+{
+  return PACKAGE_VERSION;
+}
+
+
+int
+smasto_api_version(void)
+{
+  return SMASTO_API_VERSION;
+}
+
+
+const char*
+smasto_last_error(void)
+{
+  return last_error.c_str();
+}
+
+
+size_t
+smasto_tool_count(void)
+{
+  return program_registry().size();
+}
+
+
+const char*
+smasto_tool_name(size_t k)
+{
+  const std::map<std::string, program_factory>& registry = program_registry();
+  if (k >= registry.size())
+    return NULL;
+  std::map<std::string, program_factory>::const_iterator it = registry.begin();
+  std::advance(it, k);
+  return it->first.c_str();
+}
+
+
+smasto_matrix*
+smasto_matrix_new(long nrows, long ncols)
+{
+  if (nrows < 0 or ncols < 0) {
+    last_error = "Matrix dimensions must be non-negative.";
+    return NULL;
+  };
+  smasto_matrix* m = new (std::nothrow) smasto_matrix();
+  if (NULL == m) {
+    last_error = "Out of memory.";
+    return NULL;
+  };
+  m->nrows = nrows;
+  m->ncols = ncols;
+  return m;
+}
+
+
+void
+smasto_matrix_free(smasto_matrix* m)
+{
+  delete m;
+}
+
+
+long
+smasto_matrix_rows(const smasto_matrix* m)
+{
+  return m->nrows;
+}
+
+
+long
+smasto_matrix_columns(const smasto_matrix* m)
+{
+  return m->ncols;
+}
+
+
+size_t
+smasto_matrix_nonzeros(const smasto_matrix* m)
+{
+  return m->rows.size();
+}
+
+
+int
+smasto_matrix_append(smasto_matrix* m, long row, long col, double value)
+{
+  if (row < 1 or row > m->nrows or col < 1 or col > m->ncols) {
+    std::ostringstream msg;
+    msg << "Entry (" << row << "," << col << ") is outside matrix bounds.";
+    last_error = msg.str();
+    return -1;
+  };
+  try {
+    m->rows.push_back(row);
+    m->columns.push_back(col);
+    m->values.push_back(value);
+  }
+  catch (std::bad_alloc&) {
+    last_error = "Out of memory.";
+    return -1;
+  };
+  return 0;
+}
+
+
+const long*
+smasto_matrix_row_indices(const smasto_matrix* m)
+{
+  return m->rows.empty()? NULL : &m->rows[0];
+}
+
+
+const long*
+smasto_matrix_column_indices(const smasto_matrix* m)
+{
+  return m->columns.empty()? NULL : &m->columns[0];
+}
+
+
+const double*
+smasto_matrix_values(const smasto_matrix* m)
+{
+  return m->values.empty()? NULL : &m->values[0];
+}
+
+
+smasto_matrix*
+smasto_matrix_read(const char* filename)
+{
+  smasto_matrix* m = new (std::nothrow) smasto_matrix();
+  if (NULL == m) {
+    last_error = "Out of memory.";
+    return NULL;
+  };
+  try {
+    const std::string name(filename);
+    if ("-" == name)
+      MatrixCollector(*m).collect(std::cin);
+    else {
+      errno = 0;
+      std::ifstream input(filename);
+      if (not input.good()) {
+        std::ostringstream msg;
+        msg << "Cannot open input file '" << name << "': " << strerror(errno) << ".";
+        throw std::runtime_error(msg.str());
+      };
+      MatrixCollector(*m).collect(input);
+    };
+  }
+  catch (std::exception& ex) {
+    last_error = ex.what();
+    delete m;
+    return NULL;
+  };
+  return m;
+}
+
+
+int
+smasto_matrix_write(const smasto_matrix* m, const char* filename)
+{
+  try {
+    const std::string name(filename);
+    if ("-" == name)
+      write_matrix(*m, std::cout);
+    else {
+      errno = 0;
+      std::ofstream output(filename);
+      if (not output.good()) {
+        std::ostringstream msg;
+        msg << "Cannot open output file '" << name << "': " << strerror(errno) << ".";
+        throw std::runtime_error(msg.str());
+      };
+      write_matrix(*m, output);
+    };
+  }
+  catch (std::exception& ex) {
+    last_error = ex.what();
+    return -1;
+  };
+  return 0;
+}
+
+
+int
+smasto_run(const char* pipeline,
+           const smasto_matrix* input, smasto_matrix** output)
+{
+  last_error.clear();
+  smasto_matrix* result = NULL;
+  try {
+    const std::vector<std::string> words = split_pipeline(pipeline);
+    if (words.empty())
+      throw std::runtime_error("Missing pipeline specification.");
+
+    if (NULL != output)
+      result = new smasto_matrix();
+
+    // feed the input matrix to the first stage from another thread
+    EntryQueue in_queue;
+    QueueOutputStream feed(in_queue);
+    QueueInputStream in(in_queue);
+    std::thread feeder;
+    if (NULL != input)
+      feeder = std::thread(feed_matrix, input, &feed);
+
+    // collect the output of the last stage, likewise
+    EntryQueue out_queue;
+    QueueOutputStream out(out_queue);
+    QueueInputStream collected(out_queue);
+    std::string collect_error;
+    std::thread collector;
+    if (NULL != output)
+      collector = std::thread(collect_matrix, &collected, result, &collect_error);
+
+    std::string error;
+    int exitcode = -1;
+    try {
+      exitcode = run_pipeline(words,
+                              (NULL != input? &in : NULL),
+                              (NULL != output? &out : NULL),
+                              &error);
+    }
+    catch (std::runtime_error& ex) {
+      error = ex.what();
+      exitcode = 1;
+    };
+
+    if (NULL != input) {
+      in_queue.cancel();
+      feeder.join();
+    };
+    if (NULL != output) {
+      out_queue.finish(0 == exitcode);
+      collector.join();
+      if (not collect_error.empty()) {
+        error = "Pipeline output is not a valid matrix: " + collect_error;
+        if (0 == exitcode)
+          exitcode = 1;
+      };
+    };
+
+    if (0 != exitcode) {
+      last_error = error;
+      delete result;
+      return exitcode;
+    };
+  }
+  catch (std::exception& ex) {
+    last_error = ex.what();
+    delete result;
+    return 1;
+  };
+  if (NULL != output)
+    *output = result;
+  return 0;
+}
+
+
+} // extern "C"
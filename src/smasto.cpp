@@ -0,0 +1,131 @@
+/**
+ * @file   smasto.cpp
+ *
+ * Multicall binary: run any of the SMaSTo tools, or a pipeline of them.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+typedef std::vector<std::string> words_t;
+
+
+static void
+usage(std::ostream& out, const std::string& name)
+{
+  out << "Usage: " << name << " TOOL [options] [ARGS]" << std::endl
+      << "       " << name << " run 'TOOL [options] [ARGS] | TOOL [options] [ARGS] | ...'" << std::endl
+      << std::endl
+      << "Run one of the SMaSTo tools, or a pipeline of them.  The TOOL name\n"
+         "is the name of a stand-alone tool, with or without the `sms-` prefix;\n"
+         "type '" << name << " TOOL --help' for the usage of each tool.\n"
+         "\n"
+         "With `run`, tools are connected as in a shell pipeline: the first\n"
+         "stage reads from its INPUT (or the standard input), and the last\n"
+         "one writes to its OUTPUT (or the standard output).  Stages run\n"
+         "concurrently in separate threads, and pass matrix entries to each\n"
+         "other in binary form through bounded in-memory queues, instead of\n"
+         "formatting and parsing text.  The pipeline may be given as a single\n"
+         "(quoted) argument, or as separate arguments with `|` words in\n"
+         "between.\n"
+      << std::endl
+      << "Available tools:" << std::endl;
+  const std::map<std::string, program_factory>& registry = program_registry();
+  for (std::map<std::string, program_factory>::const_iterator it = registry.begin();
+       it != registry.end(); ++it)
+    out << "  " << it->first << std::endl;
+  out << std::endl;
+};
+
+
+int
+main(int argc, char** argv)
+{
+  // program name is basename of argv[0]
+  std::string name(argv[0]);
+  const std::size_t pos = name.rfind('/');
+  if (std::string::npos != pos)
+    name = name.substr(pos+1);
+
+  // invoked through a symlink named after a tool, e.g., `sms-shrink`
+  if (0 == name.compare(0, 4, "sms-")) {
+    program_factory factory = find_program(name);
+    if (NULL != factory) {
+      FilterProgram* program = factory();
+      const int exitcode = program->main(argc, argv);
+      delete program;
+      return exitcode;
+    };
+  };
+
+  if (argc < 2) {
+    usage(std::cerr, name);
+    return 1;
+  };
+  const std::string command(argv[1]);
+  if ("-h" == command or "--help" == command) {
+    usage(std::cout, name);
+    return 0;
+  };
+  if ("-V" == command or "--version" == command) {
+    std::cout << name << "(" PACKAGE_NAME ")" << PACKAGE_VERSION << std::endl;
+    return 0;
+  };
+
+  try {
+    if ("run" == command) {
+      words_t words;
+      if (3 == argc)
+        words = split_pipeline(argv[2]);
+      else
+        words.assign(argv + 2, argv + argc);
+      if (words.empty())
+        throw std::runtime_error("Missing pipeline specification.");
+      return run_pipeline(words);
+    };
+
+    program_factory factory = find_program(command);
+    if (NULL == factory) {
+      std::ostringstream msg;
+      msg << "Unknown tool '" << command << "'."
+          << " Type '" << name << " --help' to get the list of available tools.";
+      throw std::runtime_error(msg.str());
+    };
+    FilterProgram* program = factory();
+    const int exitcode = program->main(argc - 1, argv + 1);
+    delete program;
+    return exitcode;
+  }
+  catch (std::runtime_error& ex) {
+    std::cerr << name << ": ERROR: " << ex.what() << std::endl;
+    return 1;
+  };
+};
@@ -0,0 +1,128 @@
+/**
+ * @file   smasto.h
+ *
+ * C interface to the SMaSTo library.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifndef SMASTO_H
+#define SMASTO_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Version of this interface; incremented on incompatible changes. */
+#define SMASTO_API_VERSION 1
+
+
+/** Opaque handle to a sparse matrix held in memory, as a list of
+    (row, column, value) entries with 1-based indices, in the order
+    they were added. */
+typedef struct smasto_matrix smasto_matrix;
+
+
+/** Return the SMaSTo package version, e.g., "0.15.6". */
+const char* smasto_version(void);
+
+/** Return the interface version the library was built with; compare
+    to @ref SMASTO_API_VERSION. */
+int smasto_api_version(void);
+
+/** Return the message of the last error that occurred in the calling
+    thread, or the empty string. */
+const char* smasto_last_error(void);
+
+
+/** Return the number of available tools. */
+size_t smasto_tool_count(void);
+
+/** Return the name of the @c k-th tool (e.g., "transpose"), or
+    @c NULL if @c k is out of range. */
+const char* smasto_tool_name(size_t k);
+
+
+/** Create a new empty matrix with the given dimensions; return @c
+    NULL on error. */
+smasto_matrix* smasto_matrix_new(long nrows, long ncols);
+
+/** Free all memory used by matrix @c m.  Passing @c NULL is allowed. */
+void smasto_matrix_free(smasto_matrix* m);
+
+/** Return the number of rows of matrix @c m. */
+long smasto_matrix_rows(const smasto_matrix* m);
+
+/** Return the number of columns of matrix @c m. */
+long smasto_matrix_columns(const smasto_matrix* m);
+
+/** Return the number of entries of matrix @c m. */
+size_t smasto_matrix_nonzeros(const smasto_matrix* m);
+
+/** Append entry (@c row, @c col, @c value) to matrix @c m.  Return 0
+    on success, or -1 if the indices are out of bounds. */
+int smasto_matrix_append(smasto_matrix* m, long row, long col, double value);
+
+/** Return a pointer to the row (resp. column) indices and values of
+    all the entries of @c m; the arrays have @ref smasto_matrix_nonzeros
+    elements, and stay valid until @c m is modified or freed. */
+const long* smasto_matrix_row_indices(const smasto_matrix* m);
+const long* smasto_matrix_column_indices(const smasto_matrix* m);
+const double* smasto_matrix_values(const smasto_matrix* m);
+
+/** Read a matrix in SMS format from file @c filename ("-" is the
+    standard input).  Return @c NULL on error. */
+smasto_matrix* smasto_matrix_read(const char* filename);
+
+/** Write matrix @c m in SMS format to file @c filename ("-" is the
+    standard output).  Values are written with enough digits to be
+    read back exactly.  Return 0 on success, -1 on error. */
+int smasto_matrix_write(const smasto_matrix* m, const char* filename);
+
+
+/** Run a tool, or a pipeline of tools, in the calling process.  The
+    @c pipeline string has the same syntax as the argument to
+    `smasto run`, e.g., "shrink | transpose".  If @c input is not @c
+    NULL, the first tool reads entries from it; otherwise, it reads
+    from its INPUT argument or the standard input.  If @c output is
+    not @c NULL, the last tool must produce a matrix, and @c *output
+    is set to a new matrix holding it (to be freed by the caller);
+    otherwise, the last tool writes to its OUTPUT argument or the
+    standard output.  Matrices written through the SMS writer (this
+    includes every tool whose output is a matrix in SMS format) are
+    passed in binary form, never formatted as text; only other text
+    output, e.g., that of `info`, or of `convert` to Matrix Market or
+    Rutherford-Boeing format, is passed as text.  Return the exit code
+    of the pipeline: 0 on success, nonzero on error. */
+int smasto_run(const char* pipeline,
+               const smasto_matrix* input, smasto_matrix** output);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMASTO_H */
@@ -162,7 +162,4 @@ private:
 };
 
 
-int main(int argc, char** argv)
-{
-  return AdjoinProgram().main(argc, argv);
-};
+SMASTO_MAIN("adjoin", AdjoinProgram)
@@ -30,80 +30,164 @@
 
 #include <algorithm>
 #include <iostream>
-#include <map>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif
-
 
+template< typename val_t >
 class BlockEchelonProgram : public FilterProgram,
                          public SMSReader<val_t>,
                          public SMSWriter<val_t>
 {
 public:
   BlockEchelonProgram()
-    : m(), blk()
+    : permutation_only_(false), statistics_(false), triangular_(false), blocks_file_(),
+      row_perm_file_(), col_perm_file_(), perm_format_(TEXT_PERMUTATION),
+      lead_(), entries_(),
+      rowptr_(), colind_(), colptr_(), rowind_(), match_row_(), match_col_()
   {
+    this->add_option('b', "blocks", required_argument,
+                     "Write block boundaries to file ARG, one block per line.");
+    this->add_option('B', "binary-permutation", no_argument,
+                     "Write permutation files in binary format.");
+    this->add_option('C', "column-permutation", required_argument,
+                     "Write the column permutation to file ARG.");
+    this->add_option('P', "permutation-only", no_argument,
+                     "Only compute the row permutation; do not output the permuted matrix.");
+    this->add_option('R', "row-permutation", required_argument,
+                     "Write the row permutation to file ARG.");
+    this->add_option('s', "statistics", no_argument,
+                     "Print block count and block height statistics to standard error.");
+    this->add_option('t', "triangular", no_argument,
+                     "Compute the block triangular form instead of the block echelon form.");
     this->description =
       "Put INPUT matrix in block echelon form.\n"
+      "\n"
+      "Rows are grouped into blocks according to the column index of their\n"
+      "first nonzero entry; blocks are output in order of increasing leading\n"
+      "column, and rows within a block keep their relative INPUT order.\n"
+      "Rows consisting entirely of zeroes are moved to the bottom.\n"
+      "\n"
+      "Options `--row-permutation` and `--column-permutation` save the\n"
+      "computed permutations to a file, for use with `sms-permute`.  With\n"
+      "option `--permutation-only`, matrix entries are not stored at all:\n"
+      "the row permutation is written to the file given with option\n"
+      "`--row-permutation`, or to OUTPUT in text format if that is missing.\n"
+      "Option `--blocks` writes one line per block, giving the first and\n"
+      "last (new) row index and the leading column.\n"
+      "\n"
+      "With option `--triangular`, rows and columns are permuted instead\n"
+      "into the block upper triangular form given by the Dulmage-Mendelsohn\n"
+      "decomposition: a maximum matching of rows to columns puts nonzero\n"
+      "entries on the diagonal (their number is the structural rank), and\n"
+      "the strongly connected components of the matched graph give the\n"
+      "diagonal blocks, each of which can be factored independently.  The\n"
+      "first block holds the columns not covered by the matching (and the\n"
+      "rows they reach), the last one the uncovered rows (and the columns\n"
+      "they reach); either can be empty.  The lines written by `--blocks`\n"
+      "then give the first and last (new) row index and the first and\n"
+      "last column index of each diagonal block.\n"
       ;
   };
 
   void process_option(const int opt, const char* argument)
   {
-    // no options to process
+    if ('b' == opt)
+      blocks_file_ = argument;
+    else if ('B' == opt)
+      perm_format_ = BINARY_PERMUTATION;
+    else if ('C' == opt)
+      col_perm_file_ = argument;
+    else if ('P' == opt)
+      permutation_only_ = true;
+    else if ('R' == opt)
+      row_perm_file_ = argument;
+    else if ('s' == opt)
+      statistics_ = true;
+    else if ('t' == opt)
+      triangular_ = true;
   };
 
+  /** Entry values are only copied, so integer values are fine. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() {
     SMSReader<val_t>::open(*FilterProgram::input_);
     const coord_t nrows = SMSReader<val_t>::rows();
     const coord_t ncols = SMSReader<val_t>::columns();
+    if (triangular_)
+      return run_triangular(nrows, ncols);
 
-    // read matrix entries and group them into `block`
-    read();
+    // `lead_[i]` is the column index of the first nonzero in row `i`;
+    // rows with no entries get the sentinel value `ncols+1`, so that
+    // the counting sort below puts them after all the others
+    lead_.assign(nrows+1, ncols+1);
+    if (not permutation_only_)
+      entries_.reset(nrows, ncols);
+
+    // read matrix entries, tracking the leading column of each row
+    SMSReader<val_t>::read();
     SMSReader<val_t>::close();
 
-    // compute list of blocks
-    //
-    // The SMS format mandates that entries are written to the file in
-    // lexicographic order, so we could actually build the `blk` map
-    // as we read the entries.  However, "be liberal in what you
-    // accept, and be strict in what you produce" so let's build
-    // matrix and blocks in two separate steps, which allows for
-    // out-of-order lines.
-    for(matrix_t::const_iterator r = m.begin(); r != m.end(); ++r) {
-      // find the row item with the minimum column index; this works
-      // as lexicographic comparison is used on `std::pair` and the
-      // column index is the first item in the pair
-      row_t::const_iterator minpair(std::min_element(r->second.begin(), r->second.end()));
-      const coord_t first_nonzero_col = minpair->first;
-      // TODO: add sorting to rows
-      blk[first_nonzero_col].push_back(r->first);
-    };
-
-    // output matrix
-    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
-    coord_t new_row_idx = 0;
-    for(reblock_t::const_iterator b = blk.begin(); b != blk.end(); ++b) {
-      // output all rows in the block
-      for(block_t::const_iterator i = b->second.begin(); i != b->second.end(); ++i) {
-        ++new_row_idx;
-        const coord_t old_row_idx = *i;
-        row_t const& r = m[old_row_idx];
-        for(row_t::const_iterator c = r.begin(); c != r.end(); ++c)
-          write_entry(new_row_idx, c->first, c->second);
+    // counting sort of rows by leading column; `start[c]` is the
+    // (0-based) new position of the first row in the block led by
+    // column `c`.  Rows are visited in increasing index order, so the
+    // sort is stable.
+    std::vector<coord_t> start(ncols+3, 0);
+    for (coord_t i = 1; i <= nrows; ++i)
+      ++start[lead_[i]+1];
+    for (coord_t c = 1; c <= ncols+2; ++c)
+      start[c] += start[c-1];
+
+    // `order[k]` is the old index of the row that goes into position
+    // `k+1`; `new_row[i]` is the inverse mapping
+    std::vector<coord_t> order(nrows);
+    std::vector<coord_t> new_row(nrows+1, 0);
+    {
+      std::vector<coord_t> next(start.begin(), start.end() - 1);
+      for (coord_t i = 1; i <= nrows; ++i) {
+        const coord_t k = next[lead_[i]]++;
+        order[k] = i;
+        new_row[i] = k+1;
       };
     };
+
+    if (not blocks_file_.empty())
+      write_blocks(start, ncols);
+    if (statistics_)
+      print_statistics(start, nrows, ncols);
+
+    if (not row_perm_file_.empty())
+      write_permutation(row_perm_file_, order, perm_format_);
+    if (not col_perm_file_.empty()) {
+      // block echelon form leaves columns untouched
+      std::vector<coord_t> identity(ncols);
+      for (coord_t j = 0; j < ncols; ++j)
+        identity[j] = j+1;
+      write_permutation(col_perm_file_, identity, perm_format_);
+    };
+
+    if (permutation_only_) {
+      if (row_perm_file_.empty()) {
+        for (coord_t k = 0; k < nrows; ++k)
+          (*FilterProgram::output_) << order[k] << '\n';
+        FilterProgram::output_->flush();
+      };
+      return 0;
+    };
+
+    // bucket entries by their new row index
+    entries_.renumber_rows(new_row);
+
+    // output matrix, one new row at a time; SMS files are normally
+    // sorted, so sorting within rows is usually a no-op
+    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
+    entries_.write_sorted(*this, nrows, ncols);
     SMSWriter<val_t>::close();
 
     return 0;
@@ -111,27 +195,472 @@ public:
 
   void process_entry(const coord_t i, const coord_t j, const val_t& value)
   {
-    m[i][j] = value;
+    if (triangular_) {
+      // the nonzero pattern is needed even if only permuting
+      entries_.push_back(i, j, value);
+      return;
+    };
+    if (j < lead_[i])
+      lead_[i] = j;
+    if (not permutation_only_)
+      entries_.push_back(i, j, value);
   };
 
 
 private:
-  /// a sparse row is just a map from column index to value
-  typedef std::map< coord_t, val_t > row_t;
-  /// a sparse matrix is a map from row index to sparse row
-  typedef std::map< coord_t, row_t > matrix_t;
-  /// matrix data (as read from the stream)
-  matrix_t m;
-
-  /// a block is a sequence of row numbers
-  typedef std::vector< coord_t > block_t;
-  typedef std::map< coord_t,block_t > reblock_t;
-  /// map column index to set of rows that start at that column
-  reblock_t blk;
-};
+  bool permutation_only_;
+  bool statistics_;
+  bool triangular_;
+  std::string blocks_file_;
+  std::string row_perm_file_;
+  std::string col_perm_file_;
+  permutation_format perm_format_;
 
+  /// column index of the first nonzero entry in each row
+  std::vector<coord_t> lead_;
 
-int main(int argc, char** argv)
-{
-  return BlockEchelonProgram().main(argc, argv);
+  /// matrix entries, in the order they were read from the stream
+  EntryList<val_t> entries_;
+
+  /// nonzero pattern by rows (CSR) and by columns (CSC), with 0-based
+  /// indices: row `i` has entries in columns `colind_[rowptr_[i]]` to
+  /// `colind_[rowptr_[i+1]-1]`, and likewise for columns
+  std::vector<std::size_t> rowptr_;
+  std::vector<coord_t> colind_;
+  std::vector<std::size_t> colptr_;
+  std::vector<coord_t> rowind_;
+
+  /// column matched to each row, and row matched to each column, or -1
+  std::vector<coord_t> match_row_;
+  std::vector<coord_t> match_col_;
+
+  /** Diagonal block of the block triangular form, as ranges of new
+      (0-based) row and column indices. */
+  struct Block
+  {
+    coord_t first_row;
+    coord_t end_row;
+    coord_t first_col;
+    coord_t end_col;
+  };
+
+  int run_triangular(const coord_t nrows, const coord_t ncols)
+  {
+    entries_.reset(nrows, ncols);
+    SMSReader<val_t>::read();
+    SMSReader<val_t>::close();
+
+    build_pattern(nrows, ncols);
+    const coord_t rank = maximum_matching(nrows, ncols);
+
+    // `row_order` and `col_order` list old (0-based) indices in their
+    // new order
+    std::vector<coord_t> row_order, col_order;
+    std::vector<Block> blocks;
+    decompose(nrows, ncols, row_order, col_order, blocks);
+    std::vector<std::size_t>().swap(rowptr_);
+    std::vector<coord_t>().swap(colind_);
+    std::vector<std::size_t>().swap(colptr_);
+    std::vector<coord_t>().swap(rowind_);
+
+    std::vector<coord_t> order(nrows);
+    std::vector<coord_t> new_row(nrows+1, 0);
+    for (coord_t k = 0; k < nrows; ++k) {
+      order[k] = row_order[k] + 1;
+      new_row[order[k]] = k+1;
+    };
+    std::vector<coord_t> col_perm(ncols);
+    std::vector<coord_t> new_col(ncols+1, 0);
+    for (coord_t k = 0; k < ncols; ++k) {
+      col_perm[k] = col_order[k] + 1;
+      new_col[col_perm[k]] = k+1;
+    };
+
+    if (not blocks_file_.empty())
+      write_triangular_blocks(blocks);
+    if (statistics_)
+      print_triangular_statistics(blocks, rank);
+
+    if (not row_perm_file_.empty())
+      write_permutation(row_perm_file_, order, perm_format_);
+    if (not col_perm_file_.empty())
+      write_permutation(col_perm_file_, col_perm, perm_format_);
+
+    if (permutation_only_) {
+      if (row_perm_file_.empty()) {
+        for (coord_t k = 0; k < nrows; ++k)
+          (*FilterProgram::output_) << order[k] << '\n';
+        FilterProgram::output_->flush();
+      };
+      return 0;
+    };
+
+    entries_.renumber_rows(new_row);
+    entries_.renumber_columns(new_col);
+    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
+    entries_.write_sorted(*this, nrows, ncols);
+    SMSWriter<val_t>::close();
+
+    return 0;
+  };
+
+  /// Build the CSR and CSC patterns from the entries read.
+  void build_pattern(const coord_t nrows, const coord_t ncols)
+  {
+    const std::size_t nnz = entries_.size();
+    rowptr_.assign(nrows+1, 0);
+    colptr_.assign(ncols+1, 0);
+    for (std::size_t n = 0; n < nnz; ++n) {
+      ++rowptr_[entries_.row(n)];
+      ++colptr_[entries_.column(n)];
+    };
+    for (coord_t i = 0; i < nrows; ++i)
+      rowptr_[i+1] += rowptr_[i];
+    for (coord_t j = 0; j < ncols; ++j)
+      colptr_[j+1] += colptr_[j];
+    colind_.resize(nnz);
+    rowind_.resize(nnz);
+    std::vector<std::size_t> rpos(rowptr_.begin(), rowptr_.end() - 1);
+    std::vector<std::size_t> cpos(colptr_.begin(), colptr_.end() - 1);
+    for (std::size_t n = 0; n < nnz; ++n) {
+      const coord_t i = entries_.row(n) - 1;
+      const coord_t j = entries_.column(n) - 1;
+      colind_[rpos[i]++] = j;
+      rowind_[cpos[j]++] = i;
+    };
+  };
+
+  /// Match rows to columns with the Hopcroft-Karp algorithm; return
+  /// the size of the matching, i.e., the structural rank.
+  coord_t maximum_matching(const coord_t nrows, const coord_t ncols)
+  {
+    match_row_.assign(nrows, -1);
+    match_col_.assign(ncols, -1);
+
+    // a greedy matching usually leaves little work for the phases below
+    coord_t size = 0;
+    for (coord_t i = 0; i < nrows; ++i)
+      for (std::size_t p = rowptr_[i]; p < rowptr_[i+1]; ++p)
+        if (-1 == match_col_[colind_[p]]) {
+          match_row_[i] = colind_[p];
+          match_col_[colind_[p]] = i;
+          ++size;
+          break;
+        };
+
+    const coord_t unreached = nrows + 1;
+    std::vector<coord_t> dist(nrows);
+    std::vector<coord_t> queue;
+    std::vector<std::size_t> next(nrows);
+    std::vector<coord_t> stack;
+    for (;;) {
+      // breadth-first search from the unmatched rows, along alternating
+      // paths, until some unmatched column is found
+      queue.clear();
+      for (coord_t i = 0; i < nrows; ++i)
+        if (-1 == match_row_[i] and rowptr_[i] < rowptr_[i+1]) {
+          dist[i] = 0;
+          queue.push_back(i);
+        }
+        else
+          dist[i] = unreached;
+      const std::size_t roots = queue.size();
+      // only the layers up to the first unmatched column are needed
+      coord_t found = unreached;
+      for (std::size_t q = 0; q < queue.size() and dist[queue[q]] < found; ++q) {
+        const coord_t i = queue[q];
+        for (std::size_t p = rowptr_[i]; p < rowptr_[i+1]; ++p) {
+          const coord_t w = match_col_[colind_[p]];
+          if (-1 == w)
+            found = dist[i];
+          else if (unreached == dist[w]) {
+            dist[w] = dist[i] + 1;
+            queue.push_back(w);
+          };
+        };
+      };
+      if (unreached == found)
+        break;
+
+      // depth-first search along the layers for disjoint augmenting
+      // paths; `next[i]` is the next entry of row `i` to try
+      for (coord_t i = 0; i < nrows; ++i)
+        next[i] = rowptr_[i];
+      for (std::size_t q = 0; q < roots; ++q) {
+        stack.assign(1, queue[q]);
+        while (not stack.empty()) {
+          const coord_t i = stack.back();
+          if (next[i] == rowptr_[i+1]) {
+            // dead end
+            dist[i] = unreached;
+            stack.pop_back();
+            continue;
+          };
+          const coord_t w = match_col_[colind_[next[i]]];
+          if (-1 == w) {
+            // augment: each row on the stack takes the column it points to
+            for (std::vector<coord_t>::const_iterator r = stack.begin(); r != stack.end(); ++r) {
+              const coord_t j = colind_[next[*r]];
+              match_row_[*r] = j;
+              match_col_[j] = *r;
+              dist[*r] = unreached;
+            };
+            ++size;
+            break;
+          }
+          else if (dist[w] == dist[i] + 1)
+            stack.push_back(w);
+          else
+            ++next[i];
+        };
+      };
+    };
+    return size;
+  };
+
+  /// Compute the Dulmage-Mendelsohn decomposition from the matching.
+  void decompose(const coord_t nrows, const coord_t ncols,
+                 std::vector<coord_t>& row_order, std::vector<coord_t>& col_order,
+                 std::vector<Block>& blocks)
+  {
+    // 1 = reachable from an unmatched column, 3 = from an unmatched
+    // row, 2 = neither (the square, perfectly matched part)
+    std::vector<char> row_set(nrows, 2), col_set(ncols, 2);
+    std::vector<coord_t> queue;
+    for (coord_t j = 0; j < ncols; ++j)
+      if (-1 == match_col_[j]) {
+        col_set[j] = 1;
+        queue.push_back(j);
+      };
+    for (std::size_t q = 0; q < queue.size(); ++q)
+      for (std::size_t p = colptr_[queue[q]]; p < colptr_[queue[q]+1]; ++p) {
+        const coord_t i = rowind_[p];
+        if (1 == row_set[i])
+          continue;
+        // `i` is matched, or the matching would not be maximum
+        row_set[i] = 1;
+        col_set[match_row_[i]] = 1;
+        queue.push_back(match_row_[i]);
+      };
+    queue.clear();
+    for (coord_t i = 0; i < nrows; ++i)
+      if (-1 == match_row_[i]) {
+        row_set[i] = 3;
+        queue.push_back(i);
+      };
+    for (std::size_t q = 0; q < queue.size(); ++q)
+      for (std::size_t p = rowptr_[queue[q]]; p < rowptr_[queue[q]+1]; ++p) {
+        const coord_t j = colind_[p];
+        if (3 == col_set[j])
+          continue;
+        col_set[j] = 3;
+        row_set[match_col_[j]] = 3;
+        queue.push_back(match_col_[j]);
+      };
+
+    row_order.clear();
+    col_order.clear();
+    row_order.reserve(nrows);
+    col_order.reserve(ncols);
+
+    // first block: columns in their original order, matched rows
+    // in the same order
+    for (coord_t j = 0; j < ncols; ++j)
+      if (1 == col_set[j]) {
+        col_order.push_back(j);
+        if (-1 != match_col_[j])
+          row_order.push_back(match_col_[j]);
+      };
+    if (not col_order.empty())
+      add_block(blocks, row_order, col_order);
+
+    // diagonal blocks of the square part
+    strong_components(col_set, row_order, col_order, blocks);
+
+    // last block: columns and matched rows, then the unmatched rows
+    for (coord_t j = 0; j < ncols; ++j)
+      if (3 == col_set[j]) {
+        col_order.push_back(j);
+        row_order.push_back(match_col_[j]);
+      };
+    for (coord_t i = 0; i < nrows; ++i)
+      if (-1 == match_row_[i])
+        row_order.push_back(i);
+    if (static_cast<coord_t>(row_order.size()) > (blocks.empty()? 0 : blocks.back().end_row))
+      add_block(blocks, row_order, col_order);
+  };
+
+  /// Append a block ending at the current size of the row and column
+  /// lists, and starting where the previous block ended.
+  static void add_block(std::vector<Block>& blocks,
+                        const std::vector<coord_t>& row_order, const std::vector<coord_t>& col_order)
+  {
+    Block b;
+    b.first_row = (blocks.empty()? 0 : blocks.back().end_row);
+    b.first_col = (blocks.empty()? 0 : blocks.back().end_col);
+    b.end_row = row_order.size();
+    b.end_col = col_order.size();
+    blocks.push_back(b);
+  };
+
+  /// Find the strongly connected components of the graph with an edge
+  /// from column `j` to column `k` whenever the row matched to `j` has
+  /// an entry in column `k`, restricted to the columns in set 2, with
+  /// Tarjan's algorithm.  Append each component, with its matched
+  /// rows, as a block, in an order that makes the matrix block upper
+  /// triangular.
+  void strong_components(const std::vector<char>& col_set,
+                         std::vector<coord_t>& row_order, std::vector<coord_t>& col_order,
+                         std::vector<Block>& blocks)
+  {
+    const coord_t ncols = col_set.size();
+    std::vector<coord_t> index(ncols, -1);
+    std::vector<coord_t> low(ncols);
+    std::vector<char> on_stack(ncols, 0);
+    std::vector<coord_t> stack;
+    // depth-first search path, and the next entry to visit for each
+    std::vector<coord_t> path;
+    std::vector<std::size_t> next(ncols);
+    // Tarjan's algorithm finds a component only after all those
+    // reachable from it, so components are collected in reverse
+    std::vector<coord_t> found;
+    std::vector<std::size_t> found_end;
+    coord_t counter = 0;
+    for (coord_t root = 0; root < ncols; ++root) {
+      if (2 != col_set[root] or -1 != index[root])
+        continue;
+      path.assign(1, root);
+      index[root] = low[root] = counter++;
+      next[root] = rowptr_[match_col_[root]];
+      stack.push_back(root);
+      on_stack[root] = 1;
+      while (not path.empty()) {
+        const coord_t v = path.back();
+        const coord_t i = match_col_[v];
+        if (next[v] < rowptr_[i+1]) {
+          const coord_t w = colind_[next[v]++];
+          if (2 != col_set[w])
+            continue;
+          if (-1 == index[w]) {
+            index[w] = low[w] = counter++;
+            next[w] = rowptr_[match_col_[w]];
+            stack.push_back(w);
+            on_stack[w] = 1;
+            path.push_back(w);
+          }
+          else if (on_stack[w])
+            low[v] = std::min(low[v], index[w]);
+          continue;
+        };
+        path.pop_back();
+        if (not path.empty())
+          low[path.back()] = std::min(low[path.back()], low[v]);
+        if (low[v] == index[v]) {
+          coord_t w;
+          do {
+            w = stack.back();
+            stack.pop_back();
+            on_stack[w] = 0;
+            found.push_back(w);
+          } while (w != v);
+          found_end.push_back(found.size());
+        };
+      };
+    };
+
+    for (std::size_t c = found_end.size(); c > 0; --c) {
+      const std::size_t begin = (c > 1? found_end[c-2] : 0);
+      for (std::size_t k = begin; k < found_end[c-1]; ++k) {
+        col_order.push_back(found[k]);
+        row_order.push_back(match_col_[found[k]]);
+      };
+      add_block(blocks, row_order, col_order);
+    };
+  };
+
+  /// Write one line per diagonal block: first and last row, first and
+  /// last column.
+  void write_triangular_blocks(const std::vector<Block>& blocks)
+  {
+    errno = 0;
+    std::ofstream out(blocks_file_.c_str());
+    if (not out.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open file '" << blocks_file_ << "' for writing: " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    for (typename std::vector<Block>::const_iterator b = blocks.begin(); b != blocks.end(); ++b)
+      out << (b->first_row + 1) << " " << b->end_row << " "
+          << (b->first_col + 1) << " " << b->end_col << '\n';
+    if (out.bad()) {
+      std::ostringstream msg;
+      msg << "Error writing to file '" << blocks_file_ << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+  };
+
+  /// Print structural rank, number of blocks and block size statistics.
+  void print_triangular_statistics(const std::vector<Block>& blocks, const coord_t rank)
+  {
+    std::vector<coord_t> sizes;
+    coord_t singletons = 0;
+    for (typename std::vector<Block>::const_iterator b = blocks.begin(); b != blocks.end(); ++b) {
+      sizes.push_back(std::max(b->end_row - b->first_row, b->end_col - b->first_col));
+      if (1 == b->end_row - b->first_row and 1 == b->end_col - b->first_col)
+        ++singletons;
+    };
+    std::cerr << "Structural rank: " << rank << std::endl;
+    std::cerr << "Blocks: " << blocks.size() << std::endl;
+    std::cerr << "Singleton blocks: " << singletons << std::endl;
+    if (sizes.empty())
+      return;
+    std::sort(sizes.begin(), sizes.end());
+    std::cerr << "Max. block size: " << sizes.back() << std::endl;
+    std::cerr << "Median block size: " << sizes[sizes.size() / 2] << std::endl;
+  };
+
+  /// Write one line per block: first row, last row, leading column.
+  void write_blocks(const std::vector<coord_t>& start, const coord_t ncols)
+  {
+    errno = 0;
+    std::ofstream out(blocks_file_.c_str());
+    if (not out.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open file '" << blocks_file_ << "' for writing: " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    for (coord_t c = 1; c <= ncols; ++c)
+      if (start[c+1] > start[c])
+        out << (start[c] + 1) << " " << start[c+1] << " " << c << '\n';
+    if (out.bad()) {
+      std::ostringstream msg;
+      msg << "Error writing to file '" << blocks_file_ << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+  };
+
+  /// Print number of blocks and summary statistics of block heights.
+  void print_statistics(const std::vector<coord_t>& start,
+                        const coord_t nrows, const coord_t ncols)
+  {
+    std::vector<coord_t> heights;
+    for (coord_t c = 1; c <= ncols; ++c)
+      if (start[c+1] > start[c])
+        heights.push_back(start[c+1] - start[c]);
+    const coord_t zero_rows = start[ncols+2] - start[ncols+1];
+
+    std::cerr << "Blocks: " << heights.size() << std::endl;
+    std::cerr << "Zero rows: " << zero_rows << std::endl;
+    if (heights.empty())
+      return;
+    std::sort(heights.begin(), heights.end());
+    std::cerr << "Min. block height: " << heights.front() << std::endl;
+    std::cerr << "Max. block height: " << heights.back() << std::endl;
+    std::cerr << "Mean block height: "
+              << (1.0 * (nrows - zero_rows) / heights.size()) << std::endl;
+    std::cerr << "Median block height: " << heights[heights.size() / 2] << std::endl;
+  };
 };
+
+
+SMASTO_TYPED_MAIN("blockechelon", BlockEchelonProgram)
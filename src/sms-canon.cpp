@@ -0,0 +1,378 @@
+/**
+ * @file   sms-canon.cpp
+ *
+ * Put a matrix in canonical form: entries sorted in row-major or
+ * column-major order, with duplicates coalesced and zeroes dropped.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// entry coordinates packed into a single sort key
+typedef uint64_t packed_key_t;
+
+
+/// number of bits sorted in each pass of the radix sort
+static const int RADIX_BITS = 11;
+
+/// number of entries formatted at a time by each thread
+static const std::size_t BLOCK_ENTRIES = 65536;
+
+
+/** Return the number of bits needed to represent @c x. */
+static int bit_width(uint64_t x)
+{
+  int bits = 0;
+  for (; x != 0; x >>= 1)
+    ++bits;
+  return bits;
+};
+
+
+/** Sort @c keys by their lowest @c bits bits, and rearrange @c pos
+    alongside, with a stable least-significant-digit radix sort.  The
+    input is cut into a fixed number of slices; each pass counts digits
+    in a per-slice histogram, and then scatters the slices in order, so
+    that the sort is stable and complete whatever the number of threads
+    that actually run.  Passes in which all keys have the same digit
+    are skipped. */
+template< typename pos_t >
+void radix_sort(std::vector<packed_key_t>& keys, std::vector<pos_t>& pos, const int bits)
+{
+  const std::size_t n = keys.size();
+  const int npasses = (bits + RADIX_BITS - 1) / RADIX_BITS;
+  if (0 == npasses)
+    return;
+  // spread the bits evenly over the passes
+  const int digit_bits = (bits + npasses - 1) / npasses;
+  const std::size_t radix = std::size_t(1) << digit_bits;
+  const packed_key_t mask = radix - 1;
+
+#ifdef _OPENMP
+  const int nslices = (n > 65536? omp_get_max_threads() : 1);
+#else
+  const int nslices = 1;
+#endif
+
+  std::vector<packed_key_t> keys2(n);
+  std::vector<pos_t> pos2(n);
+  // `offset[s*radix + d]` is the position where slice `s` stores
+  // its next key with digit `d`
+  std::vector<std::size_t> offset(nslices * radix);
+  for (int pass = 0; pass < npasses; ++pass) {
+    TraceSpan span("radix sort pass");
+    const int shift = pass * digit_bits;
+    std::fill(offset.begin(), offset.end(), 0);
+    bool skip = false;
+#pragma omp parallel if(nslices > 1)
+    {
+#pragma omp for schedule(static)
+      for (int s = 0; s < nslices; ++s) {
+        std::size_t* const next = &offset[0] + s * radix;
+        const std::size_t hi = n * (s+1) / nslices;
+        for (std::size_t k = n * s / nslices; k < hi; ++k)
+          ++next[(keys[k] >> shift) & mask];
+      };
+      // implicit barrier at the end of `omp for`
+#pragma omp single
+      {
+        std::size_t start = 0;
+        for (std::size_t d = 0; d < radix; ++d)
+          for (int u = 0; u < nslices; ++u) {
+            const std::size_t count = offset[u * radix + d];
+            if (count == n)
+              skip = true;
+            offset[u * radix + d] = start;
+            start += count;
+          };
+      };
+      if (not skip) {
+#pragma omp for schedule(static)
+        for (int s = 0; s < nslices; ++s) {
+          std::size_t* const next = &offset[0] + s * radix;
+          const std::size_t hi = n * (s+1) / nslices;
+          for (std::size_t k = n * s / nslices; k < hi; ++k) {
+            const std::size_t j = next[(keys[k] >> shift) & mask]++;
+            keys2[j] = keys[k];
+            pos2[j] = pos[k];
+          };
+        };
+      };
+    };
+    if (not skip) {
+      keys.swap(keys2);
+      pos.swap(pos2);
+    };
+  };
+};
+
+
+/** Format canonical entries, a block of consecutive ones at a time;
+    see @ref SMSWriter::write_blocks. */
+template< typename val_t >
+struct CanonEntries
+{
+  const std::vector<packed_key_t>& keys;
+  const std::vector<val_t>& values;
+  const SMSWriter<val_t>& writer;
+  std::size_t nnz;
+  int shift;
+  bool column_major;
+
+  CanonEntries(const std::vector<packed_key_t>& keys_, const std::vector<val_t>& values_,
+               const SMSWriter<val_t>& writer_, const std::size_t nnz_,
+               const int shift_, const bool column_major_)
+    : keys(keys_), values(values_), writer(writer_), nnz(nnz_),
+      shift(shift_), column_major(column_major_)
+  { };
+
+  template< typename buffer_t >
+  void operator()(const std::size_t block, buffer_t& buf)
+  {
+    const std::size_t first = block * BLOCK_ENTRIES;
+    const std::size_t last = std::min(first + BLOCK_ENTRIES, nnz);
+    const packed_key_t mask = (packed_key_t(1) << shift) - 1;
+    for (std::size_t k = first; k < last; ++k) {
+      const coord_t major = (keys[k] >> shift) + 1;
+      const coord_t minor = (keys[k] & mask) + 1;
+      if (column_major)
+        writer.format_entry(buf, minor, major, values[k]);
+      else
+        writer.format_entry(buf, major, minor, values[k]);
+    };
+  };
+};
+
+
+template< typename val_t >
+class CanonProgram : public FilterProgram,
+                     public SMSReader<val_t>,
+                     public SMSWriter<val_t>
+{
+public:
+  /** What to do with entries that have the same coordinates. */
+  typedef enum { SUM_DUPLICATES, FIRST_DUPLICATE, LAST_DUPLICATE, REJECT_DUPLICATES } duplicate_policy;
+
+  CanonProgram()
+    : column_major_(false), policy_(SUM_DUPLICATES), mark_(false),
+      shift_(0), keys_(), values_(), sorted_(true)
+  {
+    this->add_option('m', "mark", no_argument,
+                     "Declare in the SMS header of OUTPUT that it is in canonical form.");
+    this->add_option('d', "duplicates", required_argument,
+                     "Coalesce entries with the same coordinates by ARG: one of 'sum' (default), 'first', 'last', or 'error'.");
+    this->add_option('c', "column-major", no_argument,
+                     "Sort entries by column and then by row (default: by row and then by column).");
+    this->description =
+      "Copy INPUT matrix to OUTPUT in canonical form: entries sorted by\n"
+      "row and then by column (or, with option '--column-major', by\n"
+      "column and then by row), with at most one entry per position and\n"
+      "no explicit zeroes.  Entries with the same coordinates are\n"
+      "coalesced as given by option '--duplicates': their values are\n"
+      "added up ('sum'), the one that comes first (resp. last) in INPUT\n"
+      "is kept ('first', 'last'), or the program stops with an error\n"
+      "('error').  Entries that are zero after coalescing are dropped.\n"
+      "\n"
+      "Entries are sorted with a parallel radix sort on their packed\n"
+      "coordinates; INPUT that is already sorted is detected while\n"
+      "reading, and not sorted again.\n"
+      "\n"
+      "With option '--mark', the OUTPUT header declares the order of\n"
+      "entries with a word after the 'M' ('canonical=row' or\n"
+      "'canonical=column'), so that other tools can take faster paths.\n"
+      "Other SMS readers may not accept this word, so the header is\n"
+      "plain by default.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('m' == opt)
+      mark_ = true;
+    else if ('c' == opt)
+      column_major_ = true;
+    else if ('d' == opt) {
+      const std::string policy(argument);
+      if ("sum" == policy)
+        policy_ = SUM_DUPLICATES;
+      else if ("first" == policy)
+        policy_ = FIRST_DUPLICATE;
+      else if ("last" == policy)
+        policy_ = LAST_DUPLICATE;
+      else if ("error" == policy)
+        policy_ = REJECT_DUPLICATES;
+      else {
+        std::ostringstream msg;
+        msg << "Unknown duplicate policy '" << policy << "':"
+            << " use one of 'sum', 'first', 'last', or 'error'.";
+        throw std::runtime_error(msg.str());
+      };
+    };
+  };
+
+  /** Integer values are summed exactly, and otherwise only copied. */
+  bool integer_values_ok(const long double) const { return true; };
+
+  int run()
+  {
+    SMSReader<val_t>::open(*FilterProgram::input_);
+    const coord_t nrows = SMSReader<val_t>::rows();
+    const coord_t ncols = SMSReader<val_t>::columns();
+    const coord_t nmajor = (column_major_? ncols : nrows);
+    const coord_t nminor = (column_major_? nrows : ncols);
+    // the minor index goes in the low bits of the key
+    shift_ = (nminor > 0? bit_width(nminor - 1) : 0);
+    const int bits = shift_ + (nmajor > 0? bit_width(nmajor - 1) : 0);
+    if (bits > 64) {
+      std::ostringstream msg;
+      msg << "Cannot sort the entries of a " << nrows << "x" << ncols << " matrix:"
+          << " its coordinates do not fit in 64 bits.";
+      throw std::runtime_error(msg.str());
+    };
+    SMSReader<val_t>::read();
+    SMSReader<val_t>::close();
+
+    if (not sorted_) {
+      if (keys_.size() <= 0xffffffffUL)
+        sort<uint32_t>(bits);
+      else
+        sort<std::size_t>(bits);
+    };
+    const std::size_t nnz = coalesce();
+
+    SMSWriter<val_t>::set_order(not mark_? UNSORTED_ORDER
+                                : column_major_? COLUMN_MAJOR_ORDER
+                                : ROW_MAJOR_ORDER);
+    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
+    CanonEntries<val_t> gen(keys_, values_, *this, nnz, shift_, column_major_);
+    SMSWriter<val_t>::write_blocks((nnz + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES, gen);
+    SMSWriter<val_t>::close();
+
+    return 0;
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    const packed_key_t key = (column_major_?
+                       (packed_key_t(j - 1) << shift_) | packed_key_t(i - 1)
+                       : (packed_key_t(i - 1) << shift_) | packed_key_t(j - 1));
+    if (not keys_.empty() and key < keys_.back())
+      sorted_ = false;
+    keys_.push_back(key);
+    values_.push_back(value);
+  };
+
+
+private:
+  bool column_major_;
+  duplicate_policy policy_;
+  /// whether to declare the order of entries in the OUTPUT header
+  bool mark_;
+
+  /// number of bits of the minor index in a key
+  int shift_;
+
+  /// entries, as packed coordinates and values
+  std::vector<packed_key_t> keys_;
+  std::vector<val_t> values_;
+
+  /// `true` if the keys were read in non-decreasing order
+  bool sorted_;
+
+  /// Sort entries by key, keeping entries with the same key in
+  /// INPUT order; `pos_t` must be able to hold the number of entries.
+  template< typename pos_t >
+  void sort(const int bits)
+  {
+    PhaseTimer timer(RunStats::current(), RunStats::COMPUTE);
+    const std::size_t n = keys_.size();
+    std::vector<pos_t> pos(n);
+    for (std::size_t k = 0; k < n; ++k)
+      pos[k] = k;
+    radix_sort(keys_, pos, bits);
+
+    TraceSpan span("gather values");
+    std::vector<val_t> values(n);
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < static_cast<long>(n); ++k)
+      values[k] = values_[pos[k]];
+    values_.swap(values);
+  };
+
+  /// Merge runs of entries with the same key according to `policy_`,
+  /// and drop zeroes; return the number of entries left, which are
+  /// moved to the front of `keys_` and `values_`.
+  std::size_t coalesce()
+  {
+    TraceSpan span("coalesce duplicates");
+    const std::size_t n = keys_.size();
+    std::size_t kept = 0;
+    for (std::size_t k = 0; k < n; ) {
+      std::size_t end = k + 1;
+      while (end < n and keys_[end] == keys_[k])
+        ++end;
+      val_t value = values_[k];
+      if (end > k + 1) {
+        if (REJECT_DUPLICATES == policy_) {
+          const packed_key_t mask = (packed_key_t(1) << shift_) - 1;
+          const coord_t major = (keys_[k] >> shift_) + 1;
+          const coord_t minor = (keys_[k] & mask) + 1;
+          std::ostringstream msg;
+          msg << "Duplicate entry ("
+              << (column_major_? minor : major) << ","
+              << (column_major_? major : minor) << ") in INPUT.";
+          throw std::runtime_error(msg.str());
+        }
+        else if (LAST_DUPLICATE == policy_)
+          value = values_[end - 1];
+        else if (SUM_DUPLICATES == policy_)
+          for (std::size_t m = k + 1; m < end; ++m)
+            value = checked_add(value, values_[m]);
+      };
+      if (not is_zero(value)) {
+        keys_[kept] = keys_[k];
+        values_[kept] = value;
+        ++kept;
+      };
+      k = end;
+    };
+    return kept;
+  };
+};
+
+
+SMASTO_TYPED_MAIN("canon", CanonProgram)
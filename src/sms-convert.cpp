@@ -0,0 +1,830 @@
+/**
+ * @file   sms-convert.cpp
+ *
+ * Convert matrices between the SMS, Matrix Market and
+ * Rutherford-Boeing (Harwell-Boeing) formats.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// converting does not care about the type of the entries: values are
+// copied as text, so no precision is lost
+typedef std::string val_t;
+
+
+/** Matrix file formats known to `sms-convert`. */
+typedef enum { AUTO_FORMAT, SMS_FORMAT, MM_FORMAT, RB_FORMAT } matrix_format;
+
+static matrix_format
+parse_format(const std::string& name)
+{
+  std::string lname(name);
+  std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+  if ("auto" == lname)
+    return AUTO_FORMAT;
+  if ("sms" == lname)
+    return SMS_FORMAT;
+  if ("mm" == lname or "mtx" == lname or "matrixmarket" == lname)
+    return MM_FORMAT;
+  if ("rb" == lname or "hb" == lname
+      or "rutherford-boeing" == lname or "harwell-boeing" == lname)
+    return RB_FORMAT;
+  std::ostringstream msg;
+  msg << "Unknown matrix format '" << name << "';"
+      << " use one of: sms, mm, rb.";
+  throw std::runtime_error(msg.str());
+};
+
+
+/** Repeat count and field width of a Fortran format like "(16I5)"
+    or "(1P,5E16.8)", as used in Rutherford-Boeing files. */
+struct FortranFormat
+{
+  std::size_t count;
+  std::size_t width;
+
+  FortranFormat() : count(1), width(0) { };
+  explicit FortranFormat(const std::string& spec);
+};
+
+FortranFormat::FortranFormat(const std::string& spec)
+  : count(1), width(0)
+{
+  std::string s;
+  for (std::string::const_iterator c = spec.begin(); c != spec.end(); ++c)
+    if (not std::isspace(*c) and '(' != *c and ')' != *c)
+      s += std::toupper(*c);
+  // skip a scale factor, e.g., "1P,"
+  const std::size_t p = s.find('P');
+  if (std::string::npos != p)
+    s.erase(0, ('.' == s[p+1] or ',' == s[p+1]) ? p+2 : p+1);
+  const char* text = s.c_str();
+  char* end;
+  const long n = std::strtol(text, &end, 10);
+  if (end != text)
+    count = n;
+  if (std::strchr("IEDFG", *end) and '\0' != *end)
+    width = std::strtol(end + 1, NULL, 10);
+  if (0 == count or 0 == width) {
+    std::ostringstream msg;
+    msg << "Unsupported Fortran format '" << spec << "' in Rutherford-Boeing header.";
+    throw std::runtime_error(msg.str());
+  };
+};
+
+
+/// Number of decimal digits in `n`.
+static int
+digits(unsigned long long n)
+{
+  int d = 1;
+  while (n >= 10) {
+    n /= 10;
+    ++d;
+  };
+  return d;
+};
+
+
+/// Return `value` with its sign flipped.
+static std::string
+negated(const std::string& value)
+{
+  if (value.empty())
+    return value;
+  if ('-' == value[0])
+    return value.substr(1);
+  if ('+' == value[0])
+    return "-" + value.substr(1);
+  return "-" + value;
+};
+
+
+/// Return @c true if `value` is written as an integer.
+static bool
+is_integer(const std::string& value)
+{
+  std::size_t k = 0;
+  if (k < value.size() and ('-' == value[k] or '+' == value[k]))
+    ++k;
+  if (k == value.size())
+    return false;
+  for (; k < value.size(); ++k)
+    if (not std::isdigit(value[k]))
+      return false;
+  return true;
+};
+
+
+class ConvertProgram : public FilterProgram,
+                       public SMSReader<val_t>,
+                       public SMSWriter<val_t>
+{
+public:
+  ConvertProgram()
+    : from_(AUTO_FORMAT), to_(SMS_FORMAT), symmetry_('G'), pattern_(false),
+      count_(0), written_(0), integer_(true), header_pos_(-1),
+      title_(), key_(), line_(), pos_(0), fields_(0),
+      rows_(), columns_(), values_()
+  {
+    this->add_option('f', "from", required_argument,
+                     "Format of the INPUT matrix: sms, mm (Matrix Market), rb (Rutherford-Boeing),"
+                     " or auto (default).");
+    this->add_option('t', "to", required_argument,
+                     "Format of the OUTPUT matrix: sms (default), mm, or rb.");
+    this->description =
+      "Convert the INPUT matrix to another format, and write it to OUTPUT.\n"
+      "Known formats are J.-G. Dumas' SMS format, Matrix Market\n"
+      "(coordinate; real, integer or pattern; general, symmetric or\n"
+      "skew-symmetric), and Rutherford-Boeing (or Harwell-Boeing;\n"
+      "real, integer or pattern; assembled).  Symmetric matrices are\n"
+      "expanded, so the OUTPUT matrix holds all its entries.\n"
+      "\n"
+      "The format of INPUT is detected from its first line, unless\n"
+      "option '--from' is given.  Entry values are copied as text,\n"
+      "exactly as they are in INPUT.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('f' == opt)
+      from_ = parse_format(argument);
+    else if ('t' == opt) {
+      to_ = parse_format(argument);
+      if (AUTO_FORMAT == to_)
+        throw std::runtime_error("The OUTPUT format cannot be 'auto'.");
+    };
+  };
+
+  int run()
+  {
+    open_input();
+    switch (to_) {
+    case SMS_FORMAT:
+      SMSWriter<val_t>::open(*FilterProgram::output_, nrows_, ncols_);
+      break;
+    case MM_FORMAT:
+      open_mm();
+      break;
+    default:
+      // Rutherford-Boeing files are written out when all entries are known
+      rows_.reserve(count_);
+      columns_.reserve(count_);
+      values_.reserve(count_);
+      break;
+    };
+
+    read_input();
+
+    switch (to_) {
+    case SMS_FORMAT:
+      SMSWriter<val_t>::close();
+      break;
+    case MM_FORMAT:
+      close_mm();
+      break;
+    default:
+      write_rb();
+      break;
+    };
+    SMSReader<val_t>::close();
+    return 0;
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    emit(i, j, value);
+    // symmetric storage only holds the lower triangle
+    if ('S' == symmetry_ and i != j)
+      emit(j, i, value);
+    else if ('Z' == symmetry_ and i != j)
+      emit(j, i, (pattern_ ? value : negated(value)));
+    ++count_;
+  };
+
+
+private:
+  matrix_format from_;
+  matrix_format to_;
+
+  /// symmetry of the input matrix: 'G'eneral, 'S'ymmetric, or skew-symmetric ('Z')
+  char symmetry_;
+  /// whether the input matrix has no values (all entries are 1)
+  bool pattern_;
+  /// number of entries read, as stored in INPUT, and written
+  long long count_;
+  long long written_;
+  /// whether all values written so far are integers
+  bool integer_;
+
+  /// position of the Matrix Market header in the output, if it can be
+  /// rewritten when all entries are known; -1 otherwise
+  std::streamoff header_pos_;
+
+  /// title and key of Rutherford-Boeing files
+  std::string title_;
+  std::string key_;
+
+  /// current line of the Rutherford-Boeing data, and position and
+  /// number of the next field in it
+  std::string line_;
+  std::size_t pos_;
+  std::size_t fields_;
+
+  /// entries to write, for Rutherford-Boeing output
+  std::vector<coord_t> rows_;
+  std::vector<coord_t> columns_;
+  std::vector<val_t> values_;
+
+
+  /// Send one entry to the output matrix.
+  void emit(const coord_t i, const coord_t j, const val_t& value)
+  {
+    switch (to_) {
+    case SMS_FORMAT:
+      SMSWriter<val_t>::write_entry(i, j, value);
+      return;
+    case MM_FORMAT:
+      write_mm_entry(i, j, value);
+      return;
+    default:
+      rows_.push_back(i);
+      columns_.push_back(j);
+      values_.push_back(value);
+      return;
+    };
+  };
+
+
+  // ---- input ----
+
+  /// Read the header of the INPUT matrix, and set `from_` if needed.
+  void open_input()
+  {
+    std::istream& input = *FilterProgram::input_;
+    // entries from a pipeline queue are always an SMS matrix
+    if (NULL != dynamic_cast<QueueInputStream*>(&input)) {
+      if (AUTO_FORMAT != from_ and SMS_FORMAT != from_)
+        throw std::runtime_error("Only SMS matrices can be read from a pipeline.");
+      from_ = SMS_FORMAT;
+      SMSReader<val_t>::open(input);
+      return;
+    };
+
+    SMSReader<val_t>::stats_ = RunStats::current();
+    PhaseTimer timer(SMSReader<val_t>::stats_, RunStats::OPEN);
+    SMSReader<val_t>::input_ = input;
+    SMSReader<val_t>::queue_ = NULL;
+    start_ = -1;
+    if (NULL != SMSReader<val_t>::stats_)
+      start_ = input.tellg();
+
+    // the first line tells the formats apart
+    std::string first;
+    if (not std::getline(input >> std::ws, first))
+      throw std::runtime_error("Empty input matrix.");
+    if (AUTO_FORMAT == from_) {
+      if (0 == first.compare(0, 14, "%%MatrixMarket"))
+        from_ = MM_FORMAT;
+      else {
+        std::istringstream header(first);
+        coord_t nrows, ncols;
+        std::string M;
+        header >> nrows >> ncols >> M;
+        from_ = ((header and "M" == M) ? SMS_FORMAT : RB_FORMAT);
+      };
+    };
+
+    switch (from_) {
+    case SMS_FORMAT:
+      {
+        std::istringstream header(first);
+        char M = 0;
+        header >> nrows_ >> ncols_ >> M;
+        if ('M' != M)
+          throw std::runtime_error("Malformed SMS header");
+        count_ = 0;
+      };
+      break;
+    case MM_FORMAT:
+      open_mm_input(first);
+      break;
+    default:
+      open_rb_input(first);
+      break;
+    };
+  };
+
+
+  /// Read entries from the INPUT matrix.
+  void read_input()
+  {
+    const long long declared = count_;
+    count_ = 0;
+    if (SMS_FORMAT == from_)
+      SMSReader<val_t>::read();
+    else {
+      PhaseTimer timer(SMSReader<val_t>::stats_, RunStats::READ);
+      if (MM_FORMAT == from_)
+        read_mm();
+      else
+        read_rb(declared);
+      account_input();
+    };
+    if (SMS_FORMAT != from_ and count_ != declared) {
+      std::ostringstream msg;
+      msg << "Input matrix should have " << declared
+          << " entries, but it has " << count_ << ".";
+      throw std::runtime_error(msg.str());
+    };
+  };
+
+
+  /// Add the entries and bytes read to the `--stats` counters.
+  void account_input()
+  {
+    RunStats* stats = SMSReader<val_t>::stats_;
+    if (NULL == stats)
+      return;
+    stats->entries_in += count_;
+    std::istream& input = *SMSReader<val_t>::input_;
+    input.clear();
+    const std::streamoff end = input.tellg();
+    if (start_ >= 0 and end >= start_ and stats->bytes_in >= 0)
+      stats->bytes_in += end - start_;
+    else
+      stats->bytes_in = -1;
+  };
+
+
+  /// Parse the Matrix Market banner line `banner`, and the header
+  /// lines that follow it.
+  void open_mm_input(const std::string& banner)
+  {
+    std::string lbanner(banner);
+    std::transform(lbanner.begin(), lbanner.end(), lbanner.begin(), ::tolower);
+    std::istringstream words(lbanner);
+    std::string magic, object, layout, field, symmetry;
+    words >> magic >> object >> layout >> field >> symmetry;
+    if ("matrix" != object or "coordinate" != layout) {
+      std::ostringstream msg;
+      msg << "Unsupported Matrix Market file '" << banner << "':"
+          << " only sparse matrices in 'coordinate' format can be read.";
+      throw std::runtime_error(msg.str());
+    };
+    if ("pattern" == field)
+      pattern_ = true;
+    else if ("real" != field and "integer" != field and "double" != field) {
+      std::ostringstream msg;
+      msg << "Unsupported Matrix Market value type '" << field << "'.";
+      throw std::runtime_error(msg.str());
+    };
+    if ("general" == symmetry)
+      symmetry_ = 'G';
+    else if ("symmetric" == symmetry)
+      symmetry_ = 'S';
+    else if ("skew-symmetric" == symmetry)
+      symmetry_ = 'Z';
+    else {
+      std::ostringstream msg;
+      msg << "Unsupported Matrix Market symmetry '" << symmetry << "'.";
+      throw std::runtime_error(msg.str());
+    };
+
+    // skip comments, up to the size line
+    std::istream& input = *SMSReader<val_t>::input_;
+    std::string line;
+    while (std::getline(input, line))
+      if (not line.empty() and '%' != line[0]
+          and std::string::npos != line.find_first_not_of(" \t\r"))
+        break;
+    std::istringstream size(line);
+    if (not (size >> nrows_ >> ncols_ >> count_))
+      throw std::runtime_error("Malformed Matrix Market header: missing matrix size.");
+  };
+
+
+  /// Read the "i j value" lines of a Matrix Market matrix, or just
+  /// "i j" for pattern matrices.
+  void read_mm()
+  {
+    std::istream& input = *SMSReader<val_t>::input_;
+    val_t value("1");
+    coord_t i, j;
+    while (input >> i >> j) {
+      if (not pattern_ and not (input >> value))
+        break;
+      SMSReader<val_t>::check_bounds(i, j);
+      process_entry(i, j, value);
+    };
+    if (not (input >> std::ws).eof())
+      throw std::runtime_error("Malformed Matrix Market entry.");
+  };
+
+
+  /// Parse the Rutherford-Boeing header, whose first line is `title`.
+  void open_rb_input(const std::string& title)
+  {
+    std::istream& input = *SMSReader<val_t>::input_;
+    title_ = title.substr(0, 72);
+    if (title.size() > 72)
+      key_ = title.substr(72, 8);
+
+    std::string line;
+    long long totcrd = 0, ptrcrd = 0, indcrd = 0, valcrd = 0, rhscrd = 0;
+    std::getline(input, line);
+    std::istringstream cards(line);
+    if (not (cards >> totcrd >> ptrcrd >> indcrd >> valcrd))
+      throw std::runtime_error("Malformed Rutherford-Boeing header: bad line counts.");
+    cards >> rhscrd;
+
+    std::getline(input, line);
+    std::string type = line.substr(0, 3);
+    std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+    std::istringstream sizes(line.size() > 3 ? line.substr(3) : "");
+    if (not (sizes >> nrows_ >> ncols_ >> count_))
+      throw std::runtime_error("Malformed Rutherford-Boeing header: missing matrix size.");
+    if (3 != type.size()
+        or std::string::npos == std::string("RIP").find(type[0])
+        or std::string::npos == std::string("URSZ").find(type[1])
+        or 'A' != type[2]) {
+      std::ostringstream msg;
+      msg << "Unsupported Rutherford-Boeing matrix type '" << type << "':"
+          << " only real, integer or pattern assembled matrices can be read.";
+      throw std::runtime_error(msg.str());
+    };
+    pattern_ = ('P' == type[0]);
+    // 'U'nsymmetric and 'R'ectangular matrices are stored in full
+    symmetry_ = (('S' == type[1] or 'Z' == type[1]) ? type[1] : 'G');
+
+    std::getline(input, line);
+    std::istringstream formats(line);
+    std::string ptrfmt, indfmt, valfmt;
+    formats >> ptrfmt >> indfmt >> valfmt;
+    ptr_format_ = FortranFormat(ptrfmt);
+    ind_format_ = FortranFormat(indfmt);
+    if (not pattern_ and valcrd > 0)
+      val_format_ = FortranFormat(valfmt);
+    else
+      pattern_ = true;
+    // right-hand sides are not part of the matrix
+    if (rhscrd > 0)
+      std::getline(input, line);
+  };
+
+  FortranFormat ptr_format_;
+  FortranFormat ind_format_;
+  FortranFormat val_format_;
+
+  /// Start reading fixed-width fields on a new line.
+  void start_section()
+  {
+    line_.clear();
+    pos_ = 0;
+    fields_ = 0;
+  };
+
+  /// Store in `field` the next non-blank fixed-width field of the
+  /// Rutherford-Boeing data, with whitespace trimmed.
+  void next_field(const FortranFormat& format, std::string& field)
+  {
+    std::istream& input = *SMSReader<val_t>::input_;
+    while (true) {
+      if (pos_ >= line_.size() or fields_ >= format.count) {
+        if (not std::getline(input, line_))
+          throw std::runtime_error("Rutherford-Boeing data ended prematurely.");
+        pos_ = 0;
+        fields_ = 0;
+        continue;
+      };
+      const std::size_t first = line_.find_first_not_of(" \r", pos_);
+      const std::size_t end = std::min(pos_ + format.width, line_.size());
+      pos_ += format.width;
+      ++fields_;
+      if (first >= end)
+        continue;
+      std::size_t last = line_.find_last_not_of(" \r", end - 1);
+      field.assign(line_, first, last - first + 1);
+      return;
+    };
+  };
+
+  /// Return next field of the Rutherford-Boeing data as an integer.
+  long long next_integer(const FortranFormat& format)
+  {
+    std::string field;
+    next_field(format, field);
+    char* end;
+    const long long n = std::strtoll(field.c_str(), &end, 10);
+    if ('\0' != *end) {
+      std::ostringstream msg;
+      msg << "Malformed Rutherford-Boeing data: expected an integer, got '" << field << "'.";
+      throw std::runtime_error(msg.str());
+    };
+    return n;
+  };
+
+  /// Read the column pointers, row indices, and values of a
+  /// Rutherford-Boeing matrix with `nnz` entries, streaming entries
+  /// to the output.
+  void read_rb(const long long nnz)
+  {
+    std::vector<long long> colptr(ncols_ + 1);
+    start_section();
+    for (coord_t j = 0; j <= ncols_; ++j)
+      colptr[j] = next_integer(ptr_format_);
+    if (1 != colptr[0] or nnz+1 != colptr[ncols_])
+      throw std::runtime_error("Malformed Rutherford-Boeing data: bad column pointers.");
+    std::vector<coord_t> rowind(nnz);
+    start_section();
+    for (long long k = 0; k < nnz; ++k)
+      rowind[k] = next_integer(ind_format_);
+
+    start_section();
+    val_t value("1");
+    coord_t j = 1;
+    for (long long k = 0; k < nnz; ++k) {
+      while (colptr[j] <= k+1)
+        ++j;
+      if (not pattern_) {
+        next_field(val_format_, value);
+        fortran_to_c(value);
+      };
+      SMSReader<val_t>::check_bounds(rowind[k], j);
+      process_entry(rowind[k], j, value);
+    };
+  };
+
+  /// Rewrite a Fortran real number so that C can read it: use 'E'
+  /// instead of 'D', and restore the 'E' that is left out of
+  /// three-digit exponents, as in "1.0-100".
+  static void fortran_to_c(std::string& value)
+  {
+    for (std::size_t k = 0; k < value.size(); ++k) {
+      if ('D' == value[k] or 'd' == value[k])
+        value[k] = 'E';
+      else if (k > 0 and ('+' == value[k] or '-' == value[k])
+               and 'E' != value[k-1] and 'e' != value[k-1]) {
+        value.insert(k, 1, 'E');
+        ++k;
+      };
+    };
+  };
+
+
+  // ---- Matrix Market output ----
+
+  /// Return the Matrix Market header for a matrix with `nnz` entries
+  /// of value type `field`; with `padded`, the header has the same
+  /// length for all value types and up to 20-digit `nnz`.  Padding
+  /// goes into a comment line between the banner and the size line,
+  /// since strict readers reject extra blanks in the banner.
+  std::string mm_header(const std::string& field, const long long nnz,
+                        const bool padded) const
+  {
+    std::ostringstream size;
+    size << nrows_ << ' ' << ncols_ << ' ' << nnz << '\n';
+    std::string result = "%%MatrixMarket matrix coordinate " + field + " general\n";
+    if (padded) {
+      std::ostringstream count;
+      count << nnz;
+      result += '%';
+      result += std::string((7 - field.size()) + (20 - count.str().size()), ' ');
+      result += '\n';
+    };
+    return result + size.str();
+  };
+
+  /// Begin writing a Matrix Market matrix.  The header gives the
+  /// number of entries, which is only known at the end: if OUTPUT is
+  /// seekable, a placeholder header is written now and filled in by
+  /// `close_mm`, so entries can be written as they are read;
+  /// otherwise, entries are held in memory until the end.
+  void open_mm()
+  {
+    RunStats* stats = RunStats::current();
+    SMSWriter<val_t>::stats_ = stats;
+    PhaseTimer timer(stats, RunStats::OPEN);
+    std::ostream& output = *FilterProgram::output_;
+    SMSWriter<val_t>::output_ = output;
+    format_ = value_format(output);
+    SMSWriter<val_t>::queue_ = NULL;
+    buffer_.clear();
+    buffer_.reserve(1 << 20);
+    header_pos_ = -1;
+    // writes to a file opened for appending cannot go back
+    if (NULL == dynamic_cast<QueueOutputStream*>(&output)
+        and not (&output == &std::cout and (fcntl(1, F_GETFL) & O_APPEND)))
+      header_pos_ = output.tellp();
+    if (header_pos_ >= 0) {
+      // the placeholder is overwritten with a header of the same size
+      write_mm_header(mm_header("integer", 0, true));
+      if (output.bad())
+        throw std::runtime_error("Error writing to stream");
+    };
+  };
+
+  /// Write `header` to OUTPUT, and account for it in `--stats`.
+  void write_mm_header(const std::string& header)
+  {
+    SMSWriter<val_t>::output_->write(header.data(), header.size());
+    if (NULL != SMSWriter<val_t>::stats_)
+      SMSWriter<val_t>::stats_->bytes_out += header.size();
+  };
+
+  /// Append an entry to the output buffer; time is accounted to the
+  /// WRITE phase only when the buffer is flushed.
+  void write_mm_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    ++written_;
+    if (pattern_) {
+      append_integer(buffer_, i);
+      buffer_ += ' ';
+      append_integer(buffer_, j);
+      buffer_ += '\n';
+    }
+    else {
+      if (integer_ and not is_integer(value))
+        integer_ = false;
+      format_entry(buffer_, i, j, value);
+    };
+    if (header_pos_ >= 0 and buffer_.size() >= (1 << 20))
+      flush_buffer();
+  };
+
+  void close_mm()
+  {
+    RunStats* stats = SMSWriter<val_t>::stats_;
+    PhaseTimer timer(stats, RunStats::CLOSE);
+    if (NULL != stats)
+      stats->entries_out += written_;
+    std::ostream& output = *SMSWriter<val_t>::output_;
+    const std::string field = (pattern_ ? "pattern" : (integer_ ? "integer" : "real"));
+    if (header_pos_ >= 0) {
+      flush_buffer();
+      output.seekp(header_pos_);
+      output << mm_header(field, written_, true);
+      output.seekp(0, std::ios_base::end);
+    }
+    else {
+      write_mm_header(mm_header(field, written_, false));
+      flush_buffer();
+    };
+    output.flush();
+    if (output.bad())
+      throw std::runtime_error("Error writing to stream");
+    SMSWriter<val_t>::output_.release();
+  };
+
+
+  // ---- Rutherford-Boeing output ----
+
+  /// Append `text` to the output, right-aligned in the `k`-th field
+  /// of `n`, that go `format.count` to a line.
+  void write_field(const std::string& text, const FortranFormat& format,
+                   const std::size_t k, const std::size_t n)
+  {
+    if (text.size() < format.width)
+      buffer_.append(format.width - text.size(), ' ');
+    buffer_ += text;
+    if ((k+1) % format.count == 0 or k+1 == n) {
+      buffer_ += '\n';
+      if (buffer_.size() >= (1 << 20))
+        flush_buffer();
+    };
+  };
+
+  /// Number of lines taken by `n` fields in format `format`.
+  static long long lines(const std::size_t n, const FortranFormat& format)
+  {
+    return (n + format.count - 1) / format.count;
+  };
+
+  /// Sort the entries by column, and write them as a Rutherford-Boeing
+  /// matrix in compressed column format.
+  void write_rb()
+  {
+    RunStats* stats = RunStats::current();
+    SMSWriter<val_t>::stats_ = stats;
+    std::ostream& output = *FilterProgram::output_;
+    SMSWriter<val_t>::output_ = output;
+    SMSWriter<val_t>::queue_ = NULL;
+    format_ = value_format(output);
+    buffer_.clear();
+
+    const std::size_t nnz = values_.size();
+    CSRMatrix<val_t, coord_t> csc;
+    {
+      TraceSpan span("sort by column");
+      csc.assign(ncols_, nrows_, columns_, rows_, values_);
+      csc.sort_rows();
+    };
+
+    PhaseTimer timer(stats, RunStats::WRITE);
+    if (NULL != stats)
+      stats->entries_out += nnz;
+
+    // one blank column between numbers; values are copied verbatim,
+    // so they are read back with no implied decimal digits ("Ew.0")
+    FortranFormat ptrfmt, indfmt, valfmt;
+    ptrfmt.width = digits(nnz + 1) + 1;
+    ptrfmt.count = 80 / ptrfmt.width;
+    indfmt.width = digits(nrows_) + 1;
+    indfmt.count = 80 / indfmt.width;
+    std::size_t width = 1;
+    if (not pattern_)
+      for (std::size_t k = 0; k < nnz; ++k)
+        width = std::max(width, csc.value(k).size());
+    valfmt.width = width + 1;
+    valfmt.count = std::max<std::size_t>(1, 80 / valfmt.width);
+
+    // header
+    const long long ptrcrd = lines(ncols_ + 1, ptrfmt);
+    const long long indcrd = lines(nnz, indfmt);
+    const long long valcrd = (pattern_ ? 0 : lines(nnz, valfmt));
+    std::string title = (title_.empty() ? "Converted by sms-convert" : title_);
+    title.resize(72, ' ');
+    buffer_ += title + (key_.empty() ? "sms" : key_);
+    buffer_.erase(buffer_.find_last_not_of(' ') + 1);
+    buffer_ += '\n';
+    char line[128];
+    std::snprintf(line, sizeof(line), "%14lld%14lld%14lld%14lld%14d\n",
+                  ptrcrd + indcrd + valcrd, ptrcrd, indcrd, valcrd, 0);
+    buffer_ += line;
+    std::snprintf(line, sizeof(line), "%c%cA%11s%14ld%14ld%14zu%14d\n",
+                  (pattern_ ? 'P' : 'R'), (nrows_ == ncols_ ? 'U' : 'R'),
+                  "", nrows_, ncols_, nnz, 0);
+    buffer_ += line;
+    char fmt[3][24];
+    std::snprintf(fmt[0], sizeof(fmt[0]), "(%zuI%zu)", ptrfmt.count, ptrfmt.width);
+    std::snprintf(fmt[1], sizeof(fmt[1]), "(%zuI%zu)", indfmt.count, indfmt.width);
+    std::snprintf(fmt[2], sizeof(fmt[2]), "(%zuE%zu.0)", valfmt.count, valfmt.width);
+    std::snprintf(line, sizeof(line), "%-16s%-16s%s\n",
+                  fmt[0], fmt[1], (pattern_ ? "" : fmt[2]));
+    buffer_ += line;
+
+    // column pointers, row indices, and values
+    std::string text;
+    for (coord_t j = 0; j <= ncols_; ++j) {
+      text.clear();
+      append_integer(text, (j < ncols_ ? csc.row_begin(j+1) : nnz) + 1);
+      write_field(text, ptrfmt, j, ncols_ + 1);
+    };
+    for (std::size_t k = 0; k < nnz; ++k) {
+      text.clear();
+      append_integer(text, csc.column(k));
+      write_field(text, indfmt, k, nnz);
+    };
+    if (not pattern_)
+      for (std::size_t k = 0; k < nnz; ++k)
+        write_field(csc.value(k), valfmt, k, nnz);
+    flush_buffer();
+    output.flush();
+    SMSWriter<val_t>::output_.release();
+  };
+};
+
+
+SMASTO_MAIN("convert", ConvertProgram)
@@ -0,0 +1,501 @@
+/**
+ * @file   sms-fill.cpp
+ *
+ * Predict the fill-in of sparse LU factorization by symbolic
+ * analysis: elimination tree and column counts.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// only the nonzero pattern matters
+typedef std::string val_t;
+
+
+class FillProgram : public FilterProgram,
+                    public SMSReader<val_t>
+{
+public:
+  FillProgram()
+    : row_perm_file_(), col_perm_file_(), symmetric_(false), short_(false),
+      etree_file_(), counts_file_(), new_row_(), new_col_(),
+      entry_rows_(), entry_cols_(), nrows_(0), ncols_(0),
+      colptr_(), rowind_(), rowptr_(), colind_(),
+      parent_(), post_(), counts_()
+  {
+    this->add_option('C', "counts", required_argument,
+                     "Write the number of nonzero entries in each column of L to file ARG.");
+    this->add_option('e', "etree", required_argument,
+                     "Write the elimination tree to file ARG, as the parent of each column (0 for roots).");
+    this->add_option('m', "model", required_argument,
+                     "Predict fill-in for LU with partial pivoting ('ata', the default)"
+                     " or for LU with diagonal pivots ('symmetric').");
+    this->add_option('s', "short", no_argument, "One-line output format");
+    this->add_option('c', "columns", required_argument,
+                     "Permute columns according to the permutation read from file ARG.");
+    this->add_option('r', "rows", required_argument,
+                     "Permute rows according to the permutation read from file ARG.");
+    this->description =
+      "Predict the number of nonzero entries in the LU factors of the\n"
+      "INPUT matrix, after permuting it with the permutations given by\n"
+      "options `--rows` and `--columns`, by a symbolic analysis that\n"
+      "takes time nearly linear in the number of nonzero entries; no\n"
+      "numeric factorization is done.  Permutation files are in the\n"
+      "format written by the `--row-permutation` and `--column-permutation`\n"
+      "options of `sms-reordrows`, `sms-reordcols` and `sms-blockechelon`.\n"
+      "\n"
+      "With the default 'ata' model, the column elimination tree and the\n"
+      "column counts of the Cholesky factor R' of A'A are computed: for\n"
+      "any choice of row pivots, the structure of U is contained in that\n"
+      "of R, and that of L in R' (row permutations do not change the\n"
+      "result).  With the 'symmetric' model, they are computed for the\n"
+      "structure of A+A' (the matrix must be square), which is the exact\n"
+      "fill-in of LU factorization with pivots taken on the diagonal,\n"
+      "if A is structurally symmetric, and an upper bound otherwise.\n"
+      "\n"
+      "The INPUT matrix stream should be in J.-G. Dumas' SMS format;\n"
+      "statistics on the predicted factors are written to OUTPUT.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('C' == opt)
+      counts_file_ = argument;
+    else if ('e' == opt)
+      etree_file_ = argument;
+    else if ('m' == opt) {
+      const std::string model(argument);
+      if ("ata" == model)
+        symmetric_ = false;
+      else if ("symmetric" == model)
+        symmetric_ = true;
+      else
+        throw std::runtime_error("Argument to '--model' must be one of 'ata' or 'symmetric'.");
+    }
+    else if ('s' == opt)
+      short_ = true;
+    else if ('c' == opt)
+      col_perm_file_ = argument;
+    else if ('r' == opt)
+      row_perm_file_ = argument;
+  };
+
+  int run()
+  {
+    SMSReader<val_t>::open(*FilterProgram::input_);
+    nrows_ = SMSReader<val_t>::rows();
+    ncols_ = SMSReader<val_t>::columns();
+    if (symmetric_ and nrows_ != ncols_)
+      throw std::runtime_error("The 'symmetric' model needs a square matrix.");
+    load_permutation(row_perm_file_, nrows_, "row", new_row_);
+    load_permutation(col_perm_file_, ncols_, "column", new_col_);
+    read();
+    SMSReader<val_t>::close();
+
+    TraceSpan span("symbolic factorization");
+    const long long nnz = compress();
+    if (symmetric_)
+      symmetrize();
+    etree();
+    postorder();
+    column_counts();
+
+    // the diagonal of R (or L) is shared by both factors
+    long long lnz = 0;
+    for (coord_t j = 0; j < ncols_; ++j)
+      lnz += counts_[j];
+    const long long lunz = 2*lnz - ncols_;
+
+    // parents have higher index than their children, so depths can
+    // be computed from the last column backwards
+    std::vector<coord_t> depth(ncols_, 1);
+    coord_t height = 0, roots = 0;
+    for (coord_t j = ncols_ - 1; j >= 0; --j) {
+      if (-1 == parent_[j])
+        ++roots;
+      else
+        depth[j] = depth[parent_[j]] + 1;
+      height = std::max(height, depth[j]);
+    };
+
+    if (short_) {
+      (*output_) << "rows:" << nrows_
+                 << " columns:" << ncols_
+                 << " nonzero:" << nnz
+                 << " L:" << lnz
+                 << " U:" << lnz
+                 << " LU:" << lunz
+                 << " fill:" << (lunz - nnz)
+                 << " height:" << height << std::endl;
+    }
+    else {
+      (*output_) << "Rows: " << nrows_ << std::endl;
+      (*output_) << "Columns: " << ncols_ << std::endl;
+      (*output_) << "Non-zeros: " << nnz << std::endl;
+      (*output_) << "Model: " << (symmetric_? "symmetric" : "ata") << std::endl;
+      (*output_) << "Non-zeros in L: " << lnz << std::endl;
+      (*output_) << "Non-zeros in U: " << lnz << std::endl;
+      (*output_) << "Non-zeros in L+U: " << lunz << std::endl;
+      (*output_) << "Fill-in: " << (lunz - nnz) << std::endl;
+      (*output_) << "Elimination tree height: " << height << std::endl;
+      (*output_) << "Elimination tree roots: " << roots << std::endl;
+    };
+
+    if (not etree_file_.empty()) {
+      std::vector<coord_t> parents(ncols_);
+      for (coord_t j = 0; j < ncols_; ++j)
+        parents[j] = parent_[j] + 1;
+      write_vector(etree_file_, parents);
+    };
+    if (not counts_file_.empty())
+      write_vector(counts_file_, counts_);
+
+    return 0;
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    entry_rows_.push_back(new_row_.empty()? i-1 : new_row_[i]-1);
+    entry_cols_.push_back(new_col_.empty()? j-1 : new_col_[j]-1);
+  };
+
+
+private:
+  std::string row_perm_file_;
+  std::string col_perm_file_;
+  bool symmetric_;
+  bool short_;
+  std::string etree_file_;
+  std::string counts_file_;
+
+  /// map old row (resp. column) index to new one; empty for the identity
+  std::vector<coord_t> new_row_;
+  std::vector<coord_t> new_col_;
+
+  /// indices of the permuted entries, 0-based, in input order
+  std::vector<coord_t> entry_rows_;
+  std::vector<coord_t> entry_cols_;
+
+  coord_t nrows_;
+  coord_t ncols_;
+
+  /// nonzero pattern by columns: row indices of column `j` are
+  /// `rowind_[colptr_[j]]` to `rowind_[colptr_[j+1]-1]`, sorted
+  std::vector<std::size_t> colptr_;
+  std::vector<coord_t> rowind_;
+  /// nonzero pattern by rows, likewise
+  std::vector<std::size_t> rowptr_;
+  std::vector<coord_t> colind_;
+
+  /// parent of each column in the elimination tree, or -1 for roots
+  std::vector<coord_t> parent_;
+  /// columns in postorder of the elimination tree
+  std::vector<coord_t> post_;
+  /// number of nonzero entries in each column of the factor
+  std::vector<coord_t> counts_;
+
+
+  /// Read a permutation and store its inverse in `inverse`; do
+  /// nothing if `filename` is empty.
+  void load_permutation(const std::string& filename, const coord_t n, const char* what,
+                        std::vector<coord_t>& inverse)
+  {
+    if (filename.empty())
+      return;
+    std::vector<coord_t> perm;
+    read_permutation(filename, perm);
+    if (static_cast<coord_t>(perm.size()) != n) {
+      std::ostringstream msg;
+      msg << "The " << what << " permutation has length " << perm.size()
+          << " but the matrix has " << n << " " << what << "s.";
+      throw std::runtime_error(msg.str());
+    };
+    invert_permutation(perm, inverse);
+  };
+
+  /// Store `n` lists with the given `index` and `item` values in
+  /// compressed form, by a counting sort on `index`.
+  static void scatter(const coord_t n,
+                      const std::vector<coord_t>& index, const std::vector<coord_t>& item,
+                      std::vector<std::size_t>& ptr, std::vector<coord_t>& items)
+  {
+    ptr.assign(n + 1, 0);
+    for (std::size_t k = 0; k < index.size(); ++k)
+      ++ptr[index[k] + 1];
+    for (coord_t j = 0; j < n; ++j)
+      ptr[j+1] += ptr[j];
+    std::vector<std::size_t> pos(ptr.begin(), ptr.end() - 1);
+    items.resize(index.size());
+    for (std::size_t k = 0; k < index.size(); ++k)
+      items[pos[index[k]]++] = item[k];
+  };
+
+  /// Build the compressed column and row patterns from the entries
+  /// read, dropping duplicates; return the number of distinct entries.
+  long long compress()
+  {
+    scatter(ncols_, entry_cols_, entry_rows_, colptr_, rowind_);
+    std::vector<coord_t>().swap(entry_rows_);
+    std::vector<coord_t>().swap(entry_cols_);
+
+    std::size_t n = 0;
+    for (coord_t j = 0; j < ncols_; ++j) {
+      const std::size_t begin = colptr_[j];
+      std::sort(rowind_.begin() + begin, rowind_.begin() + colptr_[j+1]);
+      colptr_[j] = n;
+      for (std::size_t p = begin; p < colptr_[j+1]; ++p)
+        if (p == begin or rowind_[p] != rowind_[p-1])
+          rowind_[n++] = rowind_[p];
+    };
+    colptr_[ncols_] = n;
+    rowind_.resize(n);
+
+    transpose(ncols_, nrows_, colptr_, rowind_, rowptr_, colind_);
+    return n;
+  };
+
+  /// Store in `tptr`, `tind` the transpose of the `n`-column pattern
+  /// `ptr`, `ind` with `m` rows; the result has sorted indices, too.
+  static void transpose(const coord_t n, const coord_t m,
+                        const std::vector<std::size_t>& ptr, const std::vector<coord_t>& ind,
+                        std::vector<std::size_t>& tptr, std::vector<coord_t>& tind)
+  {
+    std::vector<coord_t> cols(ind.size());
+    for (coord_t j = 0; j < n; ++j)
+      std::fill(cols.begin() + ptr[j], cols.begin() + ptr[j+1], j);
+    scatter(m, ind, cols, tptr, tind);
+  };
+
+  /// Replace the pattern of A with that of A+A'.
+  void symmetrize()
+  {
+    std::vector<std::size_t> ptr(ncols_ + 1, 0);
+    std::vector<coord_t> ind;
+    ind.reserve(2 * rowind_.size());
+    for (coord_t j = 0; j < ncols_; ++j) {
+      std::set_union(rowind_.begin() + colptr_[j], rowind_.begin() + colptr_[j+1],
+                     colind_.begin() + rowptr_[j], colind_.begin() + rowptr_[j+1],
+                     std::back_inserter(ind));
+      ptr[j+1] = ind.size();
+    };
+    colptr_.swap(ptr);
+    rowind_.swap(ind);
+    // the pattern is symmetric now, so rows are the same as columns
+    rowptr_ = colptr_;
+    colind_ = rowind_;
+  };
+
+  /// Compute the elimination tree by Liu's algorithm: for each entry
+  /// above the diagonal, climb from its row to the root of its current
+  /// subtree, compressing the path on the way.  In the 'ata' model,
+  /// the entries of A'A are not formed: each column is linked instead
+  /// to the previous column having an entry in the same row of A.
+  void etree()
+  {
+    parent_.assign(ncols_, -1);
+    std::vector<coord_t> ancestor(ncols_, -1);
+    std::vector<coord_t> prev(symmetric_? 0 : nrows_, -1);
+    for (coord_t k = 0; k < ncols_; ++k) {
+      for (std::size_t p = colptr_[k]; p < colptr_[k+1]; ++p) {
+        coord_t i = (symmetric_? rowind_[p] : prev[rowind_[p]]);
+        while (-1 != i and i < k) {
+          const coord_t next = ancestor[i];
+          ancestor[i] = k;
+          if (-1 == next)
+            parent_[i] = k;
+          i = next;
+        };
+        if (not symmetric_)
+          prev[rowind_[p]] = k;
+      };
+    };
+  };
+
+  /// Order the columns by a depth-first postorder of the elimination tree.
+  void postorder()
+  {
+    // children of each column, in increasing order
+    std::vector<coord_t> head(ncols_, -1);
+    std::vector<coord_t> next(ncols_, -1);
+    for (coord_t j = ncols_ - 1; j >= 0; --j)
+      if (-1 != parent_[j]) {
+        next[j] = head[parent_[j]];
+        head[parent_[j]] = j;
+      };
+    post_.clear();
+    post_.reserve(ncols_);
+    std::vector<coord_t> stack;
+    for (coord_t root = 0; root < ncols_; ++root) {
+      if (-1 != parent_[root])
+        continue;
+      stack.push_back(root);
+      while (not stack.empty()) {
+        const coord_t p = stack.back();
+        const coord_t child = head[p];
+        if (-1 == child) {
+          stack.pop_back();
+          post_.push_back(p);
+        }
+        else {
+          head[p] = next[child];
+          stack.push_back(child);
+        };
+      };
+    };
+  };
+
+  /// Compute the column counts of the factor with the algorithm of
+  /// Gilbert, Ng and Peyton: column `j` has one entry for each row
+  /// subtree it belongs to, and these are counted by finding, with a
+  /// union-find structure, the least common ancestors of consecutive
+  /// leaves of each row subtree.  In the 'ata' model, each row of A
+  /// contributes a clique to A'A, which is accounted for at its first
+  /// column in postorder.
+  void column_counts()
+  {
+    std::vector<coord_t> first(ncols_, -1);
+    std::vector<coord_t> max_first(ncols_, -1);
+    std::vector<coord_t> prev_leaf(ncols_, -1);
+    std::vector<coord_t> ancestor(ncols_);
+    std::vector<coord_t>& delta = counts_;
+    delta.assign(ncols_, 0);
+
+    // `first[j]` is the position in postorder of the first descendant
+    // of `j`; leaves of the tree get a count of one
+    for (coord_t k = 0; k < ncols_; ++k) {
+      coord_t j = post_[k];
+      delta[j] = (-1 == first[j]? 1 : 0);
+      for (; -1 != j and -1 == first[j]; j = parent_[j])
+        first[j] = k;
+    };
+
+    // in the 'ata' model, list the rows of A by the postorder
+    // position of their first column
+    std::vector<coord_t> head, next;
+    if (not symmetric_) {
+      std::vector<coord_t> position(ncols_);
+      for (coord_t k = 0; k < ncols_; ++k)
+        position[post_[k]] = k;
+      head.assign(ncols_ + 1, -1);
+      next.assign(nrows_, -1);
+      for (coord_t i = nrows_ - 1; i >= 0; --i) {
+        if (rowptr_[i] == rowptr_[i+1])
+          continue;
+        coord_t k = ncols_;
+        for (std::size_t p = rowptr_[i]; p < rowptr_[i+1]; ++p)
+          k = std::min(k, position[colind_[p]]);
+        next[i] = head[k];
+        head[k] = i;
+      };
+    };
+
+    for (coord_t i = 0; i < ncols_; ++i)
+      ancestor[i] = i;
+    for (coord_t k = 0; k < ncols_; ++k) {
+      const coord_t j = post_[k];
+      if (-1 != parent_[j])
+        --delta[parent_[j]];
+      for (coord_t r = (symmetric_? j : head[k]); -1 != r; r = (symmetric_? -1 : next[r])) {
+        for (std::size_t p = rowptr_[r]; p < rowptr_[r+1]; ++p) {
+          const coord_t i = colind_[p];
+          // is `j` a leaf of the row subtree of `i`?
+          if (i <= j or first[j] <= max_first[i])
+            continue;
+          max_first[i] = first[j];
+          const coord_t prev = prev_leaf[i];
+          prev_leaf[i] = j;
+          ++delta[j];
+          if (-1 == prev)
+            continue;
+          // not the first leaf: subtract one at the least common
+          // ancestor of this leaf and the previous one
+          coord_t q = prev;
+          while (q != ancestor[q])
+            q = ancestor[q];
+          for (coord_t s = prev; s != q; ) {
+            const coord_t up = ancestor[s];
+            ancestor[s] = q;
+            s = up;
+          };
+          --delta[q];
+        };
+      };
+      if (-1 != parent_[j])
+        ancestor[j] = parent_[j];
+    };
+
+    // sum the differences up the tree
+    for (coord_t j = 0; j < ncols_; ++j)
+      if (-1 != parent_[j])
+        counts_[parent_[j]] += counts_[j];
+  };
+
+  /// Write the items of `v`, one per line, to file `filename`.
+  static void write_vector(const std::string& filename, const std::vector<coord_t>& v)
+  {
+    pointer<std::ostream> out;
+    if ("-" == filename)
+      out = std::cout;
+    else {
+      errno = 0;
+      std::ofstream* file = new std::ofstream(filename.c_str());
+      if (not file->good()) {
+        delete file;
+        std::ostringstream msg;
+        msg << "Cannot open file '" << filename << "' for writing: " << strerror(errno);
+        throw std::runtime_error(msg.str());
+      };
+      out = file;
+    };
+    for (std::vector<coord_t>::const_iterator k = v.begin(); k != v.end(); ++k)
+      (*out) << *k << '\n';
+    out->flush();
+    if (out->bad()) {
+      std::ostringstream msg;
+      msg << "Error writing to '" << filename << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+  };
+};
+
+
+SMASTO_MAIN("fill", FillProgram)
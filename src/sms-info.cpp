@@ -96,7 +96,4 @@ private:
 };
 
 
-int main(int argc, char** argv)
-{
-  return InfoProgram().main(argc, argv);
-};
+SMASTO_MAIN("info", InfoProgram)
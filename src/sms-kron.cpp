@@ -0,0 +1,442 @@
+/**
+ * @file   sms-kron.cpp
+ *
+ * Compute the Kronecker product of two matrices, or assemble a matrix
+ * from a grid of blocks.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// output is formatted in blocks of about this many entries
+static const double BLOCK_ENTRIES = 65536;
+
+
+/** Read an SMS matrix into a @ref CSRMatrix, with rows sorted. */
+template< typename val_t >
+class MatrixLoader : public SMSReader<val_t>
+{
+public:
+  MatrixLoader() : nrows_(0), ncols_(0), rows_(), cols_(), values_() { };
+
+  void load(std::istream& input, const std::string& name, CSRMatrix<val_t, coord_t>& m)
+  {
+    this->open(input);
+    nrows_ = this->rows();
+    ncols_ = this->columns();
+    try {
+      this->read();
+    }
+    catch (std::runtime_error& ex) {
+      // say which of the input matrices is wrong
+      throw std::runtime_error("Matrix '" + name + "': " + ex.what());
+    };
+    this->close();
+    m.assign(nrows_, ncols_, rows_, cols_, values_);
+    if (ROW_MAJOR_ORDER != this->order())
+      m.sort_rows();
+  };
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    rows_.push_back(i);
+    cols_.push_back(j);
+    values_.push_back(value);
+  };
+
+private:
+  coord_t nrows_;
+  coord_t ncols_;
+  std::vector<coord_t> rows_;
+  std::vector<coord_t> cols_;
+  std::vector<val_t> values_;
+};
+
+
+/** Format the rows of the Kronecker product of @c a and @c b, a
+    block of consecutive rows at a time; see @ref SMSWriter::write_blocks. */
+template< typename val_t >
+struct KronRows
+{
+  const CSRMatrix<val_t, coord_t>& a;
+  const CSRMatrix<val_t, coord_t>& b;
+  const SMSWriter<val_t>& writer;
+  coord_t nrows;
+  coord_t rows_per_block;
+
+  KronRows(const CSRMatrix<val_t, coord_t>& a_, const CSRMatrix<val_t, coord_t>& b_,
+           const SMSWriter<val_t>& writer_, const coord_t rows_per_block_)
+    : a(a_), b(b_), writer(writer_), nrows(a_.rows() * b_.rows()),
+      rows_per_block(rows_per_block_)
+  { };
+
+  template< typename buffer_t >
+  void operator()(const std::size_t block, buffer_t& buf)
+  {
+    const coord_t first = block * rows_per_block;
+    const coord_t last = std::min(first + rows_per_block, nrows);
+    // row `r` (0-based) is made of row `i` of A times row `k` of B
+    for (coord_t r = first; r < last; ++r) {
+      const coord_t i = r / b.rows() + 1;
+      const coord_t k = r % b.rows() + 1;
+      for (std::size_t p = a.row_begin(i); p < a.row_end(i); ++p) {
+        const coord_t base = (a.column(p) - 1) * b.columns();
+        const val_t& x = a.value(p);
+        for (std::size_t q = b.row_begin(k); q < b.row_end(k); ++q) {
+          // e.g., explicit zeroes, or values that vanish modulo p
+          const val_t y = checked_multiply(x, b.value(q));
+          if (not is_zero(y))
+            writer.format_entry(buf, r + 1, base + b.column(q), y);
+        };
+      };
+    };
+  };
+};
+
+
+/** Format the rows of a matrix made of a grid of blocks, a block of
+    consecutive rows at a time; see @ref SMSWriter::write_blocks. */
+template< typename val_t >
+struct GridRows
+{
+  /// blocks, by rows of the grid; NULL for zero blocks
+  const std::vector< const CSRMatrix<val_t, coord_t>* >& blocks;
+  /// first (0-based) row and column of each block row and column,
+  /// and the total number of rows and columns at the end
+  const std::vector<coord_t>& row_offset;
+  const std::vector<coord_t>& col_offset;
+  const SMSWriter<val_t>& writer;
+  coord_t rows_per_block;
+
+  GridRows(const std::vector< const CSRMatrix<val_t, coord_t>* >& blocks_,
+           const std::vector<coord_t>& row_offset_, const std::vector<coord_t>& col_offset_,
+           const SMSWriter<val_t>& writer_, const coord_t rows_per_block_)
+    : blocks(blocks_), row_offset(row_offset_), col_offset(col_offset_),
+      writer(writer_), rows_per_block(rows_per_block_)
+  { };
+
+  template< typename buffer_t >
+  void operator()(const std::size_t block, buffer_t& buf)
+  {
+    const std::size_t grid_cols = col_offset.size() - 1;
+    const coord_t first = block * rows_per_block;
+    const coord_t last = std::min(first + rows_per_block, row_offset.back());
+    std::size_t I = std::upper_bound(row_offset.begin(), row_offset.end(), first)
+      - row_offset.begin() - 1;
+    for (coord_t r = first; r < last; ++r) {
+      while (r >= row_offset[I+1])
+        ++I;
+      const coord_t i = r - row_offset[I] + 1;
+      for (std::size_t J = 0; J < grid_cols; ++J) {
+        const CSRMatrix<val_t, coord_t>* m = blocks[I * grid_cols + J];
+        if (NULL == m)
+          continue;
+        for (std::size_t p = m->row_begin(i); p < m->row_end(i); ++p)
+          writer.format_entry(buf, r + 1, col_offset[J] + m->column(p), m->value(p));
+      };
+    };
+  };
+};
+
+
+class KronProgram : public FilterProgram
+{
+public:
+  KronProgram()
+    : grid_rows_(0), grid_cols_(0), inputs_(),
+      value_type_(AUTO_VALUE_TYPE), modular_(false), field_()
+  {
+    this->add_option('D', "value-type", required_argument,
+                     "Hold matrix entry values as ARG: one of int64, float, double, long-double,"
+                     " or auto (default; int64 if all inputs have only integer values, else long-double).");
+    this->add_option('g', "grid", required_argument,
+                     "Assemble the output from an ARG grid of blocks, given as ROWSxCOLUMNS.");
+    this->add_option('M', "modulus", required_argument,
+                     "Reduce integer entry values modulo prime ARG (less than 2^32), and do all arithmetic modulo ARG.");
+    this->description =
+      "Write the Kronecker product of matrices A and B to OUTPUT (or to\n"
+      "the standard output, if omitted): its entry in row (i-1)*m+k and\n"
+      "column (j-1)*n+l is A(i,j)*B(k,l), where m and n are the number of\n"
+      "rows and columns of B; products that are zero are omitted.  Both\n"
+      "factors are held in memory, but the product is not: it is written\n"
+      "in row-major order, formatting blocks of rows in parallel.\n"
+      "\n"
+      "With option `--grid ROWSxCOLUMNS`, the ROWS*COLUMNS positional\n"
+      "arguments, in row-major order, are instead the blocks of the\n"
+      "OUTPUT matrix, which are placed side by side and stacked on top\n"
+      "of each other.  Blocks in the same row (resp. column) of the grid\n"
+      "must have the same number of rows (resp. columns); the argument\n"
+      "`0` stands for a block of zeroes of the appropriate size.\n"
+      "\n"
+      "All matrices are in J.-G. Dumas' SMS format.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('D' == opt)
+      value_type_ = parse_value_type(argument);
+    else if ('g' == opt) {
+      std::istringstream arg(argument);
+      char x = 0;
+      if (not (arg >> grid_rows_ >> x >> grid_cols_) or 'x' != x
+          or grid_rows_ < 1 or grid_cols_ < 1 or not arg.eof())
+        throw std::runtime_error("Argument to '--grid' must have the form ROWSxCOLUMNS,"
+                                 " with ROWS and COLUMNS positive integers.");
+    }
+    else if ('M' == opt) {
+      unsigned long long p = 0;
+      std::istringstream(argument) >> p;
+      field_ = PrimeField(p);
+      modular_ = true;
+    };
+  };
+
+  void parse_args(int argc, char** argv)
+  {
+    const int ninputs = (grid_rows_ > 0? grid_rows_ * grid_cols_ : 2);
+    if (argc - 1 < ninputs or argc - 1 > ninputs + 1) {
+      std::ostringstream msg;
+      msg << (grid_rows_ > 0? "Option '--grid' requires " : "Exactly ")
+          << ninputs << " input matrices and an optional OUTPUT."
+          << " Type '" << argv[0] << " --help' to get usage help.";
+      throw std::runtime_error(msg.str());
+    };
+    inputs_.assign(argv + 1, argv + 1 + ninputs);
+    if (argc - 1 > ninputs)
+      set_output(argv[argc-1]);
+    set_output_format(notation_, precision_);
+  };
+
+  int run()
+  {
+    if (modular_) {
+      if (AUTO_VALUE_TYPE != value_type_)
+        throw std::runtime_error("Options '--modulus' and '--value-type' cannot be used together.");
+      PrimeField::set_current(&field_);
+      try {
+        const int exitcode = run_as<ModularValue>();
+        PrimeField::set_current(NULL);
+        return exitcode;
+      }
+      catch (...) {
+        PrimeField::set_current(NULL);
+        throw;
+      };
+    };
+
+    value_type type = value_type_;
+    if (AUTO_VALUE_TYPE == type) {
+      type = INT64_VALUE_TYPE;
+      // the Kronecker product multiplies values from the two inputs,
+      // so their largest values bound the magnitude of the result
+      long double product = 1;
+      for (std::size_t n = 0; n < inputs_.size() and INT64_VALUE_TYPE == type; ++n) {
+        if (is_zero_block(inputs_[n]))
+          continue;
+        pointer<std::istream> input;
+        open_input(inputs_[n], input);
+        long double largest = 0;
+        type = detect_value_type(*input, &largest);
+        if (0 == grid_rows_)
+          product *= largest;
+      };
+      if (product >= std::numeric_limits<int64_t>::max())
+        type = LONG_DOUBLE_VALUE_TYPE;
+    };
+    switch (type) {
+    case INT64_VALUE_TYPE:  return run_as<int64_t>();
+    case FLOAT_VALUE_TYPE:  return run_as<float>();
+    case DOUBLE_VALUE_TYPE: return run_as<double>();
+    default:
+#ifdef HAVE_LONG_DOUBLE
+      return run_as<long double>();
+#else
+      return run_as<double>();
+#endif
+    };
+  };
+
+
+private:
+  coord_t grid_rows_;
+  coord_t grid_cols_;
+  std::vector<std::string> inputs_;
+
+  value_type value_type_;
+  /// whether to use `ModularValue` arithmetic in `field_`
+  bool modular_;
+  PrimeField field_;
+
+  bool is_zero_block(const std::string& name) const
+  {
+    return grid_rows_ > 0 and "0" == name;
+  };
+
+  static void open_input(const std::string& filename, pointer<std::istream>& input)
+  {
+    if ("-" == filename) {
+      input = std::cin;
+      return;
+    };
+    errno = 0;
+    std::ifstream* file = new std::ifstream(filename.c_str());
+    if (not file->good()) {
+      delete file;
+      std::ostringstream msg;
+      msg << "Cannot open input file '" << filename << "': " << strerror(errno) << ".";
+      throw std::runtime_error(msg.str());
+    };
+    input = file;
+  };
+
+  template< typename val_t >
+  static void load(const std::string& filename, CSRMatrix<val_t, coord_t>& m)
+  {
+    pointer<std::istream> input;
+    open_input(filename, input);
+    MatrixLoader<val_t>().load(*input, filename, m);
+  };
+
+  /// Return how many rows to format at a time, so that each block
+  /// of rows has about `BLOCK_ENTRIES` entries on average.
+  static coord_t rows_per_block(const coord_t nrows, const double nnz)
+  {
+    if (nnz <= BLOCK_ENTRIES)
+      return std::max<coord_t>(nrows, 1);
+    return std::max<coord_t>(nrows * (BLOCK_ENTRIES / nnz), 1);
+  };
+
+  static coord_t checked_product(const coord_t x, const coord_t y)
+  {
+    if (x > 0 and y > std::numeric_limits<coord_t>::max() / x)
+      throw std::runtime_error("The dimensions of the product do not fit into a `long` integer.");
+    return x * y;
+  };
+
+  template< typename val_t >
+  int run_as()
+  {
+    if (grid_rows_ > 0)
+      return run_grid<val_t>();
+
+    CSRMatrix<val_t, coord_t> a, b;
+    load(inputs_[0], a);
+    load(inputs_[1], b);
+    const coord_t nrows = checked_product(a.rows(), b.rows());
+    const coord_t ncols = checked_product(a.columns(), b.columns());
+    const double nnz = static_cast<double>(a.nonzeros()) * b.nonzeros();
+
+    SMSWriter<val_t> writer;
+    writer.open(*output_, nrows, ncols);
+    KronRows<val_t> gen(a, b, writer, rows_per_block(nrows, nnz));
+    const std::size_t nblocks = (nrows + gen.rows_per_block - 1) / gen.rows_per_block;
+    writer.write_blocks(nblocks, gen);
+    writer.close();
+    return 0;
+  };
+
+  template< typename val_t >
+  int run_grid()
+  {
+    const std::size_t nblocks = inputs_.size();
+    std::vector< CSRMatrix<val_t, coord_t> > matrices(nblocks);
+    std::vector< const CSRMatrix<val_t, coord_t>* > blocks(nblocks, NULL);
+    // size of each block row and column; -1 if not known yet
+    std::vector<coord_t> heights(grid_rows_, -1), widths(grid_cols_, -1);
+    double nnz = 0;
+    for (std::size_t n = 0; n < nblocks; ++n) {
+      if (is_zero_block(inputs_[n]))
+        continue;
+      load(inputs_[n], matrices[n]);
+      blocks[n] = &matrices[n];
+      nnz += matrices[n].nonzeros();
+      check_size(heights[n / grid_cols_], matrices[n].rows(), n, "rows");
+      check_size(widths[n % grid_cols_], matrices[n].columns(), n, "columns");
+    };
+
+    std::vector<coord_t> row_offset(grid_rows_ + 1, 0), col_offset(grid_cols_ + 1, 0);
+    for (coord_t I = 0; I < grid_rows_; ++I) {
+      if (heights[I] < 0) {
+        std::ostringstream msg;
+        msg << "Cannot tell the number of rows of block row " << (I+1)
+            << ", as it only has zero blocks.";
+        throw std::runtime_error(msg.str());
+      };
+      row_offset[I+1] = row_offset[I] + heights[I];
+    };
+    for (coord_t J = 0; J < grid_cols_; ++J) {
+      if (widths[J] < 0) {
+        std::ostringstream msg;
+        msg << "Cannot tell the number of columns of block column " << (J+1)
+            << ", as it only has zero blocks.";
+        throw std::runtime_error(msg.str());
+      };
+      col_offset[J+1] = col_offset[J] + widths[J];
+    };
+
+    const coord_t nrows = row_offset.back();
+    const coord_t ncols = col_offset.back();
+    SMSWriter<val_t> writer;
+    writer.open(*output_, nrows, ncols);
+    GridRows<val_t> gen(blocks, row_offset, col_offset, writer, rows_per_block(nrows, nnz));
+    writer.write_blocks((nrows + gen.rows_per_block - 1) / gen.rows_per_block, gen);
+    writer.close();
+    return 0;
+  };
+
+  /// Set `size` to `actual`, unless it is already set to a different
+  /// value; in that case, complain about the `n`-th input.
+  void check_size(coord_t& size, const coord_t actual, const std::size_t n, const char* what) const
+  {
+    if (size < 0)
+      size = actual;
+    else if (size != actual) {
+      std::ostringstream msg;
+      msg << "Matrix '" << inputs_[n] << "' has " << actual << " " << what
+          << ", but other blocks in the same grid " << ('r' == what[0]? "row" : "column")
+          << " have " << size << ".";
+      throw std::runtime_error(msg.str());
+    };
+  };
+};
+
+
+SMASTO_MAIN("kron", KronProgram)
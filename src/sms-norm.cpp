@@ -31,23 +31,24 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <type_traits>
 
 
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
-
 
+template< typename val_t >
 class ComputeNormProgram : public FilterProgram
 {
 public:
+  /// type used for computing norms; integer values are summed as
+  /// `long double`, so that the L^2 norm is not truncated
+  typedef typename std::conditional<std::is_floating_point<val_t>::value,
+                                    val_t, long double>::type norm_t;
+
   ComputeNormProgram() 
     : metric_(L2_METRIC)
   {
@@ -73,12 +74,17 @@ public:
       metric_ = LINFTY_METRIC;
   };
 
+  /** Return @c true if results are exact with integer values. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() { 
-    StreamNormComputer<val_t>* processor;
+    if (std::is_same<val_t, ModularValue>::value)
+      throw std::runtime_error("Norms are not defined for matrices over GF(p).");
+    StreamNormComputer* processor;
     switch (metric_) {
-    case L1_METRIC: processor = new L1NormComputer<val_t>(); break;
-    case L2_METRIC: processor = new L2NormComputer<val_t>(); break;
-    case LINFTY_METRIC: processor = new LInftyNormComputer<val_t>(); break;
+    case L1_METRIC: processor = new L1NormComputer(); break;
+    case L2_METRIC: processor = new L2NormComputer(); break;
+    case LINFTY_METRIC: processor = new LInftyNormComputer(); break;
     };
     processor->open(*input_);
     processor->read();
@@ -87,46 +93,42 @@ public:
   };
 
   /** Base class for the metric-dependent norm computation. */
-  template< typename val_t >
   class StreamNormComputer : public SMSReader<val_t> {
   public:
-    virtual val_t get_norm() const = 0;
+    virtual norm_t get_norm() const = 0;
   };
 
-  template< typename val_t >
-  class L1NormComputer : public StreamNormComputer<val_t> {
+  class L1NormComputer : public StreamNormComputer {
   public:
-    val_t get_norm() const { return norm_; };
+    norm_t get_norm() const { return norm_; };
   private:
     void process_entry(const coord_t, const coord_t, const val_t& value) {
-      norm_ += std::abs(value);
+      norm_ += std::abs(static_cast<norm_t>(value));
     };
-    val_t norm_;
+    norm_t norm_;
   };
 
-  template< typename val_t >
-  class L2NormComputer : public StreamNormComputer<val_t> {
+  class L2NormComputer : public StreamNormComputer {
   public:
-    val_t get_norm() const { return norm_; };
+    norm_t get_norm() const { return norm_; };
   private:
     void process_entry(const coord_t, const coord_t, const val_t& value) {
-      const val_t absval = std::abs(value);
+      const norm_t absval = std::abs(static_cast<norm_t>(value));
       norm_ = std::sqrt(norm_ * norm_ + absval * absval);
     };
-    val_t norm_;
+    norm_t norm_;
   };
 
-  template< typename val_t >
-  class LInftyNormComputer : public StreamNormComputer<val_t> {
+  class LInftyNormComputer : public StreamNormComputer {
   public:
-    val_t get_norm() const { return norm_; };
+    norm_t get_norm() const { return norm_; };
   private:
     void process_entry(const coord_t, const coord_t, const val_t& value) {
-      const val_t absval = std::abs(value);
+      const norm_t absval = std::abs(static_cast<norm_t>(value));
       if (absval > norm_)
         norm_ = absval;
     };
-    val_t norm_;
+    norm_t norm_;
   };
 
 private:
@@ -138,7 +140,4 @@ private:
 };
 
 
-int main(int argc, char** argv)
-{
-  return ComputeNormProgram().main(argc, argv);
-};
+SMASTO_TYPED_MAIN("norm", ComputeNormProgram)
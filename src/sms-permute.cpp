@@ -0,0 +1,241 @@
+/**
+ * @file   sms-permute.cpp
+ *
+ * Apply row and column permutations to a matrix.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// permuting does not care about the type of the entries
+typedef std::string val_t;
+
+
+class PermuteProgram : public FilterProgram,
+                       public SMSReader<val_t>,
+                       public SMSWriter<val_t>
+{
+public:
+  PermuteProgram()
+    : row_perm_files_(), col_perm_files_(),
+      row_out_file_(), col_out_file_(), perm_format_(TEXT_PERMUTATION),
+      inverse_(false), sorted_(false), no_matrix_(false),
+      new_row_(), new_col_(),
+      entries_()
+  {
+    this->add_option('B', "binary-permutation", no_argument,
+                     "Write permutation files in binary format.");
+    this->add_option('c', "columns", required_argument,
+                     "Apply the column permutation read from file ARG."
+                     " Can be repeated; permutations are applied in the order given.");
+    this->add_option('n', "no-matrix", no_argument,
+                     "Only compose permutations; do not read a matrix.");
+    this->add_option('r', "rows", required_argument,
+                     "Apply the row permutation read from file ARG."
+                     " Can be repeated; permutations are applied in the order given.");
+    this->add_option('s', "sorted", no_argument,
+                     "Output entries sorted by row and column index.");
+    this->add_option('u', "inverse", no_argument,
+                     "Apply the inverse of the (composed) permutations.");
+    this->add_option('w', "write-rows", required_argument,
+                     "Write the composed row permutation to file ARG.");
+    this->add_option('W', "write-columns", required_argument,
+                     "Write the composed column permutation to file ARG.");
+    this->description =
+      "Permute rows and columns of the INPUT matrix, according to the\n"
+      "permutations read from the files given with options `--rows` and\n"
+      "`--columns`, and write the result to OUTPUT.  Permutation files\n"
+      "list the old row (resp. column) indices in their new order, and\n"
+      "can be in text or binary format; they are produced, e.g., by the\n"
+      "`--row-permutation` and `--column-permutation` options of\n"
+      "`sms-reordrows`, `sms-reordcols` and `sms-blockechelon`.\n"
+      "\n"
+      "If options `--rows` or `--columns` are given several times, the\n"
+      "permutations are composed, in the order given on the command line,\n"
+      "and the matrix is permuted in a single pass.  Options `--write-rows`\n"
+      "and `--write-columns` save the composed permutations to a file;\n"
+      "with option `--no-matrix`, only this is done and no matrix is read.\n"
+      "\n"
+      "By default, matrix entries are output in the same order they are\n"
+      "read, so that only the permutation vectors are kept in memory.\n"
+      "Option `--sorted` requests that the OUTPUT matrix is sorted by row\n"
+      "and column index instead; this requires memory proportional to the\n"
+      "number of nonzero entries.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('B' == opt)
+      perm_format_ = BINARY_PERMUTATION;
+    else if ('c' == opt)
+      col_perm_files_.push_back(argument);
+    else if ('n' == opt)
+      no_matrix_ = true;
+    else if ('r' == opt)
+      row_perm_files_.push_back(argument);
+    else if ('s' == opt)
+      sorted_ = true;
+    else if ('u' == opt)
+      inverse_ = true;
+    else if ('w' == opt)
+      row_out_file_ = argument;
+    else if ('W' == opt)
+      col_out_file_ = argument;
+  };
+
+  int run() {
+    std::vector<coord_t> row_perm;
+    compose(row_perm_files_, row_perm);
+    std::vector<coord_t> col_perm;
+    compose(col_perm_files_, col_perm);
+
+    if (no_matrix_) {
+      if (row_out_file_.empty() and col_out_file_.empty())
+        throw std::runtime_error("Option '--no-matrix' requires one of '--write-rows' or '--write-columns'.");
+      if (not row_out_file_.empty())
+        write_permutation(row_out_file_, row_perm, perm_format_);
+      if (not col_out_file_.empty())
+        write_permutation(col_out_file_, col_perm, perm_format_);
+      return 0;
+    };
+
+    SMSReader<val_t>::open(*FilterProgram::input_);
+    const coord_t nrows = SMSReader<val_t>::rows();
+    const coord_t ncols = SMSReader<val_t>::columns();
+
+    // a missing permutation is the identity
+    fill_identity(row_perm, nrows, "row");
+    fill_identity(col_perm, ncols, "column");
+
+    if (not row_out_file_.empty())
+      write_permutation(row_out_file_, row_perm, perm_format_);
+    if (not col_out_file_.empty())
+      write_permutation(col_out_file_, col_perm, perm_format_);
+
+    // the permutation files give the new-to-old mapping; we need the
+    // old-to-new one to move entries, unless inverting
+    if (inverse_) {
+      new_row_.assign(1, 0);
+      new_row_.insert(new_row_.end(), row_perm.begin(), row_perm.end());
+      new_col_.assign(1, 0);
+      new_col_.insert(new_col_.end(), col_perm.begin(), col_perm.end());
+    }
+    else {
+      invert_permutation(row_perm, new_row_);
+      invert_permutation(col_perm, new_col_);
+    };
+    std::vector<coord_t>().swap(row_perm);
+    std::vector<coord_t>().swap(col_perm);
+
+    if (not sorted_) {
+      // stream entries straight to the output
+      SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
+      read();
+      SMSReader<val_t>::close();
+      SMSWriter<val_t>::close();
+      return 0;
+    };
+
+    entries_.reset(nrows, ncols);
+    read();
+    SMSReader<val_t>::close();
+
+    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
+    entries_.write_sorted(*this, nrows, ncols);
+    SMSWriter<val_t>::close();
+
+    return 0;
+  };
+
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    if (sorted_)
+      entries_.push_back(new_row_[i], new_col_[j], value);
+    else
+      write_entry(new_row_[i], new_col_[j], value);
+  };
+
+
+private:
+  std::vector<std::string> row_perm_files_;
+  std::vector<std::string> col_perm_files_;
+  std::string row_out_file_;
+  std::string col_out_file_;
+  permutation_format perm_format_;
+
+  bool inverse_;
+  bool sorted_;
+  bool no_matrix_;
+
+  /// map old row (resp. column) index to new one
+  std::vector<coord_t> new_row_;
+  std::vector<coord_t> new_col_;
+
+  /// permuted entries, when output needs to be sorted
+  EntryList<val_t> entries_;
+
+  /// Read permutations from the given files and compose them.
+  void compose(const std::vector<std::string>& filenames, std::vector<coord_t>& perm)
+  {
+    perm.clear();
+    for (std::vector<std::string>::const_iterator f = filenames.begin(); f != filenames.end(); ++f) {
+      std::vector<coord_t> next;
+      read_permutation(*f, next);
+      if (perm.empty())
+        perm.swap(next);
+      else
+        compose_permutations(perm, next, perm);
+    };
+  };
+
+  /// Set @c perm to the identity if empty, else check its length.
+  void fill_identity(std::vector<coord_t>& perm, const coord_t n, const char* what)
+  {
+    if (perm.empty()) {
+      perm.resize(n);
+      for (coord_t k = 0; k < n; ++k)
+        perm[k] = k+1;
+    }
+    else if (static_cast<coord_t>(perm.size()) != n) {
+      std::ostringstream msg;
+      msg << "The " << what << " permutation has length " << perm.size()
+          << " but the matrix has " << n << " " << what << "s.";
+      throw std::runtime_error(msg.str());
+    };
+  };
+};
+
+
+SMASTO_MAIN("permute", PermuteProgram)
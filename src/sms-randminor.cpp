@@ -28,25 +28,22 @@
 
 #include "common.hpp"
 
-#include <cmath>
-#include <cstdlib>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <algorithm>
+#include <ctime>
 #include <iostream>
-#include <map>
-#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
-
 
+template< typename val_t >
 class RandminorProgram : public FilterProgram, 
                          public SMSReader<val_t>,
                          public SMSWriter<val_t>
@@ -54,12 +51,15 @@ class RandminorProgram : public FilterProgram,
 public:
   RandminorProgram() 
     : height_(0), width_(0),
+      seed_(std::time(NULL)), shuffle_(false),
       from_rows_(), to_rows_(),
       from_cols_(), to_cols_(),
-      m()
+      entries_()
   {
     this->add_option('C', "columns", required_argument, "Number of columns in the minor to extract.");
+    this->add_option('P', "permute", no_argument, "Arrange rows and columns of the minor in random order.");
     this->add_option('R', "rows",    required_argument, "Number of rows in the minor to extract.");
+    this->add_option('s', "seed",    required_argument, "Seed the random number generator with ARG (default: current time).");
     this->description = 
       "Extract a minor of the given input matrix (with dimensions specified.\n"
       "by the '-R' and '-C' options), obtained by randomly selecting rows\n"
@@ -67,6 +67,12 @@ public:
       "columns are selected from the whole allowable range, not just the rows\n"
       "and columns containing nonzero entries: therefore small minors have a\n"
       "likely chance of being entirely null.\n"
+      "\n"
+      "Selected rows and columns keep their relative order, so entries are\n"
+      "copied to OUTPUT as they are read.  With option '--permute', rows and\n"
+      "columns of the minor are arranged in random order instead; this\n"
+      "requires keeping the minor in memory.  Use option '--seed' to get\n"
+      "reproducible results.\n"
       ;
   };
 
@@ -74,10 +80,17 @@ public:
   {
     if ('C' == opt)
       std::istringstream(argument) >> width_;
+    else if ('P' == opt)
+      shuffle_ = true;
     else if ('R' == opt)
       std::istringstream(argument) >> height_;
+    else if ('s' == opt)
+      std::istringstream(argument) >> seed_;
   };
 
+  /** Entry values are only copied, so integer values are fine. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() { 
     if (height_ < 1)
       throw std::runtime_error("Use the '-R' option to set a positive number of rows for the minor.");
@@ -87,34 +100,38 @@ public:
     SMSReader<val_t>::open(*FilterProgram::input_);
     const coord_t nrows = SMSReader<val_t>::rows();
     const coord_t ncols = SMSReader<val_t>::columns();
+    if (height_ > nrows or width_ > ncols) {
+      std::ostringstream msg;
+      msg << "Cannot extract a " << height_ << "x" << width_ << " minor"
+          << " from a " << nrows << "x" << ncols << " matrix.";
+      throw std::runtime_error(msg.str());
+    };
 
-    srand(time(NULL));
-    // generate set of rows
-    while (from_rows_.size() < height_) {
-      const coord_t r = rand_coord();
-      if (r <= nrows) {
-        from_rows_.insert(r);
-        to_rows_[r] = from_rows_.size();
-      };
+    boost::random::mt19937_64 rng(seed_);
+    sample(rng, nrows, height_, from_rows_);
+    sample(rng, ncols, width_, from_cols_);
+    if (shuffle_) {
+      shuffle(rng, height_, to_rows_);
+      shuffle(rng, width_, to_cols_);
     };
-    // generate set of columns
-    while (from_cols_.size() < width_) {
-      const coord_t c = rand_coord();
-      if (c <= ncols) {
-        from_cols_.insert(c);
-        to_cols_[c] = from_cols_.size();
-      };
+
+    if (not shuffle_) {
+      // the index mapping is monotone: stream entries to OUTPUT
+      SMSWriter<val_t>::open(*FilterProgram::output_, height_, width_);
+      SMSReader<val_t>::read();
+      SMSReader<val_t>::close();
+      SMSWriter<val_t>::close();
+      return 0;
     };
-    
+
     // read and process matrix entries
-    read();
+    entries_.reset(height_, width_);
+    SMSReader<val_t>::read();
     SMSReader<val_t>::close();
 
     // output minor
-    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
-    for(matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
-      for(vector_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
-        write_entry(r->first, c->first, c->second);
+    SMSWriter<val_t>::open(*FilterProgram::output_, height_, width_);
+    entries_.write_sorted(*this, height_, width_);
     SMSWriter<val_t>::close();
 
     return 0; 
@@ -124,8 +141,12 @@ public:
   {
     // if row i and col j are in the pre-selected set, copy triple
     // remapping row and col index
-    if (from_rows_.count(i) and from_cols_.count(j))
-      m[to_rows_[i]][to_cols_[j]] = value;
+    if (not (from_rows_.test(i) and from_cols_.test(j)))
+      return;
+    if (shuffle_)
+      entries_.push_back(to_rows_[from_rows_.rank(i)], to_cols_[from_cols_.rank(j)], value);
+    else
+      SMSWriter<val_t>::write_entry(from_rows_.rank(i), from_cols_.rank(j), value);
   };
 
 
@@ -133,29 +154,49 @@ private:
   coord_t height_;
   coord_t width_;
 
-  std::set< coord_t > from_rows_;
-  std::map< coord_t, coord_t > to_rows_;
+  unsigned long long seed_;
+  bool shuffle_;
+
+  /// selected row indices; the new index of a selected row is either
+  /// its rank in the set, or `to_rows_[rank]` if `shuffle_` is set
+  IndexBitmap from_rows_;
+  std::vector<coord_t> to_rows_;
 
-  std::set< coord_t > from_cols_;
-  std::map< coord_t, coord_t > to_cols_;
+  /// same as `from_rows_`/`to_rows_`, for columns
+  IndexBitmap from_cols_;
+  std::vector<coord_t> to_cols_;
 
-  typedef std::map< coord_t, val_t > vector_t;
-  typedef std::map< coord_t, vector_t > matrix_t;
-  matrix_t m;
+  /// minor entries, if they need to be sorted before output
+  EntryList<val_t> entries_;
 
-  // just in case rand() does not provide enough random bits
-  coord_t rand_coord()
+  /// Select `k` distinct indices out of 1..n with Floyd's algorithm,
+  /// which takes O(k) random draws.
+  void sample(boost::random::mt19937_64& rng, const coord_t n, const coord_t k,
+              IndexBitmap& selected)
   {
-#if RAND_MAX < 2147483647 /* 2^31 */
-    return (rand() ^ (rand() << 16));
-#else
-    return rand();
-#endif
+    selected.reset(n);
+    for (coord_t j = n - k + 1; j <= n; ++j) {
+      const coord_t t = boost::random::uniform_int_distribution<coord_t>(1, j)(rng);
+      if (selected.test(t))
+        selected.set(j);
+      else
+        selected.set(t);
+    };
+    selected.build_rank();
+  };
+
+  /// Make a random permutation of 1..k with a Fisher-Yates shuffle;
+  /// `order` is indexed 1-based.
+  void shuffle(boost::random::mt19937_64& rng, const coord_t k,
+               std::vector<coord_t>& order)
+  {
+    order.resize(k+1);
+    for (coord_t j = 0; j <= k; ++j)
+      order[j] = j;
+    for (coord_t j = k; j > 1; --j)
+      std::swap(order[j], order[boost::random::uniform_int_distribution<coord_t>(1, j)(rng)]);
   };
 };
 
 
-int main(int argc, char** argv)
-{
-  return RandminorProgram().main(argc, argv);
-};
+SMASTO_TYPED_MAIN("randminor", RandminorProgram)
@@ -28,16 +28,15 @@
 
 #include "common.hpp"
 
-#include <boost/random/mersenne_twister.hpp>
-//#include <boost/random/random_device.hpp>
-#include <boost/random/uniform_01.hpp>
+#include <boost/unordered_set.hpp>
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
-#include <map>
-#include <set>
 #include <sstream>
+#include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
@@ -57,14 +56,26 @@ class RandomSparseProgram : public FilterProgram,
 public:
   RandomSparseProgram() 
     : height_(0), width_(0), density_(0),
-      N_(0)
+      N_(0), seed_(0), nonzeros_(0), rows_per_block_(1), pos_()
   {
     this->add_option('I', "integer", required_argument, "Matrix has integer entries in the range 1 to ARG..");
+    this->add_option('n', "nonzeros", required_argument,
+                     "Generate a matrix with exactly ARG nonzero entries; the DENSITY argument must be omitted.");
+    this->add_option('s', "seed", required_argument,
+                     "Initialize the random number generator with seed ARG (default: 0).");
     this->description = 
       "Generate a random sparse matrix of the given size and write it to OUTPUT.\n"
       "Each entry has a probability of being nonzero equal to the DENSITY.\n"
       "Entry values are uniformly distributed real numbers between 0 and 1;\n"
       "use the '-I N' option to generate integer entries in the range 1 to N.\n"
+      "\n"
+      "With option `--nonzeros N`, exactly N distinct positions are chosen\n"
+      "uniformly at random, and the DENSITY argument must not be given.\n"
+      "\n"
+      "The generated matrix depends only on the dimensions, the density\n"
+      "(or number of nonzeros) and the `--seed` value: running with the\n"
+      "same arguments always gives the same OUTPUT, regardless of the\n"
+      "number of threads used.\n"
       ;
   };
 
@@ -73,13 +84,23 @@ public:
   {
     if ('I' == opt)
       std::istringstream(argument) >> N_;
+    else if ('n' == opt) {
+      std::istringstream(argument) >> nonzeros_;
+      if (nonzeros_ < 1)
+        throw std::runtime_error("Argument to option '--nonzeros' must be a positive integer.");
+    }
+    else if ('s' == opt)
+      std::istringstream(argument) >> seed_;
   };
 
 
   void parse_args(int argc, char** argv)
   {
+    // in exact mode, there is no DENSITY argument
+    const int first = (nonzeros_ > 0? 1 : 2);
+
     // too few arguments
-    if (argc < 4) {
+    if (argc < first + 2) {
       std::ostringstream msg;
       msg << "Not all required arguments present."
           << " Type '" << argv[0] << " --help' to get usage help."
@@ -88,19 +109,20 @@ public:
     };
 
     // usage: DENSITY ROWS COLUMNS [OUTPUT]
-    std::istringstream(argv[1]) >> density_;
-    std::istringstream(argv[2]) >> height_;
-    std::istringstream(argv[3]) >> width_;
-    if (argc > 4)
-      set_output(argv[4]);
+    if (2 == first)
+      std::istringstream(argv[1]) >> density_;
+    std::istringstream(argv[first]) >> height_;
+    std::istringstream(argv[first+1]) >> width_;
+    if (argc > first+2)
+      set_output(argv[first+2]);
     else
       set_output("-");
     set_output_format(notation_, precision_);
 
     // too many arguments
-    if (argc > 5) {
+    if (argc > first+3) {
       std::ostringstream msg;
-      msg << "At most four positional arguments allowed."
+      msg << "At most " << (first+2) << " positional arguments allowed."
           << " Type '" << argv[0] << " --help' to get usage help."
           << std::endl;
       throw std::runtime_error(msg.str());
@@ -110,36 +132,35 @@ public:
 
   int run() { 
     if (height_ < 1)
-      throw std::runtime_error("Second argument (number of rows) must be positive!");
+      throw std::runtime_error("Number of rows must be positive!");
     if (width_ < 1)
-      throw std::runtime_error("Third argument (number of columns) must be positive!");
-    if (density_ <= 0 or density_ >= 1)
-      throw std::runtime_error("First argument (density) must be strictly in the floating-point range 0 to 1.");
+      throw std::runtime_error("Number of columns must be positive!");
+
+    // target number of entries in a block of rows formatted by one thread
+    const double entries_per_block = 32768;
+    double entries_per_row;
+    if (nonzeros_ > 0) {
+      if (static_cast<unsigned long long>(height_) > ULLONG_MAX / width_
+          or nonzeros_ > static_cast<unsigned long long>(height_) * width_)
+        throw std::runtime_error("Requested number of nonzeros exceeds the matrix size.");
+      sample_positions();
+      entries_per_row = 1.0 * nonzeros_ / height_;
+    }
+    else {
+      if (density_ <= 0 or density_ >= 1)
+        throw std::runtime_error("First argument (density) must be strictly in the floating-point range 0 to 1.");
+      entries_per_row = density_ * width_;
+    };
+    rows_per_block_ = static_cast<coord_t>(std::ceil(entries_per_block / entries_per_row));
+    if (rows_per_block_ < 1)
+      rows_per_block_ = 1;
+    if (rows_per_block_ > height_)
+      rows_per_block_ = height_;
 
     // generate matrix and write it
     SMSWriter<val_t>::open(*FilterProgram::output_, height_, width_);
-    boost::mt19937 rng;
-    boost::uniform_01<double> nonzero_dist;
-    boost::uniform_01<val_t> value_dist;
-    for(coord_t i = 0; i < height_; ++i)
-      for(coord_t j = 0; j < width_; ++j) {
-        // make a nonzero entry if we get a random number less than
-        // a certain threshold (the density)
-        double p = nonzero_dist(rng);
-        if (p >= density_)
-          continue;
-
-        val_t value = value_dist(rng);
-        // round to int if `-I` was used
-        if (N_ != 0)
-          value = static_cast<long>(1 + N_ * value);
-
-        if (0 == value)
-          continue;
-
-        // output entry
-        write_entry(i+1, j+1, value);
-      }
+    RowBlockGenerator gen(*this);
+    write_blocks((height_ + rows_per_block_ - 1) / rows_per_block_, gen);
     SMSWriter<val_t>::close();
 
     return 0; 
@@ -153,10 +174,99 @@ private:
   double density_;
 
   val_t N_;
-};
 
+  unsigned long long seed_;
+  /// number of nonzero entries in exact mode, or 0
+  unsigned long long nonzeros_;
 
-int main(int argc, char** argv)
-{
-  return RandomSparseProgram().main(argc, argv);
+  coord_t rows_per_block_;
+
+  /// sorted 0-based linear indices (row-major) of the entries, in exact mode
+  std::vector<unsigned long long> pos_;
+
+  /// Return a nonzero random entry value.
+  val_t draw_value(PhiloxRandom& rng) const
+  {
+    const double u = rng.uniform();
+    // round to int if `-I` was used
+    if (N_ != 0)
+      return static_cast<long>(1 + N_ * u);
+    // use (0,1] instead of [0,1), so the entry is never zero
+    return 1 - u;
+  };
+
+  /** Choose `nonzeros_` distinct positions with R. Floyd's sampling
+      algorithm: this takes time and memory proportional to the
+      number of positions, not to the matrix size. */
+  void sample_positions()
+  {
+    // use a stream number that no row stream uses
+    PhiloxRandom rng(seed_, ~0ULL);
+    const unsigned long long total = static_cast<unsigned long long>(height_) * width_;
+    boost::unordered_set<unsigned long long> chosen;
+    chosen.reserve(nonzeros_);
+    pos_.reserve(nonzeros_);
+    for (unsigned long long j = total - nonzeros_; j < total; ++j) {
+      const unsigned long long t = rng.below(j + 1);
+      const unsigned long long p = (chosen.insert(t).second? t : j);
+      if (p == j)
+        chosen.insert(j);
+      pos_.push_back(p);
+    };
+    std::sort(pos_.begin(), pos_.end());
+  };
+
+  /** Append the entries of rows `first` to `last` (1-based,
+      inclusive) to `buf`.  Each row draws its numbers from its own
+      random stream, so the result does not depend on how rows are
+      distributed among threads. */
+  template< typename buffer_t >
+  void generate_rows(const coord_t first, const coord_t last, buffer_t& buf) const
+  {
+    if (nonzeros_ > 0) {
+      std::vector<unsigned long long>::const_iterator p =
+        std::lower_bound(pos_.begin(), pos_.end(),
+                         static_cast<unsigned long long>(first-1) * width_);
+      for (coord_t i = first; i <= last; ++i) {
+        PhiloxRandom rng(seed_, i);
+        const unsigned long long row_end = static_cast<unsigned long long>(i) * width_;
+        for (; p != pos_.end() and *p < row_end; ++p)
+          format_entry(buf, i, 1 + (*p % width_), draw_value(rng));
+      };
+      return;
+    };
+
+    // geometric skip sampling: the gap between two consecutive
+    // nonzero entries in a row is geometrically distributed, so we
+    // can jump from one nonzero to the next with a single random draw
+    const double log_q = std::log1p(-density_);
+    for (coord_t i = first; i <= last; ++i) {
+      PhiloxRandom rng(seed_, i);
+      double j = 0;
+      while (true) {
+        j += 1 + std::floor(std::log(1 - rng.uniform()) / log_q);
+        if (j > width_)
+          break;
+        format_entry(buf, i, static_cast<coord_t>(j), draw_value(rng));
+      };
+    };
+  };
+
+  /// Functor passed to `SMSWriter::write_blocks`.
+  struct RowBlockGenerator
+  {
+    const RandomSparseProgram& program;
+    RowBlockGenerator(const RandomSparseProgram& p) : program(p) { };
+    template< typename buffer_t >
+    void operator()(const std::size_t b, buffer_t& buf) const
+    {
+      const coord_t first = 1 + b * program.rows_per_block_;
+      program.generate_rows(first,
+                            std::min(first + program.rows_per_block_ - 1, program.height_),
+                            buf);
+    };
+  };
 };
+
+
+SMASTO_MAIN("random", RandomSparseProgram)
@@ -0,0 +1,732 @@
+/**
+ * @file   sms-rank.cpp
+ *
+ * Compute the rank of a matrix modulo a prime, by sparse Gaussian
+ * elimination.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// entries are elements of GF(p)
+typedef ModularValue val_t;
+
+
+/** Nonzero entry of a sparse row. */
+struct RowEntry
+{
+  coord_t column;
+  uint32_t value;
+
+  bool operator<(const RowEntry& other) const { return column < other.column; };
+};
+
+typedef std::vector<RowEntry> sparse_row_t;
+
+
+/// Seconds elapsed since `start`.
+static double
+seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+};
+
+
+/// Return the position of the entry in column `j` of `row`, or -1.
+static long
+find_column(const sparse_row_t& row, const coord_t j)
+{
+  RowEntry key;
+  key.column = j;
+  const sparse_row_t::const_iterator it = std::lower_bound(row.begin(), row.end(), key);
+  if (it == row.end() or it->column != j)
+    return -1;
+  return it - row.begin();
+};
+
+
+/// Set `result` to `row + f * pivot`, where `fq` is `field.shoup(f)`;
+/// append to `added` the columns that `row` did not have (fill-in),
+/// and to `removed` those whose entries cancel out.
+static void
+update_row(const sparse_row_t& row, const sparse_row_t& pivot,
+           const uint32_t f, const uint32_t fq, const PrimeField& field,
+           sparse_row_t& result,
+           std::vector<coord_t>& added, std::vector<coord_t>& removed)
+{
+  result.clear();
+  added.clear();
+  removed.clear();
+  sparse_row_t::const_iterator a = row.begin();
+  sparse_row_t::const_iterator b = pivot.begin();
+  while (a != row.end() or b != pivot.end()) {
+    if (b == pivot.end() or (a != row.end() and a->column < b->column)) {
+      result.push_back(*a);
+      ++a;
+    }
+    else if (a == row.end() or b->column < a->column) {
+      // f and the pivot entry are nonzero, and so is their product
+      RowEntry e;
+      e.column = b->column;
+      e.value = field.multiply_by(b->value, f, fq);
+      result.push_back(e);
+      added.push_back(e.column);
+      ++b;
+    }
+    else {
+      RowEntry e;
+      e.column = a->column;
+      e.value = field.add(a->value, field.multiply_by(b->value, f, fq));
+      if (0 == e.value)
+        removed.push_back(e.column);
+      else
+        result.push_back(e);
+      ++a;
+      ++b;
+    };
+  };
+};
+
+
+class RankProgram : public FilterProgram,
+                    public SMSReader<val_t>
+{
+public:
+  RankProgram()
+    : field_(2147483647), threshold_(0.3), search_(4), report_(false),
+      echelon_file_(), col_perm_file_(), perm_format_(TEXT_PERMUTATION), rows_(), active_(), mark_(),
+      col_count_(), col_rows_(), head_(), next_(), prev_(), bucket_(),
+      lowest_(0), active_rows_(0), active_cols_(0), active_nnz_(0),
+      fill_(0), pivot_rows_(), pivot_cols_(), dense_rows_(), dense_cols_(),
+      dense_(), dense_rank_(0), samples_()
+  {
+    this->add_option('M', "modulus", required_argument,
+                     "Compute the rank modulo prime ARG, less than 2^32 (default: 2147483647).");
+    this->add_option('d', "dense-threshold", required_argument,
+                     "Switch to dense elimination when the remaining submatrix has at least"
+                     " this fraction ARG of nonzero entries (default: 0.3); 1 means never.");
+    this->add_option('s', "search", required_argument,
+                     "Number of candidate pivot rows to examine at each step (default: 4).");
+    this->add_option('e', "echelon", required_argument,
+                     "Write a row echelon form of the matrix, with columns in pivot order, to file ARG.");
+    this->add_option('C', "column-permutation", required_argument,
+                     "Write the column permutation that puts columns in pivot order to file ARG.");
+    this->add_option('B', "binary-permutation", no_argument,
+                     "Write permutation files in binary format.");
+    this->add_option('r', "report", no_argument,
+                     "Print fill-in and the time spent in each phase to standard error.");
+    this->description =
+      "Output the rank of the INPUT matrix modulo a prime P, computed\n"
+      "by sparse Gaussian elimination.  Entry values must be integers;\n"
+      "they are reduced modulo P as they are read.\n"
+      "\n"
+      "At each step, the pivot is chosen among the entries of the rows\n"
+      "with fewest nonzeros so as to minimize the Markowitz cost (i.e.,\n"
+      "fill-in).  When the remaining submatrix gets dense enough, the\n"
+      "elimination is finished with dense row operations.\n"
+      "\n"
+      "Pivots are not taken in column order, so the echelon form\n"
+      "(option `--echelon`) has its columns permuted: first the pivot\n"
+      "columns, in the order pivots were chosen, then the others.  Option\n"
+      "`--column-permutation` writes this permutation.\n"
+      "\n"
+      "The INPUT matrix stream should be in J.-G. Dumas' SMS format;\n"
+      "OUTPUT is a text stream where the rank is written to.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    std::istringstream arg(NULL == argument ? "" : argument);
+    if ('M' == opt) {
+      unsigned long long p = 0;
+      arg >> p;
+      field_ = PrimeField(p);
+    }
+    else if ('d' == opt) {
+      if (not (arg >> threshold_) or threshold_ < 0 or threshold_ > 1)
+        throw std::runtime_error("Argument to '--dense-threshold' must be a number between 0 and 1.");
+    }
+    else if ('s' == opt) {
+      if (not (arg >> search_) or search_ < 1)
+        throw std::runtime_error("Argument to '--search' must be a positive integer.");
+    }
+    else if ('e' == opt)
+      echelon_file_ = argument;
+    else if ('C' == opt)
+      col_perm_file_ = argument;
+    else if ('B' == opt)
+      perm_format_ = BINARY_PERMUTATION;
+    else if ('r' == opt)
+      report_ = true;
+  };
+
+  int run()
+  {
+    PrimeField::set_current(&field_);
+    try {
+      const int exitcode = compute();
+      PrimeField::set_current(NULL);
+      return exitcode;
+    }
+    catch (...) {
+      PrimeField::set_current(NULL);
+      throw;
+    };
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    if (0 == value.value)
+      return;
+    RowEntry e;
+    e.column = j - 1;
+    e.value = value.value;
+    rows_[i-1].push_back(e);
+  };
+
+
+private:
+  PrimeField field_;
+  double threshold_;
+  int search_;
+  bool report_;
+  std::string echelon_file_;
+  std::string col_perm_file_;
+  permutation_format perm_format_;
+
+  /// nonzero entries of each row, sorted by column; indices are 0-based
+  std::vector<sparse_row_t> rows_;
+  /// whether each row is part of the submatrix still to be eliminated
+  std::vector<char> active_;
+  /// step at which each row was last chosen for update
+  std::vector<coord_t> mark_;
+
+  /// number of active rows with an entry in each column
+  std::vector<coord_t> col_count_;
+  /// rows that have (or have had) an entry in each column
+  std::vector< std::vector<coord_t> > col_rows_;
+
+  /// active rows, in doubly-linked lists by number of entries: the
+  /// first row with `n` entries is `head_[n]`, and the next one after
+  /// row `i` is `next_[i]`; `bucket_[i]` is the list row `i` is in
+  std::vector<coord_t> head_;
+  std::vector<coord_t> next_;
+  std::vector<coord_t> prev_;
+  std::vector<std::size_t> bucket_;
+  /// no list before this one has rows in it
+  std::size_t lowest_;
+
+  /// size of the active submatrix
+  coord_t active_rows_;
+  coord_t active_cols_;
+  long long active_nnz_;
+  /// number of entries created by elimination
+  long long fill_;
+
+  /// pivots of the sparse phase, in order
+  std::vector<coord_t> pivot_rows_;
+  std::vector<coord_t> pivot_cols_;
+
+  /// the submatrix finished with dense elimination: original indices
+  /// of its rows and columns, entries by row, and its rank
+  std::vector<coord_t> dense_rows_;
+  std::vector<coord_t> dense_cols_;
+  std::vector<ModularValue> dense_;
+  std::size_t dense_rank_;
+
+  /** State of the elimination after some steps, for the report. */
+  struct Sample
+  {
+    coord_t pivots;
+    coord_t rows;
+    coord_t columns;
+    long long nnz;
+    long long fill;
+    double seconds;
+  };
+  std::vector<Sample> samples_;
+
+
+  int compute()
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SMSReader<val_t>::open(*FilterProgram::input_);
+    const coord_t nrows = SMSReader<val_t>::rows();
+    const coord_t ncols = SMSReader<val_t>::columns();
+    rows_.assign(nrows, sparse_row_t());
+    read();
+    SMSReader<val_t>::close();
+    const double read_time = seconds_since(start);
+
+    std::chrono::steady_clock::time_point phase = std::chrono::steady_clock::now();
+    const long long nnz = prepare(ncols);
+    const double prepare_time = seconds_since(phase);
+
+    phase = std::chrono::steady_clock::now();
+    eliminate_sparse(start);
+    const double sparse_time = seconds_since(phase);
+
+    phase = std::chrono::steady_clock::now();
+    if (active_rows_ > 0)
+      eliminate_dense();
+    const double dense_time = seconds_since(phase);
+    const std::size_t rank = pivot_rows_.size() + dense_rank_;
+
+    phase = std::chrono::steady_clock::now();
+    if (not echelon_file_.empty() or not col_perm_file_.empty()) {
+      const std::vector<coord_t> order = pivot_order(ncols);
+      if (not col_perm_file_.empty()) {
+        std::vector<coord_t> col_perm(ncols);
+        for (coord_t k = 0; k < ncols; ++k)
+          col_perm[k] = order[k] + 1;
+        write_permutation(col_perm_file_, col_perm, perm_format_);
+      };
+      if (not echelon_file_.empty())
+        write_echelon(rank, order);
+    };
+    const double write_time = seconds_since(phase);
+
+    (*output_) << rank << std::endl;
+
+    if (report_) {
+      std::ostream& out = std::cerr;
+      out << name_ << ": rank " << rank << " of " << nrows << "x" << ncols
+          << " matrix with " << nnz << " nonzero entries, modulo " << field_.modulus() << std::endl;
+      out << name_ << ": sparse elimination: " << pivot_rows_.size() << " pivots";
+      if (not dense_rows_.empty())
+        out << "; dense elimination: " << dense_rank_ << " pivots on the remaining "
+            << dense_rows_.size() << "x" << dense_cols_.size() << " submatrix";
+      out << std::endl;
+      out << name_ << ": fill-in:" << std::endl;
+      char line[128];
+      std::snprintf(line, sizeof(line), "%12s %12s %12s %14s %14s %10s",
+                    "pivots", "rows", "columns", "entries", "fill-in", "seconds");
+      out << line << std::endl;
+      for (std::vector<Sample>::const_iterator s = samples_.begin(); s != samples_.end(); ++s) {
+        std::snprintf(line, sizeof(line), "%12ld %12ld %12ld %14lld %14lld %10.3f",
+                      s->pivots, s->rows, s->columns, s->nnz, s->fill, s->seconds);
+        out << line << std::endl;
+      };
+      out << name_ << ": time: read " << std::fixed << std::setprecision(3) << read_time
+          << " s, setup " << prepare_time
+          << " s, sparse elimination " << sparse_time
+          << " s, dense elimination " << dense_time;
+      if (not echelon_file_.empty())
+        out << " s, write echelon form " << write_time;
+      out << " s" << std::endl;
+      out.unsetf(std::ios_base::floatfield);
+    };
+    return 0;
+  };
+
+
+  // ---- sparse elimination ----
+
+  /// Sort rows and sum duplicate entries, then set up column counts
+  /// and row lists; return number of nonzero entries.
+  long long prepare(const coord_t ncols)
+  {
+    const coord_t nrows = rows_.size();
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (coord_t i = 0; i < nrows; ++i) {
+      sparse_row_t& row = rows_[i];
+      std::stable_sort(row.begin(), row.end());
+      std::size_t n = 0;
+      for (std::size_t k = 0; k < row.size(); ++k) {
+        if (n > 0 and row[n-1].column == row[k].column)
+          row[n-1].value = field_.add(row[n-1].value, row[k].value);
+        else
+          row[n++] = row[k];
+        if (n > 0 and 0 == row[n-1].value)
+          --n;
+      };
+      row.resize(n);
+    };
+
+    active_.assign(nrows, 0);
+    mark_.assign(nrows, -1);
+    col_count_.assign(ncols, 0);
+    col_rows_.assign(ncols, std::vector<coord_t>());
+    head_.assign(ncols + 1, -1);
+    next_.assign(nrows, -1);
+    prev_.assign(nrows, -1);
+    bucket_.assign(nrows, 0);
+    lowest_ = ncols + 1;
+    active_rows_ = active_cols_ = 0;
+    active_nnz_ = fill_ = 0;
+    for (coord_t i = 0; i < nrows; ++i) {
+      if (rows_[i].empty())
+        continue;
+      for (sparse_row_t::const_iterator e = rows_[i].begin(); e != rows_[i].end(); ++e) {
+        if (0 == col_count_[e->column]++)
+          ++active_cols_;
+        col_rows_[e->column].push_back(i);
+      };
+      active_[i] = 1;
+      ++active_rows_;
+      active_nnz_ += rows_[i].size();
+      bucket_insert(i);
+    };
+    return active_nnz_;
+  };
+
+  void bucket_insert(const coord_t i)
+  {
+    const std::size_t b = rows_[i].size();
+    bucket_[i] = b;
+    prev_[i] = -1;
+    next_[i] = head_[b];
+    if (next_[i] >= 0)
+      prev_[next_[i]] = i;
+    head_[b] = i;
+    if (b < lowest_)
+      lowest_ = b;
+  };
+
+  void bucket_remove(const coord_t i)
+  {
+    if (prev_[i] >= 0)
+      next_[prev_[i]] = next_[i];
+    else
+      head_[bucket_[i]] = next_[i];
+    if (next_[i] >= 0)
+      prev_[next_[i]] = prev_[i];
+  };
+
+  /// Choose the pivot with least Markowitz cost (r-1)*(c-1), where r
+  /// and c are the number of entries in its row and column, among the
+  /// first `search_` rows with fewest entries.
+  void choose_pivot(coord_t& pi, coord_t& pj)
+  {
+    while (head_[lowest_] < 0)
+      ++lowest_;
+    long long best = -1;
+    int examined = 0;
+    for (std::size_t b = lowest_; b < head_.size() and examined < search_; ++b) {
+      for (coord_t i = head_[b]; i >= 0 and examined < search_; i = next_[i]) {
+        ++examined;
+        coord_t j = -1;
+        coord_t c = 0;
+        for (sparse_row_t::const_iterator e = rows_[i].begin(); e != rows_[i].end(); ++e)
+          if (j < 0 or col_count_[e->column] < c) {
+            j = e->column;
+            c = col_count_[j];
+          };
+        const long long cost = static_cast<long long>(b - 1) * (c - 1);
+        if (best < 0 or cost < best) {
+          best = cost;
+          pi = i;
+          pj = j;
+          if (0 == best)
+            return;
+        };
+      };
+    };
+  };
+
+  /// Remove row `i` from the active submatrix.
+  void deactivate(const coord_t i)
+  {
+    bucket_remove(i);
+    active_[i] = 0;
+    --active_rows_;
+  };
+
+  void add_sample(const std::chrono::steady_clock::time_point& start)
+  {
+    Sample s;
+    s.pivots = pivot_rows_.size();
+    s.rows = active_rows_;
+    s.columns = active_cols_;
+    s.nnz = active_nnz_;
+    s.fill = fill_;
+    s.seconds = seconds_since(start);
+    samples_.push_back(s);
+  };
+
+  /// Eliminate pivots one by one, until the active submatrix is empty
+  /// or dense enough.
+  void eliminate_sparse(const std::chrono::steady_clock::time_point& start)
+  {
+    const coord_t every = std::max<coord_t>(1, std::min(active_rows_, active_cols_) / 20);
+    std::vector<coord_t> targets;
+    std::vector< std::vector<coord_t> > added, removed;
+    add_sample(start);
+    while (active_rows_ > 0) {
+      const double size = static_cast<double>(active_rows_) * active_cols_;
+      if (threshold_ < 1 and active_nnz_ >= threshold_ * size and size <= (1 << 27))
+        break;
+
+      coord_t pi = -1, pj = -1;
+      choose_pivot(pi, pj);
+      const coord_t step = pivot_rows_.size();
+      pivot_rows_.push_back(pi);
+      pivot_cols_.push_back(pj);
+
+      // the pivot row leaves the active submatrix
+      deactivate(pi);
+      const sparse_row_t& pivot = rows_[pi];
+      for (sparse_row_t::const_iterator e = pivot.begin(); e != pivot.end(); ++e)
+        if (0 == --col_count_[e->column])
+          --active_cols_;
+      active_nnz_ -= pivot.size();
+
+      // rows with an entry in the pivot column
+      targets.clear();
+      for (std::vector<coord_t>::const_iterator k = col_rows_[pj].begin(); k != col_rows_[pj].end(); ++k)
+        if (active_[*k] and mark_[*k] != step and find_column(rows_[*k], pj) >= 0) {
+          mark_[*k] = step;
+          targets.push_back(*k);
+        };
+      std::vector<coord_t>().swap(col_rows_[pj]);
+
+      // subtract a multiple of the pivot row from each of them; rows
+      // are independent, so this can be done in parallel
+      const uint32_t inverse = field_.inverse(pivot[find_column(pivot, pj)].value);
+      const long ntargets = targets.size();
+      if (added.size() < targets.size()) {
+        added.resize(targets.size());
+        removed.resize(targets.size());
+      };
+#pragma omp parallel if (ntargets * static_cast<long>(pivot.size()) > 65536)
+      {
+        sparse_row_t result;
+#pragma omp for schedule(dynamic, 4)
+        for (long n = 0; n < ntargets; ++n) {
+          sparse_row_t& row = rows_[targets[n]];
+          const uint32_t a = row[find_column(row, pj)].value;
+          const uint32_t f = field_.negate(field_.multiply(a, inverse));
+          update_row(row, pivot, f, field_.shoup(f), field_, result, added[n], removed[n]);
+          row.swap(result);
+        };
+      };
+
+      for (long n = 0; n < ntargets; ++n) {
+        const coord_t k = targets[n];
+        for (std::vector<coord_t>::const_iterator c = added[n].begin(); c != added[n].end(); ++c) {
+          if (0 == col_count_[*c]++)
+            ++active_cols_;
+          col_rows_[*c].push_back(k);
+        };
+        // this includes the entry in the pivot column
+        for (std::vector<coord_t>::const_iterator c = removed[n].begin(); c != removed[n].end(); ++c)
+          if (0 == --col_count_[*c])
+            --active_cols_;
+        fill_ += added[n].size();
+        active_nnz_ += static_cast<long long>(added[n].size()) - removed[n].size();
+        bucket_remove(k);
+        if (rows_[k].empty()) {
+          active_[k] = 0;
+          --active_rows_;
+        }
+        else
+          bucket_insert(k);
+      };
+
+      if (echelon_file_.empty())
+        sparse_row_t().swap(rows_[pi]);
+      if (0 == pivot_rows_.size() % every)
+        add_sample(start);
+    };
+    if (samples_.back().pivots != static_cast<coord_t>(pivot_rows_.size()))
+      add_sample(start);
+  };
+
+
+  // ---- dense elimination ----
+
+  /// Copy the active submatrix into `dense_`, and put it in row
+  /// echelon form, with pivots equal to 1.  Columns are processed in
+  /// panels: pivots are first found and eliminated within a panel,
+  /// and the updates they make to the rest of each row are applied
+  /// at the end, all at once, while the row is in cache.
+  void eliminate_dense()
+  {
+    const coord_t ncols = col_count_.size();
+    std::vector<coord_t> position(ncols, -1);
+    for (coord_t j = 0; j < ncols; ++j)
+      if (col_count_[j] > 0) {
+        position[j] = dense_cols_.size();
+        dense_cols_.push_back(j);
+      };
+    for (coord_t i = 0; i < static_cast<coord_t>(rows_.size()); ++i)
+      if (active_[i])
+        dense_rows_.push_back(i);
+    const std::size_t m = dense_rows_.size();
+    const std::size_t n = dense_cols_.size();
+    dense_.assign(m * n, ModularValue());
+    for (std::size_t q = 0; q < m; ++q) {
+      sparse_row_t& row = rows_[dense_rows_[q]];
+      for (sparse_row_t::const_iterator e = row.begin(); e != row.end(); ++e)
+        dense_[q*n + position[e->column]].value = e->value;
+      sparse_row_t().swap(row);
+    };
+    TraceSpan span("dense elimination");
+
+    const std::size_t width = 32;
+    // `factor[q*width + k]` is the multiple of the `k`-th pivot row of
+    // the panel to add to row `q`
+    std::vector<ModularValue> factor(m * width);
+    std::vector<const ModularValue*> panel(width);
+    std::size_t r = 0;
+    for (std::size_t c0 = 0; c0 < n and r < m; c0 += width) {
+      const std::size_t c1 = std::min(c0 + width, n);
+      std::fill(factor.begin(), factor.end(), ModularValue());
+      // rows r to r0+npivots-1 are the pivot rows of this panel
+      const std::size_t r0 = r;
+      for (std::size_t c = c0; c < c1 and r < m; ++c) {
+        std::size_t q = r;
+        while (q < m and 0 == dense_[q*n + c].value)
+          ++q;
+        if (q == m)
+          continue;
+        if (q != r) {
+          std::swap_ranges(&dense_[q*n], &dense_[q*n] + n, &dense_[r*n]);
+          std::swap_ranges(&factor[q*width], &factor[q*width] + width, &factor[r*width]);
+        };
+        ModularValue* const pivot = &dense_[r*n];
+        // catch up with the updates from earlier pivots of the panel
+        if (r > r0)
+          field_.axpy_many(pivot + c1, &factor[r*width], &panel[0], r - r0, n - c1);
+        ModularValue s;
+        s.value = field_.inverse(pivot[c].value);
+        field_.scale(pivot + c, n - c, s);
+        // eliminate column `c` within the panel, and remember the
+        // multiples for the rest of each row
+        const long lo = r + 1;
+#pragma omp parallel for schedule(static) if (m - lo > 4096)
+        for (long q = lo; q < static_cast<long>(m); ++q) {
+          ModularValue f;
+          f.value = field_.negate(dense_[q*n + c].value);
+          if (0 == f.value)
+            continue;
+          field_.axpy(&dense_[q*n + c], f, pivot + c, c1 - c);
+          factor[q*width + (r - r0)] = f;
+        };
+        panel[r - r0] = pivot + c1;
+        ++r;
+      };
+
+      // apply the panel updates to the rest of the rows; `axpy_many`
+      // sums all the pivot rows' contributions before reducing
+      const std::size_t npivots = r - r0;
+      if (0 == npivots or c1 == n)
+        continue;
+#pragma omp parallel for schedule(dynamic, 16)
+      for (long q = r; q < static_cast<long>(m); ++q)
+        field_.axpy_many(&dense_[q*n + c1], &factor[q*width], &panel[0], npivots, n - c1);
+    };
+    dense_rank_ = r;
+  };
+
+
+  // ---- output ----
+
+  /// Return the columns (0-based) in pivot order: the pivot columns
+  /// of the sparse phase, in the order they were chosen, then those
+  /// of the dense submatrix, in the order of its elimination, then
+  /// all other columns.  In this order, the pivot rows are in row
+  /// echelon form.
+  std::vector<coord_t> pivot_order(const coord_t ncols) const
+  {
+    std::vector<coord_t> order;
+    order.reserve(ncols);
+    std::vector<char> placed(ncols, 0);
+    for (std::size_t k = 0; k < pivot_cols_.size(); ++k) {
+      order.push_back(pivot_cols_[k]);
+      placed[pivot_cols_[k]] = 1;
+    };
+    for (std::size_t c = 0; c < dense_cols_.size(); ++c) {
+      order.push_back(dense_cols_[c]);
+      placed[dense_cols_[c]] = 1;
+    };
+    for (coord_t j = 0; j < ncols; ++j)
+      if (not placed[j])
+        order.push_back(j);
+    return order;
+  };
+
+  /// Write the pivot rows, in order, to the echelon file, with columns
+  /// renumbered according to `order` (see @ref pivot_order); each row
+  /// is scaled so that its pivot is 1.
+  void write_echelon(const std::size_t rank, const std::vector<coord_t>& order)
+  {
+    const coord_t ncols = order.size();
+    std::vector<coord_t> new_col(ncols);
+    for (coord_t k = 0; k < ncols; ++k)
+      new_col[order[k]] = k;
+    SMSWriter<val_t> writer;
+    writer.open(echelon_file_, rank, ncols);
+    coord_t i = 0;
+    sparse_row_t permuted;
+    for (std::size_t k = 0; k < pivot_rows_.size(); ++k) {
+      const sparse_row_t& row = rows_[pivot_rows_[k]];
+      const uint32_t s = field_.inverse(row[find_column(row, pivot_cols_[k])].value);
+      permuted.clear();
+      for (sparse_row_t::const_iterator e = row.begin(); e != row.end(); ++e) {
+        RowEntry p;
+        p.column = new_col[e->column];
+        p.value = field_.multiply(e->value, s);
+        permuted.push_back(p);
+      };
+      std::sort(permuted.begin(), permuted.end());
+      ++i;
+      for (sparse_row_t::const_iterator e = permuted.begin(); e != permuted.end(); ++e) {
+        ModularValue v;
+        v.value = e->value;
+        writer.write_entry(i, e->column + 1, v);
+      };
+    };
+    // dense columns come in order after the sparse pivot columns
+    const std::size_t n = dense_cols_.size();
+    for (std::size_t q = 0; q < dense_rank_; ++q) {
+      ++i;
+      for (std::size_t c = 0; c < n; ++c)
+        if (0 != dense_[q*n + c].value)
+          writer.write_entry(i, pivot_cols_.size() + c + 1, dense_[q*n + c]);
+    };
+    writer.close();
+  };
+};
+
+
+SMASTO_MAIN("rank", RankProgram)
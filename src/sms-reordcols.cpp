@@ -29,6 +29,7 @@
 
 #include "common.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
@@ -40,33 +41,47 @@
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
-
 
+template< typename val_t >
 class ReordColsProgram : public FilterProgram, 
                          public SMSReader<val_t>,
                          public SMSWriter<val_t>
 {
 public:
   ReordColsProgram() 
-    : m(), r(), c(), new_col()
+    : m(), r(), c(), new_col(),
+      row_perm_file_(), col_perm_file_(), perm_format_(TEXT_PERMUTATION)
   {
+    this->add_option('B', "binary-permutation", no_argument,
+                     "Write permutation files in binary format.");
+    this->add_option('C', "column-permutation", required_argument,
+                     "Write the column permutation to file ARG.");
+    this->add_option('R', "row-permutation", required_argument,
+                     "Write the row permutation to file ARG.");
     this->description = 
       "Permute columns of the input matrix, so that its block echelon\n"
       "form has the taller blocks towards the rightmost edge.\n"
+      "Columns are sorted by increasing number of nonzero entries;\n"
+      "columns with the same number of nonzeroes keep their relative order.\n"
+      "\n"
+      "Options `--row-permutation` and `--column-permutation` save the\n"
+      "computed permutations to a file, for use with `sms-permute`.\n"
       ;
   };
 
   void process_option(const int opt, const char* argument)
   {
-    // no options to process
+    if ('B' == opt)
+      perm_format_ = BINARY_PERMUTATION;
+    else if ('C' == opt)
+      col_perm_file_ = argument;
+    else if ('R' == opt)
+      row_perm_file_ = argument;
   };
 
+  /** Entry values are only copied, so integer values are fine. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() { 
     SMSReader<val_t>::open(*FilterProgram::input_);
     const coord_t nrows = SMSReader<val_t>::rows();
@@ -76,16 +91,33 @@ public:
     r.resize(nrows+1, 0); 
     c.resize(ncols+1, 0);
 
-    // read matrix entries and initialize r, c, new_col
-    read();
+    // read matrix entries and initialize r, c
+    SMSReader<val_t>::read();
     SMSReader<val_t>::close();
 
-  
+    // sort columns by increasing nonzero count; `order[k]` is the
+    // old index of the column that is moved to position `k+1`
+    std::vector<coord_t> order(ncols);
+    for (coord_t j = 0; j < ncols; ++j)
+      order[j] = j+1;
+    std::stable_sort(order.begin(), order.end(), count_less(c));
+    invert_permutation(order, new_col);
+
+    if (not col_perm_file_.empty())
+      write_permutation(col_perm_file_, order, perm_format_);
+    if (not row_perm_file_.empty()) {
+      // rows are not moved
+      std::vector<coord_t> identity(nrows);
+      for (coord_t i = 0; i < nrows; ++i)
+        identity[i] = i+1;
+      write_permutation(row_perm_file_, identity, perm_format_);
+    };
+
     // output matrix
     SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
-    for(matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
-      for(row_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
-        write_entry(r->first, new_col[c->first], c->second);
+    for(typename matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
+      for(typename row_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
+        SMSWriter<val_t>::write_entry(r->first, new_col[c->first], c->second);
     SMSWriter<val_t>::close();
 
     return 0; 
@@ -117,11 +149,19 @@ private:
   std::vector<coord_t> c;
 
   /// map old column index to new one
-  std::map< coord_t,coord_t > new_col;
-};
+  std::vector<coord_t> new_col;
 
+  std::string row_perm_file_;
+  std::string col_perm_file_;
+  permutation_format perm_format_;
 
-int main(int argc, char** argv)
-{
-  return ReordColsProgram().main(argc, argv);
+  /// compare column indices by their nonzero count
+  struct count_less {
+    count_less(const std::vector<coord_t>& counts) : c(counts) { };
+    bool operator()(const coord_t a, const coord_t b) const { return c[a] < c[b]; };
+    const std::vector<coord_t>& c;
+  };
 };
+
+
+SMASTO_TYPED_MAIN("reordcols", ReordColsProgram)
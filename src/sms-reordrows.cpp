@@ -40,14 +40,8 @@
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
-
 
+template< typename val_t >
 class ReordRowsProgram : public FilterProgram, 
                          public SMSReader<val_t>,
                          public SMSWriter<val_t>
@@ -55,8 +49,15 @@ class ReordRowsProgram : public FilterProgram,
 public:
   ReordRowsProgram() 
     : m(), r(), c(),
-      a_(4.5), b_(2.0), c_(1.0), d_(2.0), e_(0.5)
+      a_(4.5), b_(2.0), c_(1.0), d_(2.0), e_(0.5),
+      row_perm_file_(), col_perm_file_(), perm_format_(TEXT_PERMUTATION)
   {
+    this->add_option('B', "binary-permutation", no_argument,
+                     "Write permutation files in binary format.");
+    this->add_option('C', "column-permutation", required_argument,
+                     "Write the column permutation to file ARG.");
+    this->add_option('R', "row-permutation", required_argument,
+                     "Write the row permutation to file ARG.");
     std::ostringstream a_msg; a_msg << "Assign weight ARG (default: " << a_<< ") to criterion a.";
     this->add_option('a', "weight-a", required_argument, a_msg.str());
     std::ostringstream b_msg; b_msg << "Assign weight ARG (default: " << b_<< ") to criterion b.";
@@ -81,6 +82,9 @@ public:
       "minimize criteria a., b., c., d., and maximize criterion e.\n"
       "The relative weight of each criterion can be changed with options '-a', -b',\n"
       "'-c', '-d', '-e', each of which takes a single floating-point argument.\n"
+      "\n"
+      "Options `--row-permutation` and `--column-permutation` save the\n"
+      "computed permutations to a file, for use with `sms-permute`.\n"
       ;
   };
 
@@ -96,8 +100,17 @@ public:
       std::istringstream(argument) >> d_;
     else if ('e' == opt)
       std::istringstream(argument) >> e_;
+    else if ('B' == opt)
+      perm_format_ = BINARY_PERMUTATION;
+    else if ('C' == opt)
+      col_perm_file_ = argument;
+    else if ('R' == opt)
+      row_perm_file_ = argument;
   };
 
+  /** Entry values are only copied, so integer values are fine. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() { 
     // normalize weights
     double t = std::abs(a_) + std::abs(b_) + std::abs(c_) + std::abs(d_) + std::abs(e_);
@@ -116,12 +129,21 @@ public:
     c.resize(ncols+1, 0);
 
     // read and process matrix entries
-    read();
+    SMSReader<val_t>::read();
     SMSReader<val_t>::close();
 
     // f[j] is `true` iff a non-zero has been already seen in column j
     std::vector<bool> f(ncols+1, false); 
 
+    // `row_perm[i]` (resp. `col_perm[j]`) is the old index of the row
+    // (resp. column) currently at position `i` (resp. `j`)
+    std::vector<coord_t> row_perm(nrows+1);
+    for (coord_t i = 0; i <= nrows; ++i)
+      row_perm[i] = i;
+    std::vector<coord_t> col_perm(ncols+1);
+    for (coord_t j = 0; j <= ncols; ++j)
+      col_perm[j] = j;
+
     coord_t max_r = 0;
     for (coord_t i = 1; i <= nrows; ++i)
       if(r[i] > max_r)
@@ -145,7 +167,7 @@ public:
         // pivot column `j` is the one having minimal number of nozeroes
         coord_t j = -1;
         coord_t cj = nrows;
-        for (row_t::const_iterator jj = m[ii].begin(); jj != m[ii].end(); ++jj) {
+        for (typename row_t::const_iterator jj = m[ii].begin(); jj != m[ii].end(); ++jj) {
           if (jj->first < ii)
             continue;
           if ((c[jj->first] < cj)
@@ -162,7 +184,7 @@ public:
         coord_t c2 = 0;
         coord_t c3 = 0;
         coord_t l = ncols;
-        for (row_t::const_iterator jj = m[ii].begin(); jj != m[ii].end(); ++jj) {
+        for (typename row_t::const_iterator jj = m[ii].begin(); jj != m[ii].end(); ++jj) {
           // 1. count nonzero entries in columns < `i`
           if (jj->first < i)
             ++c1;
@@ -200,8 +222,10 @@ public:
       assert(r[chosen_i] == m[chosen_i].size());
       std::swap(m[chosen_i], m[i]);
       std::swap(r[chosen_i], r[i]);
+      std::swap(row_perm[chosen_i], row_perm[i]);
       if (-1 != chosen_j) {
         std::swap(c[chosen_j], c[i]);
+        std::swap(col_perm[chosen_j], col_perm[i]);
         for (coord_t ii = 1; ii <= nrows; ++ii) {
           bool has_i = m[ii].count(i);
           bool has_chosen_j = m[ii].count(chosen_j);
@@ -220,15 +244,24 @@ public:
         };
       };
       // update nonzero mask
-      for (row_t::const_iterator j = m[i].begin(); j != m[i].end(); ++j)
+      for (typename row_t::const_iterator j = m[i].begin(); j != m[i].end(); ++j)
         f[j->first] = true;
     };
+
+    if (not row_perm_file_.empty())
+      write_permutation(row_perm_file_,
+                        std::vector<coord_t>(row_perm.begin() + 1, row_perm.end()),
+                        perm_format_);
+    if (not col_perm_file_.empty())
+      write_permutation(col_perm_file_,
+                        std::vector<coord_t>(col_perm.begin() + 1, col_perm.end()),
+                        perm_format_);
   
     // output matrix
     SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
-    for(matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
-      for(row_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
-        write_entry(r->first, c->first, c->second);
+    for(typename matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
+      for(typename row_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
+        SMSWriter<val_t>::write_entry(r->first, c->first, c->second);
     SMSWriter<val_t>::close();
 
     return 0; 
@@ -256,10 +289,11 @@ private:
 
   /// number of elements on column `j`(old value)
   std::vector<coord_t> c;
+
+  std::string row_perm_file_;
+  std::string col_perm_file_;
+  permutation_format perm_format_;
 };
 
 
-int main(int argc, char** argv)
-{
-  return ReordRowsProgram().main(argc, argv);
-};
+SMASTO_TYPED_MAIN("reordrows", ReordRowsProgram)
@@ -31,27 +31,41 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
+
+/// Replace each of the `values` with `value * multiply / divide`.
+template< typename val_t >
+static void
+scale_values(std::vector<val_t>& values, const val_t& multiply, const val_t& divide)
+{
+  for (std::size_t k = 0; k < values.size(); ++k)
+    values[k] = checked_multiply(values[k], multiply) / divide;
+};
+
+static void
+scale_values(std::vector<ModularValue>& values,
+             const ModularValue& multiply, const ModularValue& divide)
+{
+  if (not values.empty())
+    PrimeField::current()->scale(&values[0], values.size(), multiply / divide);
+};
 
 
+template< typename val_t >
 class RescaleProgram : public FilterProgram, 
                        public SMSReader<val_t>, 
                        public SMSWriter<val_t>
 {
 public:
   RescaleProgram() 
-    : multiply_(1), divide_(1)
+    : multiply_(1), divide_(1), rows_(), columns_(), values_()
   {
     this->add_option('m', "multiply", required_argument, "Multiply each entry by ARG.");
     this->add_option('r', "divide",   required_argument, "Divide each entry by ARG.");
@@ -59,6 +73,9 @@ public:
       "Output a copy of the matrix given in the INPUT stream,\n"
       "optionally multiplying each entry by a constant factor.\n"
       "\n"
+      "With option '--modulus', entries are integers modulo a prime,\n"
+      "and so are the factors; dividing multiplies by the inverse.\n"
+      "\n"
       "Both the INPUT and the OUTPUT matrix streams are in J.-G.\n" 
       "Dumas' SMS format.\n"
       ;
@@ -66,17 +83,40 @@ public:
 
   void process_option(const int opt, const char* argument)
   {
+    long double factor = 1;
+    std::istringstream(argument) >> factor;
+    // with integer values, only multiplication by an integer is exact
+    if (std::numeric_limits<val_t>::is_integer
+        and (factor != std::floor(factor) or ('r' == opt and 1 != factor)))
+      throw std::runtime_error("Scaling factor is not an integer;"
+                               " use '--value-type=double' to rescale integer matrices.");
+    if (std::numeric_limits<val_t>::is_integer
+        and std::abs(factor) >= std::numeric_limits<int64_t>::max())
+      throw_integer_overflow();
     if ('m' == opt)
-      std::istringstream(argument) >> multiply_;
-    else if ('r' == opt)
-      std::istringstream(argument) >> divide_;
+      multiply_ = static_cast<val_t>(factor);
+    else if ('r' == opt) {
+      divide_ = static_cast<val_t>(factor);
+      // a factor that is a multiple of the modulus is zero, too
+      if (is_zero(divide_))
+        throw std::runtime_error("Argument to option '--divide' must not be zero.");
+    };
+  };
+
+  /** Return @c true if results are exact with integer values, whose
+      absolute value is at most @c largest. */
+  bool integer_values_ok(const long double largest) const
+  {
+    return (multiply_ == std::floor(multiply_) and 1 == divide_
+            and largest * std::abs(multiply_) < std::numeric_limits<int64_t>::max());
   };
 
   int run() { 
     SMSReader<val_t>::open(*FilterProgram::input_);
     SMSWriter<val_t>::open(*FilterProgram::output_, 
                            SMSReader<val_t>::rows(), SMSReader<val_t>::columns());
-    read();
+    SMSReader<val_t>::read();
+    flush();
     SMSWriter<val_t>::close();
     SMSReader<val_t>::close();
     return 0; 
@@ -84,17 +124,37 @@ public:
 
   void process_entry(const coord_t i, const coord_t j, const val_t& value)
   {
-    write_entry(i, j, value * multiply_ / divide_);
+    rows_.push_back(i);
+    columns_.push_back(j);
+    values_.push_back(value);
+    if (values_.size() >= 4096)
+      flush();
   };
 
 
 private:
   val_t multiply_;
   val_t divide_;
-};
 
+  /// entries not yet rescaled; values are rescaled a batch at a
+  /// time, which lets the compiler vectorize the loop
+  std::vector<coord_t> rows_;
+  std::vector<coord_t> columns_;
+  std::vector<val_t> values_;
 
-int main(int argc, char** argv)
-{
-  return RescaleProgram().main(argc, argv);
+  /// Rescale and write out the entries read so far; entries that
+  /// become zero (e.g., modulo p) are dropped.
+  void flush()
+  {
+    scale_values(values_, multiply_, divide_);
+    for (std::size_t k = 0; k < values_.size(); ++k)
+      if (not is_zero(values_[k]))
+        SMSWriter<val_t>::write_entry(rows_[k], columns_[k], values_[k]);
+    rows_.clear();
+    columns_.clear();
+    values_.clear();
+  };
 };
+
+
+SMASTO_TYPED_MAIN("rescale", RescaleProgram)
@@ -28,38 +28,36 @@
 
 #include "common.hpp"
 
-#include <cmath>
-#include <cstdlib>
 #include <iostream>
-#include <map>
-#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
 typedef long coord_t;
 
-// always select the widest floating-point type available
-# ifdef HAVE_LONG_DOUBLE
-typedef long double val_t;
-# else
-typedef double val_t;
-# endif 
-
 
+template< typename val_t >
 class ShrinkProgram : public FilterProgram, 
                          public SMSReader<val_t>,
                          public SMSWriter<val_t>
 {
 public:
   ShrinkProgram() 
-    : seen_row_(), seen_col_(),
-      m()
+    : seen_row_(), seen_col_(), pass_(1), buffer_(false),
+      entries_()
   {
     this->description = 
       "Copy INPUT matrix to OUTPUT, removing rows and columns consisting\n"
       "entirely of zeroes.  Rows and columns are renumbered to preserve the\n"
       "relative order in which they appear in the INPUT matrix.\n"
+      "\n"
+      "If INPUT is a regular file, it is read twice: the first pass\n"
+      "records which rows and columns are nonempty, the second one streams\n"
+      "renumbered entries to OUTPUT, so that memory usage does not depend\n"
+      "on the number of nonzero entries.  If INPUT is a pipe, all entries\n"
+      "are kept in memory until the end of the stream.\n"
       ;
   };
 
@@ -68,37 +66,56 @@ public:
     // no options
   };
 
+  /** Entry values are only copied, so integer values are fine. */
+  bool integer_values_ok(const long double) const { return true; };
+
   int run() { 
-    SMSReader<val_t>::open(*FilterProgram::input_);
+    std::istream& input = *FilterProgram::input_;
+    // `tellg()` fails on non-seekable streams like pipes and terminals
+    const std::streampos start = input.tellg();
+    buffer_ = (std::streampos(-1) == start);
+
+    SMSReader<val_t>::open(input);
     const coord_t nrows = SMSReader<val_t>::rows();
     const coord_t ncols = SMSReader<val_t>::columns();
+    seen_row_.reset(nrows);
+    seen_col_.reset(ncols);
+    if (buffer_)
+      entries_.reset(nrows, ncols);
+
+    // first pass: find nonempty rows and columns
+    pass_ = 1;
+    SMSReader<val_t>::read();
+
+    // new row (resp. column) number is the count of nonempty rows
+    // (resp. columns) up to and including the old one
+    seen_row_.build_rank();
+    seen_col_.build_rank();
+
+    if (not buffer_) {
+      // second pass: rewind and stream renumbered entries to OUTPUT
+      input.clear();
+      input.seekg(start);
+      if (input.fail())
+        throw std::runtime_error("Cannot rewind INPUT stream for the second pass.");
+      SMSReader<val_t>::open(input);
+      SMSWriter<val_t>::open(*FilterProgram::output_,
+                             seen_row_.count(), seen_col_.count());
+      pass_ = 2;
+      SMSReader<val_t>::read();
+      SMSReader<val_t>::close();
+      SMSWriter<val_t>::close();
+      return 0;
+    };
 
-    // read and process input matrix entries
-    read();
     SMSReader<val_t>::close();
 
-    // renumber rows and columns
-    coord_t skipped_rows = 0;
-    std::map<size_t, size_t> new_row_number;
-    for (coord_t i = 1; i <= nrows; ++i)
-      if (seen_row_[i])
-        new_row_number[i] = i - skipped_rows;
-      else // seen_row_[i] == false
-        skipped_rows++;
-    
-    std::map<size_t, size_t> new_col_number;
-    size_t skipped_cols = 0;
-    for (coord_t j = 0; j <= ncols; ++j)
-      if (seen_col_[j])
-        new_col_number[j] = j - skipped_cols;
-      else // seen_col_[j] == false
-        skipped_cols++;
-
-    // output
-    SMSWriter<val_t>::open(*FilterProgram::output_, nrows, ncols);
-    for(matrix_t::const_iterator r = m.begin(); r != m.end(); ++r)
-      for(vector_t::const_iterator c = r->second.begin(); c != r->second.end(); ++c)
-        write_entry(new_row_number[r->first], new_col_number[c->first], c->second);
+    // output buffered entries
+    SMSWriter<val_t>::open(*FilterProgram::output_,
+                           seen_row_.count(), seen_col_.count());
+    for (std::size_t n = 0; n < entries_.size(); ++n)
+      SMSWriter<val_t>::write_entry(seen_row_.rank(entries_.row(n)), seen_col_.rank(entries_.column(n)),
+                  entries_.value(n));
     SMSWriter<val_t>::close();
 
     return 0; 
@@ -106,35 +123,30 @@ public:
 
   void process_entry(const coord_t i, const coord_t j, const val_t& value)
   {
-    // if row i and col j are in the pre-selected set, copy triple
-    // remapping row and col index
-    seen_row_[i] = true;
-    seen_col_[j] = true;
-    m[i][j] = value;
+    if (2 == pass_) {
+      SMSWriter<val_t>::write_entry(seen_row_.rank(i), seen_col_.rank(j), value);
+      return;
+    };
+
+    seen_row_.set(i);
+    seen_col_.set(j);
+    if (buffer_)
+      entries_.push_back(i, j, value);
   };
 
 
 private:
-  std::vector< bool > seen_row_;
-  std::vector< bool > seen_col_;
-  
-  typedef std::map< coord_t, val_t > vector_t;
-  typedef std::map< coord_t, vector_t > matrix_t;
-  matrix_t m;
-
-  // just in case rand() does not provide enough random bits
-  coord_t rand_coord()
-  {
-#if RAND_MAX < 2147483647 /* 2^31 */
-    return (rand() ^ (rand() << 16));
-#else
-    return rand();
-#endif
-  };
-};
+  /// rows and columns that have at least one entry
+  IndexBitmap seen_row_;
+  IndexBitmap seen_col_;
 
+  /// 1 while scanning for nonempty rows/columns, 2 while copying
+  int pass_;
 
-int main(int argc, char** argv)
-{
-  return ShrinkProgram().main(argc, argv);
+  /// if `true`, INPUT cannot be rewound and entries are kept in memory
+  bool buffer_;
+  EntryList<val_t> entries_;
 };
+
+
+SMASTO_TYPED_MAIN("shrink", ShrinkProgram)
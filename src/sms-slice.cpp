@@ -0,0 +1,481 @@
+/**
+ * @file   sms-slice.cpp
+ *
+ * Extract the submatrix formed by a range or list of rows and
+ * columns, optionally seeking to the selected rows by means of an
+ * offset index.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// slicing does not care about the type of the entries
+typedef std::string val_t;
+
+
+/** A set of row (or column) indices: either a range, or an arbitrary
+    list held in a bitmap.  Selected indices are renumbered from 1,
+    preserving their relative order. */
+class Selection
+{
+public:
+  Selection(const std::string& what)
+    : what_(what), range_(":"), list_(), first_(1), last_(0), count_(0), bitmap_()
+  { };
+
+  /** Select the indices in range @c spec, given as `A:B`; either
+      bound can be omitted. */
+  void set_range(const std::string& spec) { range_ = spec; list_.clear(); };
+  /** Select the indices listed in file @c filename, one per line. */
+  void set_list(const std::string& filename) { list_ = filename; };
+
+  /** Compute the selected set, for indices ranging from 1 to @c n. */
+  void resolve(const coord_t n)
+  {
+    if (list_.empty())
+      parse_range(n);
+    else
+      read_list(n);
+  };
+
+  /** Return @c true if index @c i is selected. */
+  bool contains(const coord_t i) const
+  {
+    if (i < first_ or i > last_)
+      return false;
+    return list_.empty() or bitmap_.test(i);
+  };
+
+  /** Return the new index of selected index @c i. */
+  coord_t renumber(const coord_t i) const
+  {
+    return (list_.empty()? i - first_ + 1 : bitmap_.rank(i));
+  };
+
+  /** Return the number of selected indices. */
+  coord_t count() const { return count_; };
+  /** Return the smallest selected index. */
+  coord_t first() const { return first_; };
+  /** Return the largest selected index. */
+  coord_t last() const { return last_; };
+
+private:
+  std::string what_;
+  std::string range_;
+  std::string list_;
+  coord_t first_;
+  coord_t last_;
+  coord_t count_;
+  IndexBitmap bitmap_;
+
+  void parse_range(const coord_t n)
+  {
+    const std::string::size_type colon = range_.find(':');
+    std::string from = range_.substr(0, colon);
+    std::string to = (std::string::npos == colon? from : range_.substr(colon + 1));
+    first_ = 1;
+    last_ = n;
+    bool ok = parse_bound(from, first_) and parse_bound(to, last_);
+    if (not ok or first_ < 1 or last_ > n or first_ > last_) {
+      std::ostringstream msg;
+      msg << "Invalid " << what_ << " range '" << range_ << "':"
+          << " expected A:B with 1 <= A <= B <= " << n << ".";
+      throw std::runtime_error(msg.str());
+    };
+    count_ = last_ - first_ + 1;
+  };
+
+  static bool parse_bound(const std::string& text, coord_t& bound)
+  {
+    if (text.empty())
+      return true;
+    std::istringstream in(text);
+    return (in >> bound) and (in >> std::ws).eof();
+  };
+
+  void read_list(const coord_t n)
+  {
+    errno = 0;
+    std::ifstream in(list_.c_str());
+    if (not in.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open " << what_ << " list file '" << list_ << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    bitmap_.reset(n);
+    first_ = n + 1;
+    last_ = 0;
+    coord_t i;
+    while (in >> i) {
+      if (i < 1 or i > n) {
+        std::ostringstream msg;
+        msg << "Index " << i << " in " << what_ << " list file '" << list_ << "'"
+            << " is out of range 1 to " << n << ".";
+        throw std::runtime_error(msg.str());
+      };
+      bitmap_.set(i);
+      first_ = std::min(first_, i);
+      last_ = std::max(last_, i);
+    };
+    if (not in.eof()) {
+      std::ostringstream msg;
+      msg << "Malformed " << what_ << " list file '" << list_ << "'";
+      throw std::runtime_error(msg.str());
+    };
+    bitmap_.build_rank();
+    count_ = bitmap_.count();
+  };
+};
+
+
+class SliceProgram : public FilterProgram,
+                     public SMSReader<val_t>,
+                     public SMSWriter<val_t>
+{
+public:
+  SliceProgram()
+    : rows_("row"), cols_("column"), index_(), build_index_(), sorted_(false)
+  {
+    this->add_option('B', "build-index", required_argument,
+                     "Write an offset index of INPUT to file ARG, and exit.");
+    this->add_option('x', "index", required_argument,
+                     "Seek to the selected rows using the offset index in file ARG.");
+    this->add_option('C', "column-list", required_argument,
+                     "Select the columns listed in file ARG.");
+    this->add_option('c', "columns", required_argument,
+                     "Select columns A to B, given as A:B (default: all).");
+    this->add_option('R', "row-list", required_argument,
+                     "Select the rows listed in file ARG.");
+    this->add_option('r', "rows", required_argument,
+                     "Select rows A to B, given as A:B (default: all).");
+    this->description =
+      "Copy to OUTPUT the submatrix of INPUT formed by the selected rows\n"
+      "and columns.  A range A:B selects indices A to B, both included;\n"
+      "either bound can be omitted.  A list file has one index per line,\n"
+      "in any order.  Selected rows (resp. columns) are renumbered from 1,\n"
+      "keeping their relative order.\n"
+      "\n"
+      "Entries are streamed from INPUT to OUTPUT, testing each of them\n"
+      "against the selection; so the whole INPUT is read, but memory\n"
+      "usage is only a few bits per row or column in the selected lists.\n"
+      "\n"
+      "With option '--index', INPUT must be a regular file with entries\n"
+      "sorted by row, and the index a file written for it by option\n"
+      "'--build-index': then reading starts at the first selected row\n"
+      "and stops after the last one, so the amount of data read is\n"
+      "proportional to the number of entries in the selected rows.\n"
+      "Reading also stops after the last selected row if INPUT is marked\n"
+      "as sorted in row-major order by 'sms-canon --mark'.\n"
+      "Building the index reads INPUT once, and checks that its entries\n"
+      "are sorted by row.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('B' == opt)
+      build_index_ = argument;
+    else if ('C' == opt)
+      cols_.set_list(argument);
+    else if ('c' == opt)
+      cols_.set_range(argument);
+    else if ('R' == opt)
+      rows_.set_list(argument);
+    else if ('r' == opt)
+      rows_.set_range(argument);
+    else if ('x' == opt)
+      index_ = argument;
+  };
+
+  int run()
+  {
+    if (not build_index_.empty()) {
+      write_index();
+      return 0;
+    };
+
+    std::istream& input = *FilterProgram::input_;
+    SMSReader<val_t>::open(input);
+    const coord_t nrows = SMSReader<val_t>::rows();
+    const coord_t ncols = SMSReader<val_t>::columns();
+    rows_.resolve(nrows);
+    cols_.resolve(ncols);
+
+    // entries of a canonical row-major stream are sorted as well
+    sorted_ = (ROW_MAJOR_ORDER == SMSReader<val_t>::order());
+    const bool empty = (0 == rows_.count() or 0 == cols_.count());
+    if (not index_.empty() and not empty) {
+      const std::streamoff offset = row_offset(input, rows_.first());
+      input.seekg(offset);
+      if (input.fail())
+        throw std::runtime_error("Cannot seek in INPUT stream.");
+      if (this->start_ >= 0)
+        this->start_ = offset;
+      sorted_ = true;
+    };
+
+    // renumbering preserves the order of entries
+    SMSWriter<val_t>::set_order(SMSReader<val_t>::order());
+    SMSWriter<val_t>::open(*FilterProgram::output_, rows_.count(), cols_.count());
+    if (not empty)
+      SMSReader<val_t>::read();
+    SMSReader<val_t>::close();
+    SMSWriter<val_t>::close();
+
+    return 0;
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    if (rows_.contains(i)) {
+      if (cols_.contains(j))
+        SMSWriter<val_t>::write_entry(rows_.renumber(i), cols_.renumber(j), value);
+    }
+    else if (sorted_ and i > rows_.last())
+      this->stop();
+  };
+
+
+private:
+  Selection rows_;
+  Selection cols_;
+
+  /// offset index file to read, or to write
+  std::string index_;
+  std::string build_index_;
+
+  /// `true` if INPUT entries are sorted by row, so reading can stop
+  /// after the last selected row
+  bool sorted_;
+
+  /// An offset index is the 8-byte magic string "SMSROWX1", then the
+  /// number of rows and columns and the size in bytes of the matrix
+  /// file, then the byte offset of the first entry of each row and of
+  /// the end-of-data marker, all as native 64-bit integers.  Since
+  /// entries are sorted by row, the offset of an empty row is that of
+  /// the next nonempty one.
+  static const std::streamoff INDEX_HEADER = 32;
+
+  /// Return the size in bytes of `input`, or -1 if it is not a
+  /// regular file; the read position is left unchanged.
+  static std::streamoff file_size(std::istream& input)
+  {
+    const std::streampos here = input.tellg();
+    if (std::streampos(-1) == here)
+      return -1;
+    input.seekg(0, std::ios::end);
+    const std::streamoff size = input.tellg();
+    input.seekg(here);
+    return size;
+  };
+
+  /// Return the offset in `input` of the first entry of row `i`,
+  /// looked up in the index file.
+  std::streamoff row_offset(std::istream& input, const coord_t i)
+  {
+    const std::streamoff size = file_size(input);
+    if (size < 0)
+      throw std::runtime_error("Option '--index' requires a regular INPUT file.");
+
+    errno = 0;
+    std::ifstream index(index_.c_str(), std::ios::binary);
+    if (not index.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open index file '" << index_ << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    char magic[8];
+    long long header[3];
+    index.read(magic, 8);
+    index.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (not index.good() or 0 != std::memcmp(magic, "SMSROWX1", 8)) {
+      std::ostringstream msg;
+      msg << "Malformed index file '" << index_ << "'";
+      throw std::runtime_error(msg.str());
+    };
+    if (header[0] != SMSReader<val_t>::rows()
+        or header[1] != SMSReader<val_t>::columns()
+        or header[2] != size) {
+      std::ostringstream msg;
+      msg << "Index file '" << index_ << "' was not built for this INPUT,"
+          << " or INPUT has changed since.";
+      throw std::runtime_error(msg.str());
+    };
+
+    long long offset = -1;
+    index.seekg(INDEX_HEADER + (i - 1) * 8);
+    index.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+    if (index.fail() or offset < 0 or offset > size) {
+      std::ostringstream msg;
+      msg << "Truncated index file '" << index_ << "'";
+      throw std::runtime_error(msg.str());
+    };
+    return offset;
+  };
+
+  /// Scan INPUT and write its offset index to file `build_index_`.
+  /// Only the row indices are parsed, so this runs at about the
+  /// speed of reading the file.
+  void write_index()
+  {
+    std::istream& input = *FilterProgram::input_;
+    const std::streamoff size = file_size(input);
+    if (size < 0)
+      throw std::runtime_error("An offset index can only be built for a regular INPUT file.");
+    RunStats* const stats = RunStats::current();
+    PhaseTimer timer(stats, RunStats::READ);
+
+    coord_t nrows, ncols;
+    char M;
+    input >> std::skipws >> nrows >> ncols >> M;
+    if ('M' != M)
+      throw std::runtime_error("Malformed SMS header");
+    // skip the order marker, if any
+    std::string marker;
+    std::getline(input, marker);
+
+    errno = 0;
+    std::ofstream index(build_index_.c_str(), std::ios::binary);
+    if (not index.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open file '" << build_index_ << "' for writing: " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    index.write("SMSROWX1", 8);
+    const long long header[3] = { nrows, ncols, size };
+    index.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    // entries are triples of whitespace-separated fields; only the
+    // first one of each triple (the row index) is looked at
+    std::vector<long long> offsets;
+    offsets.reserve(65536);
+    std::vector<char> chunk(1 << 20);
+    std::streamoff pos = input.tellg();
+    std::streamoff start = pos;
+    int field = 2;
+    bool in_field = false;
+    coord_t row = 0, last_row = 0;
+    long long count = 0;
+    bool at_end = false;
+    while (not at_end) {
+      input.read(&chunk[0], chunk.size());
+      const std::streamsize n = input.gcount();
+      if (0 == n)
+        break;
+      for (std::streamsize k = 0; k < n; ++k, ++pos) {
+        const char c = chunk[k];
+        if (' ' == c or '\n' == c or '\t' == c or '\r' == c) {
+          if (in_field and 0 == field) {
+            if (0 == row) {
+              // '0 0 0' is the end-of-stream marker
+              at_end = true;
+              break;
+            };
+            if (row < last_row or row > nrows) {
+              std::ostringstream msg;
+              if (row > nrows)
+                msg << "Row index " << row << " at byte " << start
+                    << " is outside matrix bounds.";
+              else
+                msg << "INPUT entries are not sorted by row: row " << row
+                    << " at byte " << start << " follows row " << last_row << ".";
+              throw std::runtime_error(msg.str());
+            };
+            for (; last_row < row; ++last_row)
+              push_offset(index, offsets, start);
+            ++count;
+          };
+          in_field = false;
+        }
+        else {
+          if (not in_field) {
+            in_field = true;
+            field = (field + 1) % 3;
+            if (0 == field) {
+              start = pos;
+              row = 0;
+            };
+          };
+          if (0 == field) {
+            if (c < '0' or c > '9')
+              throw std::runtime_error("Malformed SMS entry: row index is not a number.");
+            row = 10 * row + (c - '0');
+          };
+        };
+      };
+    };
+    // the end of data is at the marker, or at the end of the file
+    if (not at_end)
+      start = pos;
+    for (; last_row <= nrows; ++last_row)
+      push_offset(index, offsets, start);
+    flush_offsets(index, offsets);
+
+    index.close();
+    if (index.fail()) {
+      std::ostringstream msg;
+      msg << "Error writing index to '" << build_index_ << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    if (NULL != stats) {
+      stats->entries_in += count;
+      if (stats->bytes_in >= 0)
+        stats->bytes_in += size;
+    };
+  };
+
+  static void push_offset(std::ostream& out, std::vector<long long>& offsets,
+                          const std::streamoff offset)
+  {
+    offsets.push_back(offset);
+    if (offsets.size() == offsets.capacity())
+      flush_offsets(out, offsets);
+  };
+
+  static void flush_offsets(std::ostream& out, std::vector<long long>& offsets)
+  {
+    if (not offsets.empty())
+      out.write(reinterpret_cast<const char*>(&offsets[0]), offsets.size() * sizeof(long long));
+    offsets.clear();
+  };
+};
+
+
+SMASTO_MAIN("slice", SliceProgram)
@@ -0,0 +1,262 @@
+/**
+ * @file   sms-split.cpp
+ *
+ * Split a matrix into its connected components, i.e., the diagonal
+ * blocks of a block-diagonal permutation of it.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+// splitting does not care about the type of the entries
+typedef std::string val_t;
+
+
+class SplitProgram : public FilterProgram,
+                     public SMSReader<val_t>
+{
+public:
+  SplitProgram()
+    : prefix_("component"), nrows_(0), ncols_(0),
+      parent_(), size_(), entries_()
+  {
+    this->add_option('P', "prefix", required_argument,
+                     "Write component K to file ARG-K.sms (default: 'component').");
+    this->description =
+      "Split the INPUT matrix into its connected components, and write\n"
+      "each of them to a separate file.  Two rows (or columns) are in the\n"
+      "same component if they are linked by a chain of nonzero entries, in\n"
+      "which consecutive entries share a row or a column index; so, the\n"
+      "components are the diagonal blocks of the finest block-diagonal\n"
+      "form that the matrix can be permuted into, and they can be\n"
+      "processed independently of each other.\n"
+      "\n"
+      "Component K is written to file PREFIX-K.sms, with its rows (resp.\n"
+      "columns) renumbered from 1 in increasing order of their index in\n"
+      "INPUT; components are numbered in the order of their first row.\n"
+      "Rows and columns with no entries do not belong to any component.\n"
+      "Files are written in parallel.\n"
+      "\n"
+      "The INPUT matrix stream should be in J.-G. Dumas' SMS format.\n"
+      "A manifest is written to OUTPUT, with three lines per component:\n"
+      "\n"
+      "    component K rows R columns C nonzeros N file PREFIX-K.sms\n"
+      "    rows I_1 ... I_R\n"
+      "    columns J_1 ... J_C\n"
+      "\n"
+      "The second (resp. third) line lists the INPUT index of each row\n"
+      "(resp. column) of the component, in order.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('P' == opt)
+      prefix_ = argument;
+  };
+
+  int run()
+  {
+    SMSReader<val_t>::open(*FilterProgram::input_);
+    nrows_ = SMSReader<val_t>::rows();
+    ncols_ = SMSReader<val_t>::columns();
+    // nodes 0 to nrows-1 are the rows, the others are the columns
+    parent_.resize(nrows_ + ncols_);
+    for (coord_t x = 0; x < nrows_ + ncols_; ++x)
+      parent_[x] = x;
+    size_.assign(nrows_ + ncols_, 1);
+    entries_.reset(nrows_, ncols_);
+    read();
+    SMSReader<val_t>::close();
+
+    // number components in order of their first row; rows and columns
+    // that are alone in their set have no entries
+    const coord_t nodes = nrows_ + ncols_;
+    std::vector<coord_t> component(nodes, -1);
+    coord_t ncomponents = 0;
+    for (coord_t x = 0; x < nodes; ++x) {
+      if (1 == size_[find(x)])
+        continue;
+      const coord_t r = find(x);
+      if (-1 == component[r])
+        component[r] = ncomponents++;
+      component[x] = component[r];
+    };
+    std::vector<coord_t>().swap(size_);
+
+    // list the rows and columns of each component, and give each its
+    // index within the component; `local` is 1-based
+    std::vector<coord_t> local(nodes, 0);
+    std::vector<std::size_t> row_start(ncomponents + 1, 0), col_start(ncomponents + 1, 0);
+    for (coord_t x = 0; x < nodes; ++x)
+      if (-1 != component[x]) {
+        std::vector<std::size_t>& count = (x < nrows_? row_start : col_start);
+        local[x] = ++count[component[x] + 1];
+      };
+    for (coord_t c = 0; c < ncomponents; ++c) {
+      row_start[c+1] += row_start[c];
+      col_start[c+1] += col_start[c];
+    };
+    std::vector<coord_t> members(row_start[ncomponents] + col_start[ncomponents]);
+    for (coord_t x = 0; x < nodes; ++x)
+      if (-1 != component[x]) {
+        const std::size_t offset = (x < nrows_?
+                                    row_start[component[x]]
+                                    : row_start[ncomponents] + col_start[component[x]]);
+        members[offset + local[x] - 1] = x;
+      };
+
+    // bucket entries by component, keeping their input order
+    const std::size_t nnz = entries_.size();
+    std::vector<std::size_t> start(ncomponents + 1, 0);
+    for (std::size_t n = 0; n < nnz; ++n)
+      ++start[component[entries_.row(n) - 1] + 1];
+    for (coord_t c = 0; c < ncomponents; ++c)
+      start[c+1] += start[c];
+    std::vector<std::size_t> order(nnz);
+    {
+      std::vector<std::size_t> next(start.begin(), start.end() - 1);
+      for (std::size_t n = 0; n < nnz; ++n)
+        order[next[component[entries_.row(n) - 1]]++] = n;
+    };
+
+    // writers in the OpenMP threads cannot share the run statistics,
+    // so do the accounting here for all of them
+    RunStats* const stats = RunStats::current();
+    RunStats::set_current(NULL);
+    // exceptions must not escape an OpenMP parallel region
+    std::string error;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (coord_t c = 0; c < ncomponents; ++c) {
+      TraceSpan span("write component");
+      try {
+        SMSWriter<val_t> writer;
+        writer.open(filename(c),
+                    row_start[c+1] - row_start[c], col_start[c+1] - col_start[c]);
+        for (std::size_t k = start[c]; k < start[c+1]; ++k) {
+          const std::size_t n = order[k];
+          writer.write_entry(local[entries_.row(n) - 1],
+                             local[nrows_ + entries_.column(n) - 1],
+                             entries_.value(n));
+        };
+        writer.close();
+      }
+      catch (std::exception& ex) {
+#pragma omp critical
+        error = ex.what();
+      };
+    };
+    RunStats::set_current(stats);
+    if (not error.empty())
+      throw std::runtime_error(error);
+    if (NULL != stats)
+      stats->entries_out += nnz;
+
+    for (coord_t c = 0; c < ncomponents; ++c) {
+      std::ostream& out = *FilterProgram::output_;
+      out << "component " << (c+1)
+          << " rows " << (row_start[c+1] - row_start[c])
+          << " columns " << (col_start[c+1] - col_start[c])
+          << " nonzeros " << (start[c+1] - start[c])
+          << " file " << filename(c) << '\n';
+      out << "rows";
+      for (std::size_t k = row_start[c]; k < row_start[c+1]; ++k)
+        out << ' ' << (members[k] + 1);
+      out << '\n';
+      out << "columns";
+      for (std::size_t k = col_start[c]; k < col_start[c+1]; ++k)
+        out << ' ' << (members[row_start[ncomponents] + k] - nrows_ + 1);
+      out << '\n';
+    };
+    FilterProgram::output_->flush();
+
+    return 0;
+  };
+
+
+protected:
+  void process_entry(const coord_t i, const coord_t j, const val_t& value)
+  {
+    unite(i-1, nrows_ + j-1);
+    entries_.push_back(i, j, value);
+  };
+
+
+private:
+  std::string prefix_;
+  coord_t nrows_;
+  coord_t ncols_;
+
+  /// union-find forest over rows and columns, and size of each tree
+  std::vector<coord_t> parent_;
+  std::vector<coord_t> size_;
+
+  /// matrix entries, in the order they were read from the stream
+  EntryList<val_t> entries_;
+
+  /// Return the root of the tree of `x`, halving the path to it.
+  coord_t find(coord_t x)
+  {
+    while (parent_[x] != x) {
+      parent_[x] = parent_[parent_[x]];
+      x = parent_[x];
+    };
+    return x;
+  };
+
+  /// Merge the trees of `x` and `y`, attaching the smaller to the larger.
+  void unite(const coord_t x, const coord_t y)
+  {
+    coord_t rx = find(x);
+    coord_t ry = find(y);
+    if (rx == ry)
+      return;
+    if (size_[rx] < size_[ry])
+      std::swap(rx, ry);
+    parent_[ry] = rx;
+    size_[rx] += size_[ry];
+  };
+
+  /// Name of the file for (0-based) component `c`.
+  std::string filename(const coord_t c) const
+  {
+    std::ostringstream name;
+    name << prefix_ << "-" << (c+1) << ".sms";
+    return name.str();
+  };
+};
+
+
+SMASTO_MAIN("split", SplitProgram)
@@ -28,12 +28,20 @@
 
 #include "common.hpp"
 
+#include <boost/unordered_map.hpp>
+
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
 
 
 // matrix dimensions should fit into a `long` integer type
@@ -50,6 +58,7 @@ public:
   SvgProgram()
     : size_(5)
     , shrink_(1)
+    , size_given_(false)
     , max_width_(0)
     , max_height_(0)
     , darken_(1.0)
@@ -59,16 +68,32 @@ public:
     , entry_color_("blue")
     , frame_color_("black")
     , grid_color_("silver")
+    , format_(SVG_OUTPUT)
+    , bit_depth_(8)
+    , raster_width_(0)
+    , raster_height_(0)
+    , batch_rows_()
+    , batch_cols_()
+    , density_()
+    , pyramid_dir_()
+    , tile_size_(256)
+    , tiles_()
+    , ntiles_x_(0)
+    , nnz_(0)
   {
     this->add_option('b', "block-size",  required_argument, "Size (in pixels) of each square dot representing matrix entries.");
+    this->add_option('B', "bit-depth",   required_argument, "Bits per pixel in PGM and PNG output: either 8 (default) or 16.");
     this->add_option('c', "color",       required_argument, "Color of the matrix entries in the output SVG file. Any color spec that is defined in the SVG standard is allowed.");
     this->add_option('d', "darken",       required_argument, "Overcount nonzero elements in matrix tiles. This option has effect only when shrinking.");
+    this->add_option('f', "format",      required_argument, "Output format: `svg` (default), `pgm` or `png`.");
     this->add_option('g', "grid",        required_argument, "Draw axes every NUM entries; disable if NUM is 0 (default). Mutually incompatible with `-x` and `-y`.");
     this->add_option('j', "grid-color",  required_argument, "Color of the grid axes (if any).");
     this->add_option('k', "frame-color", required_argument, "Color of the enclosing box.");
+    this->add_option('P', "pyramid",     required_argument, "Write a multi-resolution tile pyramid into directory DIR, instead of a single picture.");
     this->add_option('s', "shrink",      required_argument, "One dot in the SVG output corresponds to a NUM by NUM square in the INPUT matrix. Default: dots in SVG OUTPUT correspond 1-1 to matrix entries in INPUT.");
     this->add_option('t', "shrink-to-height", required_argument, "Scale the output image so that the drawing area is at most NUM pixels tall. Mutually exclusive with options `-s` and `-w`.");
     this->add_option('w', "shrink-to-width", required_argument, "Scale the output image so that the drawing area is at most NUM pixels wide.  Mutually exclusive with options `-s` and `-t`.");
+    this->add_option('Z', "tile-size",   required_argument, "Edge length (in pixels) of tiles in the pyramid (default: 256).");
     this->add_option('x', "num-vert-axes",  required_argument, "Draw NUM vertical axes, equally spaced across the entire picture width. Disable if NUM is 0 (default). Mutually incompatible with `-g`.");
     this->add_option('y', "num-horiz-axes", required_argument, "Draw NUM horizontal axes, equally spaced across the entire picture height. Disable if NUM is 0 (default). Mutually incompatible with `-g`.");
     this->description =
@@ -100,6 +125,28 @@ public:
       "vertical axes are drawn, equally spaced apart.  Option\n"
       "`--num-horiz-axes` does the same for horizontal axes.  Passing an\n"
       "argument 0 to each of these options turns off drawing axes.\n"
+      "\n"
+      "Option `--format` selects a raster OUTPUT image instead, in PGM or\n"
+      "(uncompressed) PNG format, with 8 or 16 bits per pixel according to\n"
+      "option `--bit-depth`.  In raster images, each pixel corresponds to\n"
+      "one tile, and the gray level is the tile intensity computed as above\n"
+      "(black for tiles with the maximum number of nonzeroes); options\n"
+      "`--shrink-to-width` and `--shrink-to-height` give the maximum image\n"
+      "size in pixels; if neither these nor `--shrink` are given, the tile\n"
+      "size is chosen so that the image has no more pixels than 4096x4096.\n"
+      "Colors, axes and option `--block-size` are ignored.  Raster images\n"
+      "need memory proportional to the number of pixels only, no matter\n"
+      "how many nonzero entries INPUT has.\n"
+      "\n"
+      "Option `--pyramid DIR` builds a tile pyramid for zoomable viewers,\n"
+      "reading INPUT only once.  At the finest level, each pixel is one\n"
+      "NxN tile of INPUT, as set by option `--shrink` (default: 1); each\n"
+      "coarser level halves the resolution, down to a single tile.  Tiles\n"
+      "of `--tile-size` pixels are written as `DIR/LEVEL/X_Y.EXT`, in the\n"
+      "format given by option `--format` (level 0 is the coarsest); tiles\n"
+      "with no nonzero entries are not written.  File `DIR/manifest.json`\n"
+      "describes the pyramid and lists the tiles of each level.  Memory\n"
+      "usage is proportional to the number of nonempty finest-level tiles.\n"
       ;
   };
 
@@ -107,10 +154,26 @@ public:
   {
     if ('b' == opt)
       std::istringstream(argument) >> size_;
+    else if ('B' == opt) {
+      std::istringstream(argument) >> bit_depth_;
+      if (8 != bit_depth_ and 16 != bit_depth_)
+        throw std::runtime_error("Argument to option '--bit-depth' must be either 8 or 16.");
+    }
     else if ('c' == opt)
       entry_color_ = argument;
     else if ('d' == opt)
       std::istringstream(argument) >> darken_;
+    else if ('f' == opt) {
+      const std::string format(argument);
+      if ("svg" == format)
+        format_ = SVG_OUTPUT;
+      else if ("pgm" == format)
+        format_ = PGM_OUTPUT;
+      else if ("png" == format)
+        format_ = PNG_OUTPUT;
+      else
+        throw std::runtime_error("Argument to option '--format' must be one of: svg, pgm, png.");
+    }
     else if ('g' == opt) {
       std::istringstream(argument) >> xticks_;
       yticks_ = xticks_;
@@ -119,12 +182,25 @@ public:
       grid_color_ = argument;
     else if ('k' == opt)
       frame_color_ = argument;
-    else if ('s' == opt)
+    else if ('P' == opt)
+      pyramid_dir_ = argument;
+    else if ('s' == opt) {
       std::istringstream(argument) >> shrink_;
-    else if ('t' == opt)
+      size_given_ = true;
+    }
+    else if ('t' == opt) {
       std::istringstream(argument) >> max_height_;
-    else if ('w' == opt)
+      size_given_ = true;
+    }
+    else if ('w' == opt) {
       std::istringstream(argument) >> max_width_;
+      size_given_ = true;
+    }
+    else if ('Z' == opt) {
+      std::istringstream(argument) >> tile_size_;
+      if (tile_size_ < 1)
+        throw std::runtime_error("Argument to option '--tile-size' must be a positive integer.");
+    }
     else if ('x' == opt) {
       // a negative value for `xticks_` is interpreted as a request to
       // create that many equally-spaced axes
@@ -148,6 +224,11 @@ public:
     coord_t nrows = SMSReader<val_t>::rows();
     coord_t ncols = SMSReader<val_t>::columns();
 
+    if (not pyramid_dir_.empty())
+      return run_pyramid(nrows, ncols);
+    if (SVG_OUTPUT != format_)
+      return run_raster(nrows, ncols);
+
     if (0 != max_width_)
       shrink_ = ncols / (max_width_ / size_);
 
@@ -272,12 +353,12 @@ public:
         const coord_t j = c->first;
         (*output_)
           << "<rect class=\"MatrixEntry\""
-          << " style='opacity:" << std::pow(m_[i][j], darken_) / (shrink_ * shrink_) << "'"
+          << " style='opacity:" << std::pow(c->second, darken_) / (shrink_ * shrink_) << "'"
           << " width=\"" << size_ << "\" height=\"" << size_ << "\""
           << " x=\"" << (j*size_) << "\""
           << " y=\"" << (i*size_) << "\""
           << " />"
-          << std::endl;
+          << '\n';
       };
 
     // write closing XML elements
@@ -292,14 +373,28 @@ public:
 
   void process_entry(const coord_t i, const coord_t j, const val_t& value)
   {
-    if (not is_zero(value))
+    if (is_zero(value))
+      return;
+    if (SVG_OUTPUT == format_ and pyramid_dir_.empty())
       m_[i / shrink_][j / shrink_] += 1;
+    else {
+      batch_rows_.push_back(i);
+      batch_cols_.push_back(j);
+      if (batch_rows_.size() >= batch_size) {
+        if (pyramid_dir_.empty())
+          bin_batch();
+        else
+          bin_batch_tiles();
+      };
+    };
   };
 
 
 private:
   coord_t      size_;
   coord_t      shrink_;
+  /// whether any of options `-s`, `-t`, `-w` was given
+  bool         size_given_;
   coord_t      max_width_;
   coord_t      max_height_;
   double       darken_;
@@ -315,10 +410,497 @@ private:
   typedef std::map< coord_t, row_density_t > matrix_density_t;
   /// matrix data (as read from the stream)
   matrix_density_t m_;
-};
 
+  enum { SVG_OUTPUT, PGM_OUTPUT, PNG_OUTPUT } format_;
+  int bit_depth_;
 
-int main(int argc, char** argv)
-{
-  return SvgProgram().main(argc, argv);
+  /// raster image size, in pixels
+  coord_t raster_width_;
+  coord_t raster_height_;
+
+  /// nonzero entries read but not yet binned
+  static const std::size_t batch_size = 1 << 16;
+  std::vector<coord_t> batch_rows_;
+  std::vector<coord_t> batch_cols_;
+
+  /// largest raster image, in pixels, drawn when no image size or
+  /// tile size is given; it bounds the memory used by `density_`
+  static const coord_t default_raster_pixels = 4096 * 4096;
+
+  /// nonzero count for each pixel of a raster image, shared by all
+  /// threads
+  std::vector<uint32_t> density_;
+
+  /// nonzero count for each pixel of a pyramid tile
+  typedef std::vector<unsigned long long> histogram_t;
+
+  /// output directory for the tile pyramid, or empty
+  std::string pyramid_dir_;
+  coord_t tile_size_;
+
+  /// nonempty tiles of one pyramid level, keyed by `y * ntiles_x + x`;
+  /// each holds `tile_size_` rows of `tile_size_` pixel counts
+  typedef boost::unordered_map<unsigned long long, histogram_t> tile_map_t;
+  tile_map_t tiles_;
+  /// number of tiles per row, at the finest level
+  coord_t ntiles_x_;
+  /// number of nonzero entries read
+  unsigned long long nnz_;
+
+
+  /** Bin matrix entries into a density array with one cell per
+      output pixel, and write it as a raster image. */
+  int run_raster(const coord_t nrows, const coord_t ncols)
+  {
+    if (shrink_ < 1)
+      throw std::runtime_error("Argument to option '--shrink' must be a positive integer.");
+    if (max_width_ < 0)
+      throw std::runtime_error("Argument to option '--shrink-to-width' must be a positive integer.");
+    if (max_height_ < 0)
+      throw std::runtime_error("Argument to option '--shrink-to-height' must be a positive integer.");
+
+    // choose the tile size so that the image fits the requested size
+    if (0 != max_width_)
+      shrink_ = std::max(shrink_, (ncols + max_width_ - 1) / max_width_);
+    if (0 != max_height_)
+      shrink_ = std::max(shrink_, (nrows + max_height_ - 1) / max_height_);
+    if (not size_given_) {
+      // no size given: shrink large matrices to a bounded image
+      shrink_ = std::max(static_cast<coord_t>(1),
+                         static_cast<coord_t>(std::sqrt(1.0 * nrows * ncols / default_raster_pixels)));
+      while (raster_size(nrows, shrink_) * raster_size(ncols, shrink_) > default_raster_pixels)
+        ++shrink_;
+    };
+    raster_width_ = raster_size(ncols, shrink_);
+    raster_height_ = raster_size(nrows, shrink_);
+
+    try {
+      density_.assign(raster_width_ * raster_height_, 0);
+    }
+    catch (std::bad_alloc&) {
+      std::ostringstream msg;
+      msg << "Raster image of " << raster_width_ << "x" << raster_height_ << " pixels is too large;"
+          << " use option '--shrink' or '--shrink-to-width' to draw a smaller image.";
+      throw std::runtime_error(msg.str());
+    };
+    batch_rows_.reserve(batch_size);
+    batch_cols_.reserve(batch_size);
+
+    read();
+    bin_batch();
+    SMSReader<val_t>::close();
+
+    std::vector<unsigned char> pixels;
+    encode_gray(&density_[0], raster_width_, raster_width_, raster_height_,
+                1.0 * shrink_ * shrink_, pixels);
+
+    const unsigned int maxval = (16 == bit_depth_? 65535 : 255);
+    if (PGM_OUTPUT == format_)
+      write_pgm(*output_, pixels, raster_width_, raster_height_, maxval);
+    else
+      write_png(*output_, pixels, raster_width_, raster_height_, bit_depth_);
+    output_->flush();
+    if (output_->bad())
+      throw std::runtime_error("Error writing raster image to output stream.");
+    return 0;
+  };
+
+  /// Number of pixels needed to draw @c n matrix rows (or columns)
+  /// with one pixel per @c shrink of them.
+  static coord_t raster_size(const coord_t n, const coord_t shrink)
+  {
+    return std::max(static_cast<coord_t>(1), (n + shrink - 1) / shrink);
+  };
+
+  /** Add the buffered entries to the density array.  Threads count
+      a share of the entries each, with atomic increments of the
+      shared counts. */
+  void bin_batch()
+  {
+    const long n = batch_rows_.size();
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < n; ++k) {
+      const std::size_t p = ((batch_rows_[k] - 1) / shrink_) * raster_width_
+        + (batch_cols_[k] - 1) / shrink_;
+#pragma omp atomic
+      ++density_[p];
+    };
+    batch_rows_.clear();
+    batch_cols_.clear();
+  };
+
+  /** Build a tile pyramid: bin entries into the (sparse) finest
+      level, then derive each coarser level by 2x2 reduction of the
+      previous one, writing out the tiles of each level in parallel. */
+  int run_pyramid(const coord_t nrows, const coord_t ncols)
+  {
+    if (shrink_ < 1)
+      throw std::runtime_error("Argument to option '--shrink' must be a positive integer.");
+    // finest level size, in pixels
+    coord_t width = raster_size(ncols, shrink_);
+    coord_t height = raster_size(nrows, shrink_);
+    int finest = 0;
+    while (((std::max(width, height) - 1) >> finest) >= tile_size_)
+      ++finest;
+    ntiles_x_ = (width + tile_size_ - 1) / tile_size_;
+
+    make_directory(pyramid_dir_);
+    batch_rows_.reserve(batch_size);
+    batch_cols_.reserve(batch_size);
+    read();
+    bin_batch_tiles();
+    SMSReader<val_t>::close();
+
+    // manifest entries for each level, finest first
+    std::vector<std::string> levels;
+    coord_t scale = shrink_;
+    for (int level = finest; level >= 0; --level) {
+      const coord_t ntiles_x = (width + tile_size_ - 1) / tile_size_;
+      const coord_t ntiles_y = (height + tile_size_ - 1) / tile_size_;
+
+      std::ostringstream dirname;
+      dirname << pyramid_dir_ << "/" << level;
+      make_directory(dirname.str());
+
+      // sort tiles, so that the manifest does not depend on hashing
+      std::vector<unsigned long long> keys;
+      keys.reserve(tiles_.size());
+      for (tile_map_t::const_iterator t = tiles_.begin(); t != tiles_.end(); ++t)
+        keys.push_back(t->first);
+      std::sort(keys.begin(), keys.end());
+
+      write_tiles(dirname.str(), keys, width, height, ntiles_x, 1.0 * scale * scale);
+
+      std::ostringstream json;
+      json << "    { \"level\": " << level
+           << ", \"width\": " << width << ", \"height\": " << height
+           << ", \"scale\": " << scale << ", \"tiles\": [";
+      for (std::size_t k = 0; k < keys.size(); ++k)
+        json << (k > 0? ", " : "") << "[" << (keys[k] % ntiles_x) << ", " << (keys[k] / ntiles_x) << "]";
+      json << "] }";
+      levels.push_back(json.str());
+
+      if (level > 0) {
+        reduce_tiles(ntiles_x, ntiles_y);
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        scale *= 2;
+      };
+    };
+
+    // write the manifest, coarsest level first
+    const std::string filename = pyramid_dir_ + "/manifest.json";
+    errno = 0;
+    std::ofstream manifest(filename.c_str());
+    if (not manifest.good()) {
+      std::ostringstream msg;
+      msg << "Cannot open file '" << filename << "' for writing: " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    manifest << "{\n"
+             << "  \"rows\": " << nrows << ",\n"
+             << "  \"columns\": " << ncols << ",\n"
+             << "  \"nonzeros\": " << nnz_ << ",\n"
+             << "  \"tile_size\": " << tile_size_ << ",\n"
+             << "  \"format\": \"" << extension() << "\",\n"
+             << "  \"levels\": [\n";
+    for (std::size_t k = levels.size(); k > 0; --k)
+      manifest << levels[k-1] << (k > 1? ",\n" : "\n");
+    manifest << "  ]\n"
+             << "}\n";
+    if (manifest.bad()) {
+      std::ostringstream msg;
+      msg << "Error writing to file '" << filename << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+    return 0;
+  };
+
+  /** Add the buffered entries to the finest level of the pyramid.
+      Tile and pixel indices are computed in parallel; the counts are
+      then added in a single thread, as tiles are allocated on demand. */
+  void bin_batch_tiles()
+  {
+    const long n = batch_rows_.size();
+    const coord_t tile_span = tile_size_ * shrink_;
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < n; ++k) {
+      const coord_t i = batch_rows_[k] - 1;
+      const coord_t j = batch_cols_[k] - 1;
+      // reuse the batch arrays: tile key and pixel offset in the tile
+      batch_rows_[k] = (i / tile_span) * ntiles_x_ + (j / tile_span);
+      batch_cols_[k] = ((i % tile_span) / shrink_) * tile_size_ + (j % tile_span) / shrink_;
+    };
+    for (long k = 0; k < n; ++k) {
+      histogram_t& tile = tiles_[batch_rows_[k]];
+      if (tile.empty())
+        tile.resize(tile_size_ * tile_size_, 0);
+      ++tile[batch_cols_[k]];
+    };
+    nnz_ += n;
+    batch_rows_.clear();
+    batch_cols_.clear();
+  };
+
+  /** Replace the tiles in `tiles_` with those of the next coarser
+      level: each coarse tile collects the 2x2 block of fine tiles
+      below it, summing counts over 2x2 pixel blocks. */
+  void reduce_tiles(const coord_t ntiles_x, const coord_t ntiles_y)
+  {
+    const coord_t coarse_x = (ntiles_x + 1) / 2;
+    std::vector<unsigned long long> keys;
+    for (tile_map_t::const_iterator t = tiles_.begin(); t != tiles_.end(); ++t)
+      keys.push_back(((t->first / ntiles_x) / 2) * coarse_x + (t->first % ntiles_x) / 2);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<histogram_t> coarse(keys.size());
+    const long nkeys = keys.size();
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long k = 0; k < nkeys; ++k) {
+      histogram_t& out = coarse[k];
+      out.assign(tile_size_ * tile_size_, 0);
+      const coord_t cx = keys[k] % coarse_x;
+      const coord_t cy = keys[k] / coarse_x;
+      for (coord_t b = 0; b < 2; ++b)
+        for (coord_t a = 0; a < 2; ++a) {
+          if (2*cx + a >= ntiles_x or 2*cy + b >= ntiles_y)
+            continue;
+          tile_map_t::const_iterator t = tiles_.find((2*cy + b) * ntiles_x + 2*cx + a);
+          if (tiles_.end() == t)
+            continue;
+          const histogram_t& in = t->second;
+          // fine tile (a,b) lands in quadrant (a,b) of the coarse tile
+          for (coord_t py = 0; py < tile_size_; ++py)
+            for (coord_t px = 0; px < tile_size_; ++px)
+              out[((b * tile_size_ + py) / 2) * tile_size_ + (a * tile_size_ + px) / 2]
+                += in[py * tile_size_ + px];
+        };
+    };
+
+    tile_map_t next;
+    for (long k = 0; k < nkeys; ++k)
+      next[keys[k]].swap(coarse[k]);
+    tiles_.swap(next);
+  };
+
+  /// Write the tiles of one pyramid level into directory `dirname`, in parallel.
+  void write_tiles(const std::string& dirname, const std::vector<unsigned long long>& keys,
+                   const coord_t width, const coord_t height,
+                   const coord_t ntiles_x, const double area)
+  {
+    const long nkeys = keys.size();
+    // exceptions must not escape an OpenMP parallel region
+    std::string error;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long k = 0; k < nkeys; ++k) {
+      const coord_t tx = keys[k] % ntiles_x;
+      const coord_t ty = keys[k] / ntiles_x;
+      const coord_t w = std::min(tile_size_, width - tx * tile_size_);
+      const coord_t h = std::min(tile_size_, height - ty * tile_size_);
+      const histogram_t& counts = tiles_.find(keys[k])->second;
+
+      std::ostringstream filename;
+      filename << dirname << "/" << tx << "_" << ty << "." << extension();
+      std::ofstream out(filename.str().c_str(), std::ios::out | std::ios::binary);
+      if (SVG_OUTPUT == format_)
+        write_svg_tile(out, &counts[0], w, h, area);
+      else {
+        std::vector<unsigned char> pixels;
+        encode_gray(&counts[0], tile_size_, w, h, area, pixels);
+        if (PGM_OUTPUT == format_)
+          write_pgm(out, pixels, w, h, (16 == bit_depth_? 65535 : 255));
+        else
+          write_png(out, pixels, w, h, bit_depth_);
+      };
+      out.close();
+      if (out.fail()) {
+#pragma omp critical
+        error = filename.str();
+      };
+    };
+    if (not error.empty()) {
+      std::ostringstream msg;
+      msg << "Error writing tile file '" << error << "'";
+      throw std::runtime_error(msg.str());
+    };
+  };
+
+  /// Write one pyramid tile as an SVG picture, with a 1x1 square per nonempty pixel.
+  void write_svg_tile(std::ostream& out, const unsigned long long* counts,
+                      const coord_t width, const coord_t height, const double area) const
+  {
+    out << "<?xml version=\"1.0\" standalone=\"no\"?>\n"
+        << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""
+        << " width=\"" << width << "\" height=\"" << height << "\">\n"
+        << "<g fill=\"" << entry_color_ << "\">\n";
+    for (coord_t y = 0; y < height; ++y)
+      for (coord_t x = 0; x < width; ++x) {
+        const unsigned long long c = counts[y * tile_size_ + x];
+        if (0 == c)
+          continue;
+        out << "<rect x=\"" << x << "\" y=\"" << y << "\" width=\"1\" height=\"1\""
+            << " opacity=\"" << std::min(1.0, std::pow(1.0 * c, darken_) / area) << "\" />\n";
+      };
+    out << "</g>\n"
+        << "</svg>\n";
+  };
+
+  /// File name extension for tiles.
+  const char* extension() const
+  {
+    switch (format_) {
+    case PGM_OUTPUT: return "pgm";
+    case PNG_OUTPUT: return "png";
+    default: return "svg";
+    };
+  };
+
+  /// Create directory `path`, unless it already exists.
+  static void make_directory(const std::string& path)
+  {
+    errno = 0;
+    if (0 != mkdir(path.c_str(), 0777) and EEXIST != errno) {
+      std::ostringstream msg;
+      msg << "Cannot create directory '" << path << "': " << strerror(errno);
+      throw std::runtime_error(msg.str());
+    };
+  };
+
+  /** Convert tile counts to gray levels: white for empty tiles, black
+      for full ones, with intensity computed as for the SVG opacity.
+      Array `counts` holds `height` rows of `stride` values, of which
+      the first `width` are used; `area` is the number of matrix
+      entries covered by one pixel. */
+  template< typename count_t >
+  void encode_gray(const count_t* counts, const coord_t stride,
+                   const coord_t width, const coord_t height, const double area,
+                   std::vector<unsigned char>& pixels) const
+  {
+    const unsigned int maxval = (16 == bit_depth_? 65535 : 255);
+    const std::size_t bytes_per_pixel = bit_depth_ / 8;
+    pixels.resize(width * height * bytes_per_pixel);
+#pragma omp parallel for schedule(static) if(width * height > 65536)
+    for (coord_t y = 0; y < height; ++y)
+      for (coord_t x = 0; x < width; ++x) {
+        const std::size_t p = y * width + x;
+        const double intensity =
+          std::min(1.0, std::pow(1.0 * counts[y * stride + x], darken_) / area);
+        const unsigned int gray = static_cast<unsigned int>(maxval * (1 - intensity) + 0.5);
+        if (2 == bytes_per_pixel) {
+          // PGM and PNG both store 16-bit samples in big-endian order
+          pixels[2*p] = gray >> 8;
+          pixels[2*p+1] = gray & 0xFF;
+        }
+        else
+          pixels[p] = gray;
+      };
+  };
+
+  /// Write a binary PGM ("P5") image.
+  static void write_pgm(std::ostream& out, const std::vector<unsigned char>& pixels,
+                        const coord_t width, const coord_t height, const unsigned int maxval)
+  {
+    out << "P5\n" << width << " " << height << "\n" << maxval << "\n";
+    out.write(reinterpret_cast<const char*>(&pixels[0]), pixels.size());
+  };
+
+  /** Write a grayscale PNG image.  The image data is stored in
+      uncompressed ("stored") deflate blocks, so no compression
+      library is needed. */
+  static void write_png(std::ostream& out, const std::vector<unsigned char>& pixels,
+                        const coord_t width, const coord_t height, const int bit_depth)
+  {
+    static const char signature[8] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1A', '\n' };
+    out.write(signature, 8);
+
+    std::string ihdr;
+    append_be32(ihdr, width);
+    append_be32(ihdr, height);
+    ihdr += static_cast<char>(bit_depth);
+    ihdr += '\0'; // color type: grayscale
+    ihdr += '\0'; // compression method: deflate
+    ihdr += '\0'; // filter method: adaptive
+    ihdr += '\0'; // no interlacing
+    write_png_chunk(out, "IHDR", ihdr);
+
+    // each scanline is preceded by a filter type byte (0 = none)
+    const std::size_t row_bytes = pixels.size() / height;
+    std::string raw;
+    raw.reserve(height * (row_bytes + 1));
+    for (coord_t y = 0; y < height; ++y) {
+      raw += '\0';
+      raw.append(reinterpret_cast<const char*>(&pixels[y * row_bytes]), row_bytes);
+    };
+
+    // zlib stream with stored blocks of at most 65535 bytes each
+    std::string idat("\x78\x01", 2);
+    std::size_t pos = 0;
+    do {
+      const std::size_t len = std::min(raw.size() - pos, static_cast<std::size_t>(65535));
+      idat += (pos + len == raw.size()? '\x01' : '\x00');
+      idat += static_cast<char>(len & 0xFF);
+      idat += static_cast<char>(len >> 8);
+      idat += static_cast<char>(~len & 0xFF);
+      idat += static_cast<char>((~len >> 8) & 0xFF);
+      idat.append(raw, pos, len);
+      pos += len;
+    } while (pos < raw.size());
+    append_be32(idat, adler32(raw));
+    write_png_chunk(out, "IDAT", idat);
+
+    write_png_chunk(out, "IEND", std::string());
+  };
+
+  static void write_png_chunk(std::ostream& out, const char* type, const std::string& data)
+  {
+    std::string chunk;
+    append_be32(chunk, data.size());
+    chunk.append(type, 4);
+    chunk += data;
+    append_be32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    out.write(chunk.data(), chunk.size());
+  };
+
+  static void append_be32(std::string& buf, const uint32_t x)
+  {
+    buf += static_cast<char>(x >> 24);
+    buf += static_cast<char>((x >> 16) & 0xFF);
+    buf += static_cast<char>((x >> 8) & 0xFF);
+    buf += static_cast<char>(x & 0xFF);
+  };
+
+  /// CRC-32 checksum, as used in PNG chunks.
+  static uint32_t crc32(const char* data, const std::size_t len)
+  {
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (not table_ready) {
+      for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+          c = (c & 1? 0xEDB88320u ^ (c >> 1) : c >> 1);
+        table[n] = c;
+      };
+      table_ready = true;
+    };
+    uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t k = 0; k < len; ++k)
+      crc = table[(crc ^ static_cast<unsigned char>(data[k])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+  };
+
+  /// Adler-32 checksum, as used in zlib streams.
+  static uint32_t adler32(const std::string& data)
+  {
+    uint32_t a = 1, b = 0;
+    for (std::size_t k = 0; k < data.size(); ++k) {
+      a = (a + static_cast<unsigned char>(data[k])) % 65521;
+      b = (b + a) % 65521;
+    };
+    return (b << 16) | a;
+  };
 };
+
+
+SMASTO_MAIN("to-svg", SvgProgram)
@@ -120,7 +120,4 @@ private:
 };
 
 
-int main(int argc, char** argv)
-{
-  return TransposeProgram().main(argc, argv);
-};
+SMASTO_MAIN("transpose", TransposeProgram)
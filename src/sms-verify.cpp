@@ -0,0 +1,689 @@
+/**
+ * @file   sms-verify.cpp
+ *
+ * Check that a file is a well-formed SMS matrix, reporting the line
+ * and byte offset of the errors found.
+ *
+ * @author  agent@local
+ * @version $Revision$
+ */
+/*
+ * Copyright (c) 2026 agent@local.  All rights reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// matrix dimensions should fit into a `long` integer type
+typedef long coord_t;
+
+/// INPUT is cut into pieces of about this size, which are checked in
+/// parallel; errors are reported for each piece separately
+static const std::size_t CHUNK_BYTES = 1 << 22;
+
+
+/** A place in INPUT: byte offset and line number (both counted from
+    the start of a chunk, while the chunk is being checked). */
+struct Position
+{
+  long long byte;
+  long long line;
+
+  Position() : byte(-1), line(-1) { };
+  Position(const long long byte_, const long long line_) : byte(byte_), line(line_) { };
+
+  bool valid() const { return byte >= 0; };
+  bool operator<(const Position& other) const { return byte < other.byte; };
+};
+
+
+/** Coordinates of an entry packed into a single key, and where the
+    entry is; used to find duplicates in unsorted files. */
+struct KeyedEntry
+{
+  uint64_t key;
+  Position where;
+
+  bool operator<(const KeyedEntry& other) const
+  {
+    return key < other.key or (key == other.key and where.byte < other.where.byte);
+  };
+};
+
+
+/** Results of checking one chunk of INPUT. */
+struct ChunkCheck
+{
+  /// start of the chunk in INPUT, its size, and its number of line ends
+  Position base;
+  long long bytes;
+  long long lines;
+
+  long long entries;
+  long long zeroes;
+  /// number of errors, and the first one
+  long long errors;
+  Position error;
+  std::string message;
+
+  /// first and last entry, for checking order across chunks
+  Position first_entry;
+  coord_t first_row, first_col, last_row, last_col;
+  /// number of entries out of row-major (resp. column-major) order,
+  /// and the first of them
+  long long row_inversions, col_inversions;
+  Position row_inversion, col_inversion;
+  /// number of entries equal to the previous one, and the first
+  long long repeats;
+  Position repeat;
+
+  /// the end-of-matrix marker, and the first line that is not blank
+  Position trailer;
+  Position first_content;
+
+  /// entries with their keys, if collected
+  std::vector<KeyedEntry> keys;
+
+  ChunkCheck()
+    : base(), bytes(0), lines(0), entries(0), zeroes(0), errors(0), error(), message(),
+      first_entry(), first_row(0), first_col(0), last_row(0), last_col(0),
+      row_inversions(0), col_inversions(0), row_inversion(), col_inversion(),
+      repeats(0), repeat(), trailer(), first_content(), keys()
+  { };
+
+  /** Count an error at @c where, and remember it if it is the first
+      one in the chunk. */
+  void note(const Position& where, const std::string& what)
+  {
+    ++errors;
+    if (not error.valid() or where < error) {
+      error = where;
+      message = what;
+    };
+  };
+};
+
+
+class VerifyProgram : public FilterProgram
+{
+public:
+  VerifyProgram()
+    : check_duplicates_(true), max_errors_(100),
+      nrows_(0), ncols_(0), col_bits_(0), order_(UNSORTED_ORDER),
+      header_end_(), chunks_(), keyed_()
+  {
+    this->add_option('m', "max-errors", required_argument,
+                     "Print at most ARG error messages (default: 100).");
+    this->add_option('n', "no-duplicates", no_argument,
+                     "Do not look for duplicate entries in unsorted files.");
+    this->description =
+      "Check that INPUT is a well-formed SMS matrix file, and report where\n"
+      "the errors are.  The following are checked: that the header has\n"
+      "the form 'ROWS COLUMNS M', optionally followed by an order marker\n"
+      "written by 'sms-canon --mark'; that each other line is blank or holds one\n"
+      "entry, made of a row index, a column index, and a number; that\n"
+      "indices are within the matrix dimensions; that the end-of-matrix\n"
+      "marker '0 0 0' is there, and is only followed by blank lines;\n"
+      "that no two entries have the same coordinates; and that entries\n"
+      "are in the order declared in the header, if any, with no explicit\n"
+      "zeroes.\n"
+      "\n"
+      "INPUT is cut into chunks of a few megabytes, which are checked in\n"
+      "parallel.  For each chunk with errors, the first one is printed to\n"
+      "OUTPUT, with its line number and byte offset in INPUT; then comes\n"
+      "a summary of the matrix.  The exit code is 1 if there were errors.\n"
+      "\n"
+      "Duplicates in a file sorted by rows or by columns are found while\n"
+      "checking the order of entries.  In an unsorted file, INPUT is read\n"
+      "a second time, keeping 24 bytes per entry in memory, unless option\n"
+      "'--no-duplicates' is given or INPUT cannot be rewound.\n"
+      ;
+  };
+
+  void process_option(const int opt, const char* argument)
+  {
+    if ('m' == opt)
+      std::istringstream(argument) >> max_errors_;
+    else if ('n' == opt)
+      check_duplicates_ = false;
+  };
+
+  int run()
+  {
+    std::istream& input = *FilterProgram::input_;
+    // `tellg()` fails on non-seekable streams like pipes and terminals
+    const std::streampos start = input.tellg();
+    RunStats* const stats = RunStats::current();
+
+    std::ostream& out = *FilterProgram::output_;
+    std::string header;
+    if (not read_header(input, header)) {
+      out << "line 1, byte 0: " << header << '\n';
+      out << "Errors: 1\n";
+      out.flush();
+      return 1;
+    };
+
+    scan(input, false);
+    if (NULL != stats)
+      stats->bytes_in = end_of_data().byte;
+    const long long row_inversions = order_inversions(true);
+    const long long col_inversions = order_inversions(false);
+    check_declared_order();
+    const bool sorted = (0 == row_inversions or 0 == col_inversions);
+
+    // duplicates in sorted files are next to each other
+    long long duplicates = -1;
+    if (sorted) {
+      duplicates = 0;
+      for (std::vector<ChunkCheck>::iterator c = chunks_.begin(); c != chunks_.end(); ++c) {
+        duplicates += c->repeats;
+        if (c->repeats > 0)
+          c->note(c->repeat, "Duplicate entry: same coordinates as the previous one.");
+        c->errors += c->repeats - (c->repeats > 0? 1 : 0);
+      };
+    }
+    else if (check_duplicates_ and col_bits_ >= 0 and std::streampos(-1) != start) {
+      input.clear();
+      input.seekg(start);
+      if (input.fail())
+        throw std::runtime_error("Cannot rewind INPUT stream for the duplicates check.");
+      read_header(input, header);
+      std::vector<ChunkCheck> first_pass;
+      first_pass.swap(chunks_);
+      long long entries = 0;
+      for (std::vector<ChunkCheck>::const_iterator c = first_pass.begin(); c != first_pass.end(); ++c)
+        entries += c->entries;
+      keyed_.reserve(entries);
+      scan(input, true);
+      duplicates = find_duplicates(first_pass);
+    };
+    check_trailer();
+
+    // report
+    long long entries = 0, zeroes = 0, errors = 0, reported = 0;
+    for (std::vector<ChunkCheck>::const_iterator c = chunks_.begin(); c != chunks_.end(); ++c) {
+      entries += c->entries;
+      zeroes += c->zeroes;
+      errors += c->errors;
+      if (c->errors > 0 and reported < max_errors_) {
+        out << "line " << (c->base.line + c->error.line)
+            << ", byte " << (c->base.byte + c->error.byte)
+            << ": " << c->message << '\n';
+        ++reported;
+      };
+    };
+    if (NULL != stats)
+      stats->entries_in += entries;
+
+    out << "Rows: " << nrows_ << '\n';
+    out << "Columns: " << ncols_ << '\n';
+    out << "Entries: " << entries << '\n';
+    out << "Explicit zeroes: " << zeroes << '\n';
+    out << "Duplicates: ";
+    if (duplicates >= 0)
+      out << duplicates << '\n';
+    else
+      out << "not checked" << '\n';
+    out << "Order: "
+        << (0 == row_inversions? "row-major"
+            : 0 == col_inversions? "column-major"
+            : "unsorted") << '\n';
+    out << "Declared order: "
+        << (ROW_MAJOR_ORDER == order_? "row-major"
+            : COLUMN_MAJOR_ORDER == order_? "column-major"
+            : "none") << '\n';
+    out << "Errors: " << errors << '\n';
+    out.flush();
+
+    return (errors > 0? 1 : 0);
+  };
+
+
+private:
+  bool check_duplicates_;
+  long long max_errors_;
+
+  coord_t nrows_;
+  coord_t ncols_;
+  /// number of bits of the column index in a packed key; -1 if the
+  /// coordinates do not fit in 64 bits
+  int col_bits_;
+  /// order declared in the header
+  entry_order order_;
+
+  /// position of the line after the header
+  Position header_end_;
+  /// results for each chunk of INPUT, in order
+  std::vector<ChunkCheck> chunks_;
+  /// entries collected by `scan`, with positions relative to INPUT
+  std::vector<KeyedEntry> keyed_;
+
+  /// Read and check the header line; return `false` and set `error`
+  /// to a message if it is malformed.
+  bool read_header(std::istream& input, std::string& error)
+  {
+    std::string line;
+    if (not std::getline(input, line)) {
+      error = "Empty INPUT: no SMS header.";
+      return false;
+    };
+    header_end_ = Position(line.size() + (input.eof()? 0 : 1), 2);
+    std::istringstream header(line);
+    std::string rows, cols, M, word, extra;
+    header >> rows >> cols >> M >> word >> extra;
+    if (not parse_index(rows.data(), rows.data() + rows.size(), nrows_)
+        or not parse_index(cols.data(), cols.data() + cols.size(), ncols_)
+        or "M" != M) {
+      error = "Malformed SMS header: expected 'ROWS COLUMNS M'.";
+      return false;
+    };
+    if (word.empty())
+      order_ = UNSORTED_ORDER;
+    else if ("canonical=row" == word)
+      order_ = ROW_MAJOR_ORDER;
+    else if ("canonical=column" == word)
+      order_ = COLUMN_MAJOR_ORDER;
+    else {
+      error = "Malformed SMS header: unknown word '" + word + "' after 'M'.";
+      return false;
+    };
+    if (not extra.empty()) {
+      error = "Malformed SMS header: extra words after the order marker.";
+      return false;
+    };
+
+    // bits needed by the row and column indices of a packed key
+    int row_bits = 0, col_bits = 0;
+    for (uint64_t x = nrows_; x != 0; x >>= 1)
+      ++row_bits;
+    for (uint64_t x = ncols_; x != 0; x >>= 1)
+      ++col_bits;
+    col_bits_ = (row_bits + col_bits <= 64? col_bits : -1);
+    return true;
+  };
+
+  /// Read INPUT after the header in windows of a few chunks, and check
+  /// the chunks of each window in parallel.  Chunk boundaries are at
+  /// the first line end after every `CHUNK_BYTES` bytes, so they do
+  /// not depend on the number of threads or the size of the window.
+  /// If `collect` is true, entries are collected in `ChunkCheck::keys`.
+  void scan(std::istream& input, const bool collect)
+  {
+#ifdef _OPENMP
+    const std::size_t window = 2 * omp_get_max_threads() + 1;
+#else
+    const std::size_t window = 2;
+#endif
+    PhaseTimer timer(RunStats::current(), RunStats::READ);
+    std::vector<char> buffer(window * CHUNK_BYTES);
+    std::size_t filled = 0;
+    Position next = header_end_;
+    bool at_eof = false;
+    while (true) {
+      if (not at_eof) {
+        TraceSpan span("read window");
+        input.read(&buffer[0] + filled, buffer.size() - filled);
+        filled += input.gcount();
+        at_eof = not input;
+      };
+
+      // cut complete chunks; the rest is carried over to the next window
+      std::vector<std::size_t> bounds(1, 0);
+      while (bounds.back() < filled) {
+        const std::size_t limit = bounds.back() + CHUNK_BYTES;
+        const char* end = NULL;
+        if (limit < filled)
+          end = static_cast<const char*>(std::memchr(&buffer[0] + limit, '\n', filled - limit));
+        if (NULL != end)
+          bounds.push_back(end - &buffer[0] + 1);
+        else if (at_eof)
+          bounds.push_back(filled);
+        else
+          break;
+      };
+      const std::size_t count = bounds.size() - 1;
+      if (0 == count and not at_eof) {
+        // a line longer than the whole window
+        buffer.resize(2 * buffer.size());
+        continue;
+      };
+
+      const std::size_t first = chunks_.size();
+      chunks_.resize(first + count);
+#pragma omp parallel for schedule(dynamic, 1)
+      for (long k = 0; k < static_cast<long>(count); ++k) {
+        TraceSpan span("check chunk");
+        check_chunk(&buffer[0] + bounds[k], &buffer[0] + bounds[k+1],
+                    chunks_[first + k], collect);
+      };
+      for (std::size_t k = 0; k < count; ++k) {
+        ChunkCheck& c = chunks_[first + k];
+        c.base = next;
+        c.bytes = bounds[k+1] - bounds[k];
+        next.byte += c.bytes;
+        next.line += c.lines;
+        for (std::vector<KeyedEntry>::iterator e = c.keys.begin(); e != c.keys.end(); ++e) {
+          e->where.byte += c.base.byte;
+          e->where.line += c.base.line;
+        };
+        keyed_.insert(keyed_.end(), c.keys.begin(), c.keys.end());
+        std::vector<KeyedEntry>().swap(c.keys);
+      };
+
+      const std::size_t used = bounds.back();
+      std::memmove(&buffer[0], &buffer[0] + used, filled - used);
+      filled -= used;
+      if (at_eof and 0 == filled)
+        break;
+    };
+  };
+
+  /// Return the position of the end of INPUT.
+  Position end_of_data() const
+  {
+    if (chunks_.empty())
+      return header_end_;
+    const ChunkCheck& last = chunks_.back();
+    return Position(last.base.byte + last.bytes, last.base.line + last.lines);
+  };
+
+  /// Check the lines from `begin` to `end`, which must start at the
+  /// beginning of a line.
+  void check_chunk(const char* begin, const char* end, ChunkCheck& c, const bool collect) const
+  {
+    const char* p = begin;
+    long long line = 0;
+    while (p < end) {
+      const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      if (NULL == eol)
+        eol = end;
+      check_line(p, eol, Position(p - begin, line), c, collect);
+      if (eol < end)
+        ++line;
+      p = eol + 1;
+    };
+    c.lines = line;
+  };
+
+  /// Check a single line, from `p` to `end` (excluded).
+  void check_line(const char* p, const char* end, const Position& where,
+                  ChunkCheck& c, const bool collect) const
+  {
+    // split into at most 4 fields
+    const char* field[4];
+    const char* field_end[4];
+    int nfields = 0;
+    while (p < end) {
+      if (' ' == *p or '\t' == *p or '\r' == *p) {
+        ++p;
+        continue;
+      };
+      if (4 == nfields)
+        break;
+      field[nfields] = p;
+      while (p < end and ' ' != *p and '\t' != *p and '\r' != *p)
+        ++p;
+      field_end[nfields++] = p;
+    };
+    if (0 == nfields)
+      return;
+
+    if (not c.first_content.valid())
+      c.first_content = where;
+    if (c.trailer.valid()) {
+      c.note(where, "Data after the end-of-matrix marker.");
+      return;
+    };
+    if (3 != nfields) {
+      std::ostringstream msg;
+      msg << "Expected 3 fields (row, column, value), found "
+          << (4 == nfields? "more" : (1 == nfields? "1" : "2")) << ".";
+      c.note(where, msg.str());
+      return;
+    };
+
+    coord_t i, j;
+    if (not parse_index(field[0], field_end[0], i)) {
+      c.note(where, "Malformed row index '" + std::string(field[0], field_end[0]) + "'.");
+      return;
+    };
+    if (not parse_index(field[1], field_end[1], j)) {
+      c.note(where, "Malformed column index '" + std::string(field[1], field_end[1]) + "'.");
+      return;
+    };
+    bool zero;
+    if (not parse_value(field[2], field_end[2], zero)) {
+      c.note(where, "Malformed value '" + std::string(field[2], field_end[2]) + "'.");
+      return;
+    };
+    if (0 == i and 0 == j and zero) {
+      c.trailer = where;
+      return;
+    };
+    if (i < 1 or i > nrows_ or j < 1 or j > ncols_) {
+      std::ostringstream msg;
+      if (i < 1 or i > nrows_)
+        msg << "Row index " << i << " is out of range 1 to " << nrows_ << ".";
+      else
+        msg << "Column index " << j << " is out of range 1 to " << ncols_ << ".";
+      c.note(where, msg.str());
+      return;
+    };
+
+    if (zero) {
+      ++c.zeroes;
+      if (UNSORTED_ORDER != order_)
+        c.note(where, "Explicit zero entry in a matrix declared canonical.");
+    };
+    if (0 == c.entries) {
+      c.first_entry = where;
+      c.first_row = i;
+      c.first_col = j;
+    }
+    else {
+      if (i < c.last_row or (i == c.last_row and j < c.last_col)) {
+        if (0 == c.row_inversions++)
+          c.row_inversion = where;
+      };
+      if (j < c.last_col or (j == c.last_col and i < c.last_row)) {
+        if (0 == c.col_inversions++)
+          c.col_inversion = where;
+      };
+      if (i == c.last_row and j == c.last_col) {
+        if (0 == c.repeats++)
+          c.repeat = where;
+      };
+    };
+    c.last_row = i;
+    c.last_col = j;
+    ++c.entries;
+    if (collect) {
+      KeyedEntry e;
+      e.key = (uint64_t(i) << col_bits_) | uint64_t(j);
+      e.where = where;
+      c.keys.push_back(e);
+    };
+  };
+
+  /// If the header declares an order, report entries that break it
+  /// as errors.
+  void check_declared_order()
+  {
+    if (UNSORTED_ORDER == order_)
+      return;
+    const bool by_row = (ROW_MAJOR_ORDER == order_);
+    for (std::vector<ChunkCheck>::iterator c = chunks_.begin(); c != chunks_.end(); ++c) {
+      const long long inversions = (by_row? c->row_inversions : c->col_inversions);
+      if (inversions > 0) {
+        c->note(by_row? c->row_inversion : c->col_inversion,
+                by_row? "Entry out of the declared row-major order."
+                : "Entry out of the declared column-major order.");
+        c->errors += inversions - 1;
+      };
+    };
+  };
+
+  /// Account for the order of entries across chunk boundaries, and
+  /// return the total number of row-major (or column-major)
+  /// inversions.  Repeated entries across boundaries are counted in
+  /// the row-major pass only.
+  long long order_inversions(const bool by_row)
+  {
+    long long total = 0;
+    const ChunkCheck* previous = NULL;
+    for (std::vector<ChunkCheck>::iterator c = chunks_.begin(); c != chunks_.end(); ++c) {
+      if (0 == c->entries)
+        continue;
+      if (NULL != previous) {
+        const coord_t i = c->first_row, j = c->first_col;
+        const coord_t li = previous->last_row, lj = previous->last_col;
+        const bool inverted = (by_row?
+                               (i < li or (i == li and j < lj))
+                               : (j < lj or (j == lj and i < li)));
+        if (inverted) {
+          long long& count = (by_row? c->row_inversions : c->col_inversions);
+          // the first entry of the chunk comes before any other
+          (by_row? c->row_inversion : c->col_inversion) = c->first_entry;
+          ++count;
+        };
+        if (by_row and i == li and j == lj) {
+          ++c->repeats;
+          c->repeat = c->first_entry;
+        };
+      };
+      total += (by_row? c->row_inversions : c->col_inversions);
+      previous = &(*c);
+    };
+    return total;
+  };
+
+  /// Sort the entries collected by a second scan, and report
+  /// duplicates in `first_pass`, the chunks of the first scan; return
+  /// their number.
+  long long find_duplicates(std::vector<ChunkCheck>& first_pass)
+  {
+    PhaseTimer timer(RunStats::current(), RunStats::COMPUTE);
+    TraceSpan span("find duplicates");
+    std::vector<KeyedEntry> entries;
+    entries.swap(keyed_);
+    std::sort(entries.begin(), entries.end());
+
+    // chunk starts, to tell where each duplicate is
+    std::vector<long long> starts;
+    for (std::vector<ChunkCheck>::const_iterator c = first_pass.begin(); c != first_pass.end(); ++c)
+      starts.push_back(c->base.byte);
+
+    long long duplicates = 0;
+    std::size_t first = 0;
+    for (std::size_t k = 1; k < entries.size(); ++k) {
+      if (entries[k].key != entries[first].key) {
+        first = k;
+        continue;
+      };
+      ++duplicates;
+      const std::size_t n = std::upper_bound(starts.begin(), starts.end(), entries[k].where.byte)
+        - starts.begin() - 1;
+      ChunkCheck& c = first_pass[n];
+      std::ostringstream msg;
+      msg << "Duplicate entry: same coordinates as the one at line "
+          << entries[first].where.line << ".";
+      c.note(Position(entries[k].where.byte - c.base.byte, entries[k].where.line - c.base.line),
+             msg.str());
+    };
+    chunks_.swap(first_pass);
+    return duplicates;
+  };
+
+  /// Report a missing end-of-matrix marker, or data after it.
+  void check_trailer()
+  {
+    std::vector<ChunkCheck>::iterator c = chunks_.begin();
+    while (c != chunks_.end() and not c->trailer.valid())
+      ++c;
+    if (c == chunks_.end()) {
+      const Position end = end_of_data();
+      if (chunks_.empty())
+        chunks_.resize(1);
+      ChunkCheck& last = chunks_.back();
+      if (not last.base.valid())
+        last.base = header_end_;
+      last.note(Position(end.byte - last.base.byte, end.line - last.base.line),
+                "Missing end-of-matrix marker '0 0 0'.");
+      return;
+    };
+    for (++c; c != chunks_.end(); ++c)
+      if (c->first_content.valid())
+        c->note(c->first_content, "Data after the end-of-matrix marker.");
+  };
+
+  /// Parse a nonnegative integer of at most 18 digits.
+  static bool parse_index(const char* p, const char* end, coord_t& value)
+  {
+    if (p == end or end - p > 18)
+      return false;
+    value = 0;
+    for (; p < end; ++p) {
+      if (*p < '0' or *p > '9')
+        return false;
+      value = 10 * value + (*p - '0');
+    };
+    return true;
+  };
+
+  /// Check that the text from `p` to `end` is a decimal number, as
+  /// accepted by the C++ stream operators, and tell whether it is zero.
+  static bool parse_value(const char* p, const char* end, bool& zero)
+  {
+    zero = true;
+    if (p < end and ('-' == *p or '+' == *p))
+      ++p;
+    int digits = 0;
+    for (; p < end and *p >= '0' and *p <= '9'; ++p, ++digits)
+      if ('0' != *p)
+        zero = false;
+    if (p < end and '.' == *p)
+      for (++p; p < end and *p >= '0' and *p <= '9'; ++p, ++digits)
+        if ('0' != *p)
+          zero = false;
+    if (0 == digits)
+      return false;
+    if (p < end and ('e' == *p or 'E' == *p)) {
+      ++p;
+      if (p < end and ('-' == *p or '+' == *p))
+        ++p;
+      if (p == end)
+        return false;
+      for (; p < end and *p >= '0' and *p <= '9'; ++p)
+        ;
+    };
+    return p == end;
+  };
+};
+
+
+SMASTO_MAIN("verify", VerifyProgram)
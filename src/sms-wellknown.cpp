@@ -28,16 +28,15 @@
 
 #include "common.hpp"
 
-#include <boost/random/mersenne_twister.hpp>
-//#include <boost/random/random_device.hpp>
-#include <boost/random/uniform_01.hpp>
+#include <boost/random/poisson_distribution.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <map>
-#include <set>
 #include <sstream>
+#include <vector>
 
 
 // matrix dimensions should fit into a `long` integer type
@@ -56,29 +55,86 @@ class WellKnownProgram : public FilterProgram,
 {
 public:
   WellKnownProgram() 
-    : height_(0), width_(0), kind_(ZERO_MATRIX)
+    : height_(0), width_(0), kind_(ZERO_MATRIX),
+      nx_(1), ny_(1), nz_(1),
+      bandwidth_(1), block_size_(2), degree_(3), nonzeros_(0), seed_(0),
+      rmat_a_(0.57), rmat_b_(0.19), rmat_c_(0.19), scale_(0),
+      slot_degree_(0), slots_(), rows_per_block_(1)
   {
+    this->add_option('b', "bandwidth", required_argument,
+                     "Number of nonzero diagonals on each side of the main one, for `banded` matrices (default: 1).");
+    this->add_option('d', "degree", required_argument,
+                     "Number of nonzero entries per row, for `kregular` matrices (default: 3).");
+    this->add_option('k', "block-size", required_argument,
+                     "Size of the diagonal blocks, for `blockdiag` matrices (default: 2).");
+    this->add_option('n', "nonzeros", required_argument,
+                     "Expected number of nonzero entries, for `rmat` matrices (default: 16 times the number of rows).");
+    this->add_option('r', "rmat-probabilities", required_argument,
+                     "Comma-separated probabilities A,B,C of the top-left, top-right"
+                     " and bottom-left quadrants, for `rmat` matrices (default: 0.57,0.19,0.19).");
+    this->add_option('s', "seed", required_argument,
+                     "Initialize the random number generator with seed ARG (default: 0).");
     this->description = 
       "Generate a matrix of the given size and kind, then write it to OUTPUT.\n"
       "First argument KIND specifies what matrix is to be generated: currently\n"
       "allowed values are:\n"
       "  - `identity`: the identity matrix (aliases: `1` or `I`);\n"
-      "  - `zero`: the null matrix (aliases: `0` or `O`).\n"
+      "  - `zero`: the null matrix (aliases: `0` or `O`);\n"
+      "  - `tridiagonal`: the 1D Laplacian, with 2 on the diagonal and -1\n"
+      "    on the sub- and super-diagonal;\n"
+      "  - `banded`: nonzero entries on the main diagonal and on the\n"
+      "    `--bandwidth` diagonals on either side of it;\n"
+      "  - `blockdiag`: dense random blocks of size `--block-size` along\n"
+      "    the diagonal;\n"
+      "  - `rmat`: pattern of an R-MAT power-law graph, with about\n"
+      "    `--nonzeros` entries;\n"
+      "  - `kregular`: pattern of a random bipartite graph where each row\n"
+      "    has exactly `--degree` nonzero entries, and all columns have\n"
+      "    the same number of them;\n"
+      "  - `laplace2d`: 5-point finite-difference Laplacian on a NX-by-NY grid;\n"
+      "  - `laplace3d`: 7-point finite-difference Laplacian on a NX-by-NY-by-NZ grid;\n"
+      "  - `laplace3d-27`: 27-point finite-difference Laplacian on a\n"
+      "    NX-by-NY-by-NZ grid.\n"
+      "\n"
+      "For the Laplacian kinds, the ROWS and COLUMNS arguments are replaced\n"
+      "by the grid dimensions, e.g., `laplace3d NX NY NZ [OUTPUT]`; the\n"
+      "matrix is square, of order NX*NY*NZ.\n"
+      "\n"
+      "Entries are generated in row order, formatting blocks of rows in\n"
+      "parallel; random kinds depend only on the arguments and `--seed`.\n"
       ;
   };
 
 
   void process_option(const int opt, const char* argument)
   {
-    // this is required by the base class, but there's nothing to do
-    // for `process_option` here.
+    if ('b' == opt)
+      std::istringstream(argument) >> bandwidth_;
+    else if ('d' == opt)
+      std::istringstream(argument) >> degree_;
+    else if ('k' == opt)
+      std::istringstream(argument) >> block_size_;
+    else if ('n' == opt)
+      std::istringstream(argument) >> nonzeros_;
+    else if ('r' == opt) {
+      char sep1 = 0, sep2 = 0;
+      std::istringstream input(argument);
+      input >> rmat_a_ >> sep1 >> rmat_b_ >> sep2 >> rmat_c_;
+      if (input.fail() or ',' != sep1 or ',' != sep2
+          or rmat_a_ < 0 or rmat_b_ < 0 or rmat_c_ < 0
+          or rmat_a_ + rmat_b_ + rmat_c_ > 1)
+        throw std::runtime_error("Argument to option '--rmat-probabilities' must be"
+                                 " three nonnegative numbers A,B,C with A+B+C <= 1.");
+    }
+    else if ('s' == opt)
+      std::istringstream(argument) >> seed_;
   };
 
 
   void parse_args(int argc, char** argv)
   {
     // too few arguments
-    if (argc < 4) {
+    if (argc < 2) {
       std::ostringstream msg;
       msg << "Not all required arguments present."
           << " Type '" << argv[0] << " --help' to get usage help."
@@ -87,31 +143,44 @@ public:
     };
 
     // usage: KIND ROWS COLUMNS [OUTPUT]
-    switch (argv[1][0]) {
-    case 'I':
-    case 'i':
-    case '1':
-      kind_ = IDENTITY_MATRIX;
-      break;
-    case 'Z':
-    case 'z':
-    case 'O':
-    case '0':
-      kind_ = ZERO_MATRIX;
-      break;
+    //    or: KIND NX NY [NZ] [OUTPUT]
+    kind_ = parse_kind(argv[1]);
+    int ndims = 2;
+    if (LAPLACE3D_MATRIX == kind_ or LAPLACE3D27_MATRIX == kind_)
+      ndims = 3;
+
+    // too few arguments
+    if (argc < 2 + ndims) {
+      std::ostringstream msg;
+      msg << "Not all required arguments present."
+          << " Type '" << argv[0] << " --help' to get usage help."
+          << std::endl;
+      throw std::runtime_error(msg.str());
     };
-    std::istringstream(argv[2]) >> height_;
-    std::istringstream(argv[3]) >> width_;
-    if (argc > 4)
-      set_output(argv[4]);
+
+    if (LAPLACE2D_MATRIX == kind_ or ndims == 3) {
+      std::istringstream(argv[2]) >> nx_;
+      std::istringstream(argv[3]) >> ny_;
+      if (3 == ndims)
+        std::istringstream(argv[4]) >> nz_;
+      if (nx_ < 1 or ny_ < 1 or nz_ < 1)
+        throw std::runtime_error("Grid dimensions must be positive!");
+      height_ = width_ = nx_ * ny_ * nz_;
+    }
+    else {
+      std::istringstream(argv[2]) >> height_;
+      std::istringstream(argv[3]) >> width_;
+    };
+    if (argc > 2 + ndims)
+      set_output(argv[2 + ndims]);
     else
       set_output("-");
     set_output_format(notation_, precision_);
 
     // too many arguments
-    if (argc > 5) {
+    if (argc > 3 + ndims) {
       std::ostringstream msg;
-      msg << "At most four positional arguments allowed."
+      msg << "At most " << (2 + ndims) << " positional arguments allowed."
           << " Type '" << argv[0] << " --help' to get usage help."
           << std::endl;
       throw std::runtime_error(msg.str());
@@ -125,37 +194,368 @@ public:
     if (width_ < 1)
       throw std::runtime_error("Third argument (number of columns) must be positive!");
 
+    // estimate number of entries per row, to split the matrix
+    // into blocks of rows of roughly the same size
+    double entries_per_row = 1;
+    switch (kind_) {
+    case ZERO_MATRIX:
+    case IDENTITY_MATRIX:
+      break;
+    case TRIDIAGONAL_MATRIX:
+      entries_per_row = 3;
+      break;
+    case BANDED_MATRIX:
+      if (bandwidth_ < 0)
+        throw std::runtime_error("Argument to option '--bandwidth' must not be negative.");
+      entries_per_row = 2*bandwidth_ + 1;
+      break;
+    case BLOCKDIAG_MATRIX:
+      if (block_size_ < 1)
+        throw std::runtime_error("Argument to option '--block-size' must be positive.");
+      entries_per_row = block_size_;
+      break;
+    case RMAT_MATRIX:
+      setup_rmat();
+      entries_per_row = 1.0 * nonzeros_ / height_;
+      break;
+    case KREGULAR_MATRIX:
+      setup_kregular();
+      entries_per_row = degree_;
+      break;
+    case LAPLACE2D_MATRIX:
+      entries_per_row = 5;
+      break;
+    case LAPLACE3D_MATRIX:
+      entries_per_row = 7;
+      break;
+    case LAPLACE3D27_MATRIX:
+      entries_per_row = 27;
+      break;
+    };
+    rows_per_block_ = std::max(static_cast<coord_t>(1),
+                               static_cast<coord_t>(32768 / std::max(1.0, entries_per_row)));
+
     // generate matrix and write it
     SMSWriter<val_t>::open(*FilterProgram::output_, height_, width_);
+    RowBlockGenerator gen(*this);
+    write_blocks((height_ + rows_per_block_ - 1) / rows_per_block_, gen);
+    SMSWriter<val_t>::close();
+
+    return 0; 
+  };
+
+
+private:
+  coord_t height_;
+  coord_t width_;
+  
+  enum kind_t {
+    ZERO_MATRIX=0, IDENTITY_MATRIX=1,
+    TRIDIAGONAL_MATRIX, BANDED_MATRIX, BLOCKDIAG_MATRIX,
+    RMAT_MATRIX, KREGULAR_MATRIX,
+    LAPLACE2D_MATRIX, LAPLACE3D_MATRIX, LAPLACE3D27_MATRIX
+  } kind_;
+
+  /// grid dimensions, for the Laplacian kinds
+  coord_t nx_, ny_, nz_;
+
+  coord_t bandwidth_;
+  coord_t block_size_;
+  coord_t degree_;
+  double nonzeros_;
+  unsigned long long seed_;
+
+  /// R-MAT quadrant probabilities; the fourth one is `1-a-b-c`
+  double rmat_a_, rmat_b_, rmat_c_;
+  /// number of bits in R-MAT row and column indices
+  int scale_;
+
+  /// for `kregular`: number of slots dealt to each row; if it is not
+  /// `degree_`, the slots hold the columns that are *not* in the row
+  coord_t slot_degree_;
+  /// for `kregular`: column (0-based) of each slot; row `i` gets the
+  /// `slot_degree_` consecutive slots starting at `(i-1)*slot_degree_`
+  std::vector<coord_t> slots_;
+
+  coord_t rows_per_block_;
+
+  static kind_t parse_kind(const char* name)
+  {
+    if (0 == strcmp(name, "tridiagonal"))
+      return TRIDIAGONAL_MATRIX;
+    else if (0 == strcmp(name, "banded"))
+      return BANDED_MATRIX;
+    else if (0 == strcmp(name, "blockdiag"))
+      return BLOCKDIAG_MATRIX;
+    else if (0 == strcmp(name, "rmat"))
+      return RMAT_MATRIX;
+    else if (0 == strcmp(name, "kregular"))
+      return KREGULAR_MATRIX;
+    else if (0 == strcmp(name, "laplace2d"))
+      return LAPLACE2D_MATRIX;
+    else if (0 == strcmp(name, "laplace3d"))
+      return LAPLACE3D_MATRIX;
+    else if (0 == strcmp(name, "laplace3d-27"))
+      return LAPLACE3D27_MATRIX;
+    switch (name[0]) {
+    case 'I':
+    case 'i':
+    case '1':
+      return IDENTITY_MATRIX;
+    case 'Z':
+    case 'z':
+    case 'O':
+    case '0':
+      return ZERO_MATRIX;
+    };
+    std::ostringstream msg;
+    msg << "Unknown matrix kind '" << name << "'."
+        << " Type 'sms-wellknown --help' to get the list of allowed kinds.";
+    throw std::runtime_error(msg.str());
+  };
+
+  /// Check R-MAT parameters and choose the number of index bits.
+  void setup_rmat()
+  {
+    if (0 == nonzeros_)
+      nonzeros_ = 16.0 * height_;
+    if (nonzeros_ < 0)
+      throw std::runtime_error("Argument to option '--nonzeros' must be positive.");
+    const coord_t n = std::max(height_, width_);
+    for (scale_ = 0; (static_cast<coord_t>(1) << scale_) < n; ++scale_)
+      /* nothing to do */;
+  };
+
+  /** Draw a random `kregular` pattern with the configuration model:
+      each column gets the same number of "slots", the list of all
+      slots is shuffled, and each row is dealt `degree_` consecutive
+      slots.  A row that is dealt the same column twice is repaired by
+      swapping the repeated slot with a random slot of another row,
+      provided that neither row gets a repeated column from the swap;
+      swaps never create repetitions, so one pass over the rows
+      suffices.  Swaps rarely succeed when rows hold most of the
+      columns, so if `degree_` is more than half of them, the pattern
+      of the complement is drawn instead. */
+  void setup_kregular()
+  {
+    if (degree_ < 1 or degree_ > width_)
+      throw std::runtime_error("Argument to option '--degree' must be between 1 and the number of columns.");
+    if ((height_ * degree_) % width_ != 0)
+      throw std::runtime_error("For `kregular` matrices, ROWS times `--degree` must be a multiple of COLUMNS.");
+    slot_degree_ = (2 * degree_ > width_? width_ - degree_ : degree_);
+    const coord_t nslots = height_ * slot_degree_;
+    slots_.resize(nslots);
+    for (coord_t s = 0; s < nslots; ++s)
+      slots_[s] = s % width_;
+    PhiloxRandom rng(seed_, ~0ULL);
+    for (coord_t s = nslots-1; s > 0; --s)
+      std::swap(slots_[s], slots_[rng.below(s+1)]);
+
+    if (nslots == slot_degree_)
+      // only one row, whose slots are all different columns
+      return;
+    for (coord_t i = 0; i < height_; ++i) {
+      const coord_t first = i * slot_degree_;
+      for (coord_t s = first; s < first + slot_degree_; ++s) {
+        if (not in_row(slots_[s], first, s))
+          continue;
+        // repeated column: swap with a slot `t` of another row
+        for (;;) {
+          const coord_t t = rng.below(nslots);
+          const coord_t other = t - t % slot_degree_;
+          if (other == first)
+            continue;
+          if (in_row(slots_[t], first, first + slot_degree_)
+              or in_row(slots_[s], other, other + slot_degree_))
+            continue;
+          std::swap(slots_[s], slots_[t]);
+          break;
+        };
+      };
+    };
+  };
+
+  /// Return @c true if column `c` is in one of the slots `begin` to `end`-1.
+  bool in_row(const coord_t c, const coord_t begin, const coord_t end) const
+  {
+    for (coord_t s = begin; s < end; ++s)
+      if (slots_[s] == c)
+        return true;
+    return false;
+  };
+
+  /** Append the entries of rows `first` to `last` (1-based,
+      inclusive) to `buf`, in row order.  Random kinds draw numbers
+      from a separate stream for each row, so the result does not
+      depend on how rows are distributed among threads. */
+  template< typename buffer_t >
+  void generate_rows(const coord_t first, const coord_t last, buffer_t& buf) const
+  {
     switch (kind_) {
-    case ZERO_MATRIX: 
+    case ZERO_MATRIX:
+      // nothing to do: the null matrix just has header and footer
+      break;
+
+    case IDENTITY_MATRIX:
+      for (coord_t i = first; i <= last and i <= width_; ++i)
+        format_entry(buf, i, i, 1);
+      break;
+
+    case TRIDIAGONAL_MATRIX:
+    case BANDED_MATRIX:
+      {
+        const coord_t k = (TRIDIAGONAL_MATRIX == kind_? 1 : bandwidth_);
+        for (coord_t i = first; i <= last; ++i)
+          for (coord_t j = std::max(static_cast<coord_t>(1), i-k);
+               j <= std::min(width_, i+k); ++j)
+            format_entry(buf, i, j, (i == j? std::max(2*k, static_cast<coord_t>(1)) : -1));
+        break;
+      };
+
+    case BLOCKDIAG_MATRIX:
+      for (coord_t i = first; i <= last; ++i) {
+        PhiloxRandom rng(seed_, i);
+        const coord_t start = 1 + ((i-1) / block_size_) * block_size_;
+        for (coord_t j = start; j < start + block_size_ and j <= width_; ++j)
+          // in (0,1], so the entry is never zero
+          format_entry(buf, i, j, 1 - rng.uniform());
+      };
+      break;
+
+    case RMAT_MATRIX:
       {
-        // nothing to do: the null matrix just has header and footer
+        std::vector<coord_t> cols;
+        for (coord_t i = first; i <= last; ++i)
+          rmat_row(i, cols, buf);
         break;
       };
-    case IDENTITY_MATRIX: 
+
+    case KREGULAR_MATRIX:
       {
-        for(coord_t i = 0; i < height_; ++i)
-          // output entry
-          write_entry(i+1, i+1, 1);
+        std::vector<coord_t> cols(slot_degree_);
+        for (coord_t i = first; i <= last; ++i) {
+          const coord_t slot = slot_degree_ * (i-1);
+          for (coord_t t = 0; t < slot_degree_; ++t)
+            cols[t] = 1 + slots_[slot + t];
+          std::sort(cols.begin(), cols.end());
+          if (slot_degree_ == degree_)
+            for (coord_t t = 0; t < degree_; ++t)
+              format_entry(buf, i, cols[t], 1);
+          else {
+            // the slots hold the columns missing from the row
+            std::size_t t = 0;
+            for (coord_t j = 1; j <= width_; ++j) {
+              if (t < cols.size() and cols[t] == j)
+                ++t;
+              else
+                format_entry(buf, i, j, 1);
+            };
+          };
+        };
         break;
       };
+
+    case LAPLACE2D_MATRIX:
+    case LAPLACE3D_MATRIX:
+    case LAPLACE3D27_MATRIX:
+      for (coord_t i = first; i <= last; ++i)
+        stencil_row(i, buf);
+      break;
     };
-    SMSWriter<val_t>::close();
+  };
 
-    return 0; 
+  /** Output row `i` of a finite-difference Laplacian.  Grid point
+      (x,y,z) is numbered `1 + x + nx*(y + ny*z)`, so visiting
+      neighbours by increasing z, y, x gives increasing columns. */
+  template< typename buffer_t >
+  void stencil_row(const coord_t i, buffer_t& buf) const
+  {
+    const coord_t x = (i-1) % nx_;
+    const coord_t y = ((i-1) / nx_) % ny_;
+    const coord_t z = (i-1) / (nx_ * ny_);
+    const bool full = (LAPLACE3D27_MATRIX == kind_);
+    const coord_t dz_max = (LAPLACE2D_MATRIX == kind_? 0 : 1);
+    const int neighbours = (full? 26 : 4 + 2*dz_max);
+    for (coord_t dz = -dz_max; dz <= dz_max; ++dz) {
+      if (z+dz < 0 or z+dz >= nz_)
+        continue;
+      for (coord_t dy = -1; dy <= 1; ++dy) {
+        if (y+dy < 0 or y+dy >= ny_)
+          continue;
+        for (coord_t dx = -1; dx <= 1; ++dx) {
+          if (x+dx < 0 or x+dx >= nx_)
+            continue;
+          const int offsets = (dx != 0) + (dy != 0) + (dz != 0);
+          if (offsets > 1 and not full)
+            continue;
+          format_entry(buf, i, i + dx + nx_*(dy + ny_*dz),
+                       (0 == offsets? neighbours : -1));
+        };
+      };
+    };
   };
 
+  /** Output row `i` of an R-MAT matrix.  R-MAT drops each edge into a
+      quadrant of the matrix with probabilities A, B, C, D, recursively,
+      so the probability of hitting a row is the product, over the row
+      index bits, of A+B (for a 0 bit) or C+D (for a 1 bit).  Instead
+      of generating edges in random order, we draw the number of
+      entries in row `i` from a Poisson distribution with that mean,
+      and then the column bits conditionally on the row bits; this
+      gives entries in row order without storing the whole matrix. */
+  template< typename buffer_t >
+  void rmat_row(const coord_t i, std::vector<coord_t>& cols, buffer_t& buf) const
+  {
+    const double d = std::max(0.0, 1 - rmat_a_ - rmat_b_ - rmat_c_);
+    const coord_t r = i - 1;
+    double p = 1;
+    for (int bit = scale_-1; bit >= 0; --bit)
+      p *= ((r >> bit) & 1? rmat_c_ + d : rmat_a_ + rmat_b_);
+    if (0 == p)
+      return;
+
+    PhiloxRandom rng(seed_, i);
+    boost::random::poisson_distribution<long, double> count_dist(nonzeros_ * p);
+    const long count = count_dist(rng);
 
-private:
-  coord_t height_;
-  coord_t width_;
-  
-  enum { ZERO_MATRIX=0, IDENTITY_MATRIX=1 } kind_;
+    cols.clear();
+    for (long n = 0; n < count; ++n) {
+      coord_t c;
+      do {
+        c = 0;
+        for (int bit = scale_-1; bit >= 0; --bit) {
+          const bool row_bit = (r >> bit) & 1;
+          const double left = (row_bit? rmat_c_ : rmat_a_);
+          const double right = (row_bit? d : rmat_b_);
+          c <<= 1;
+          if (rng.uniform() * (left + right) >= left)
+            c |= 1;
+        };
+      } while (c >= width_);
+      cols.push_back(c + 1);
+    };
+    // R-MAT graphs have repeated edges; output the pattern only
+    std::sort(cols.begin(), cols.end());
+    cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+    for (std::vector<coord_t>::const_iterator c = cols.begin(); c != cols.end(); ++c)
+      format_entry(buf, i, *c, 1);
+  };
+
+  /// Functor passed to `SMSWriter::write_blocks`.
+  struct RowBlockGenerator
+  {
+    const WellKnownProgram& program;
+    RowBlockGenerator(const WellKnownProgram& p) : program(p) { };
+    template< typename buffer_t >
+    void operator()(const std::size_t b, buffer_t& buf) const
+    {
+      const coord_t first = 1 + b * program.rows_per_block_;
+      program.generate_rows(first,
+                            std::min(first + program.rows_per_block_ - 1, program.height_),
+                            buf);
+    };
+  };
 };
 
 
-int main(int argc, char** argv)
-{
-  return WellKnownProgram().main(argc, argv);
-};
+SMASTO_MAIN("wellknown", WellKnownProgram)
@@ -0,0 +1,29 @@
+#! /bin/sh
+#
+# Check that `sms-convert` writes a well-formed Matrix Market banner,
+# both when it fills in the header of a seekable output file at the
+# end and when it writes the header to a pipe.
+#
+set -e
+
+tmp="convert-mm-header.$$"
+trap 'rm -f "$tmp".*' 0
+
+./sms-random -s 1 -n 100 20 30 "$tmp.real"
+./sms-random -s 1 -I 9 -n 100 20 30 "$tmp.integer"
+
+for field in real integer; do
+    ./sms-convert -t mm "$tmp.$field" "$tmp.file"
+    ./sms-convert -t mm "$tmp.$field" | cat > "$tmp.pipe"
+    for output in "$tmp.file" "$tmp.pipe"; do
+        if [ "$(head -n 1 "$output")" != "%%MatrixMarket matrix coordinate $field general" ]; then
+            echo "$0: malformed banner: $(head -n 1 "$output")" 1>&2
+            exit 1
+        fi
+    done
+    # apart from comments, the two are the same
+    if [ "$(grep -v '^%' "$tmp.file")" != "$(grep -v '^%' "$tmp.pipe")" ]; then
+        echo "$0: seekable and non-seekable $field output differ" 1>&2
+        exit 1
+    fi
+done
@@ -0,0 +1,31 @@
+#! /bin/sh
+#
+# Check that `sms-permute --sorted` keeps every entry of a large
+# unsorted matrix, and sorts them correctly, when the OpenMP runtime
+# runs fewer threads than requested.
+#
+set -e
+
+tmp="permute-threads.$$"
+trap 'rm -f "$tmp".*' 0
+
+# 200000 distinct entries, written in reverse row order
+./sms-random -s 1 -n 200000 1000 1000 "$tmp.sorted"
+awk 'NR == 1 { print; next }
+     $0 == "0 0 0" { next }
+     { entry[n++] = $0 }
+     END { for (k = n-1; k >= 0; --k) print entry[k]; print "0 0 0" }' \
+    "$tmp.sorted" > "$tmp.in"
+
+OMP_DYNAMIC=true OMP_NUM_THREADS=16 ./sms-permute --sorted "$tmp.in" "$tmp.out"
+
+expected=$(grep -cv '^0 0 0$' "$tmp.in")
+actual=$(grep -cv '^0 0 0$' "$tmp.out")
+if [ "$expected" != "$actual" ]; then
+    echo "$0: expected $expected lines, got $actual" 1>&2
+    exit 1
+fi
+if ! cmp -s "$tmp.sorted" "$tmp.out"; then
+    echo "$0: entries are not sorted correctly" 1>&2
+    exit 1
+fi
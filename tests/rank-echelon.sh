@@ -0,0 +1,41 @@
+#! /bin/sh
+#
+# Check that `sms-rank --echelon` writes a row echelon form of the
+# matrix with columns in the order given by `--column-permutation`,
+# in both the sparse and the dense elimination phase.
+#
+set -e
+
+tmp="rank-echelon.$$"
+trap 'rm -f "$tmp".*' 0
+
+./sms-random -s 3 -I 5 0.01 300 400 "$tmp.in"
+
+for threshold in 1 0.001; do
+    rank=$(./sms-rank -d $threshold -e "$tmp.ech" -C "$tmp.perm" "$tmp.in")
+
+    # the first entry of each row is strictly to the right of the
+    # first entry of the row before
+    if ! awk -v rank="$rank" \
+         'NR == 1 { if ($1 != rank) exit 1; next }
+          $1 > 0 && !($1 in lead) { lead[$1] = $2 }
+          END { for (i = 2; i <= rank; ++i) if (lead[i] <= lead[i-1]) exit 1 }' \
+         "$tmp.ech"
+    then
+        echo "$0: not in row echelon form (dense threshold $threshold)" 1>&2
+        exit 1
+    fi
+
+    # the echelon form spans the row space of the permuted matrix
+    ./sms-permute -c "$tmp.perm" "$tmp.in" "$tmp.permuted"
+    awk 'FNR == 1 { if (NR == 1) { rows = $1; print $1 + rank, $2, $3 }; next }
+         $0 == "0 0 0" { next }
+         NR == FNR { print; next }
+         { print $1 + rows, $2, $3 }
+         END { print "0 0 0" }' rank="$rank" "$tmp.permuted" "$tmp.ech" > "$tmp.both"
+    both=$(./sms-rank "$tmp.both")
+    if [ "$both" != "$rank" ]; then
+        echo "$0: echelon form does not match the column permutation (dense threshold $threshold)" 1>&2
+        exit 1
+    fi
+done
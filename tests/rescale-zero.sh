@@ -0,0 +1,38 @@
+#! /bin/sh
+#
+# Check that `sms-rescale` drops entries that become zero, and rejects
+# a zero divisor before writing any output.
+#
+set -e
+
+tmp="rescale-zero.$$"
+trap 'rm -f "$tmp".*' 0
+
+printf '3 3 M\n1 1 2\n2 3 3\n3 2 5\n0 0 0\n' > "$tmp.in"
+
+# 14 is zero modulo 7, so is every rescaled entry
+./sms-rescale -M 7 -m 14 "$tmp.in" "$tmp.out"
+printf '3 3 M\n0 0 0\n' > "$tmp.expected"
+if ! cmp -s "$tmp.expected" "$tmp.out"; then
+    echo "$0: entries that are zero modulo 7 were written" 1>&2
+    exit 1
+fi
+
+# the entry at (2,3) is zero modulo 3
+./sms-rescale -M 3 -m 2 "$tmp.in" "$tmp.out"
+printf '3 3 M\n1 1 1\n3 2 1\n0 0 0\n' > "$tmp.expected"
+if ! cmp -s "$tmp.expected" "$tmp.out"; then
+    echo "$0: wrong result modulo 3" 1>&2
+    exit 1
+fi
+
+for args in "-r 0" "-M 7 -r 7"; do
+    if ./sms-rescale $args "$tmp.in" > "$tmp.out" 2>/dev/null; then
+        echo "$0: division by zero not rejected with '$args'" 1>&2
+        exit 1
+    fi
+    if [ -s "$tmp.out" ]; then
+        echo "$0: output written before rejecting '$args'" 1>&2
+        exit 1
+    fi
+done